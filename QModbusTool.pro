@@ -18,16 +18,32 @@ SOURCES += \
     mainwindow.cpp \
     modbusthread.cpp \
     register_display.cpp \
+    register_table_model.cpp \
+    register_value_delegate.cpp \
     scheduler.cpp \
     metadata_wrapper.cpp \
+    metadata_cache.cpp \
     metadata_structs.cpp \
     inputs_display.cpp \
     csv_importer.cpp \
+    csv_stream_reader.cpp \
     trend_window.cpp \
     base_dialog.cpp \
+    capture_file.cpp \
+    trend_decimator.cpp \
+    trend_exporter.cpp \
+    trend_historian.cpp \
+    segment_store.cpp \
     trend_line.cpp \
     configure_trend_line.cpp \
-    configure_trend.cpp
+    configure_trend.cpp \
+    mbap_codec.cpp \
+    epoll_engine.cpp \
+    endpoints_dialog.cpp \
+    read_planner.cpp \
+    write_planner.cpp \
+    packed_bits.cpp \
+    subscription_index.cpp
 
 HEADERS += \
     coils_display.h \
@@ -36,17 +52,38 @@ HEADERS += \
     mainwindow.h \
     modbusthread.h \
     register_display.h \
+    register_table_model.h \
+    register_value_delegate.h \
     scheduler.h \
+    spsc_ring.h \
     write_event.h \
     metadata_wrapper.h \
+    metadata_cache.h \
     metadata_structs.h \
+    block_pool.h \
     inputs_display.h \
     csv_importer.h \
+    csv_stream_reader.h \
     trend_window.h \
     base_dialog.h \
+    capture_file.h \
+    trend_decimator.h \
+    trend_exporter.h \
+    trend_historian.h \
+    segment_store.h \
     trend_line.h \
     configure_trend_line.h \
-    configure_trend.h
+    configure_trend.h \
+    mbap_codec.h \
+    modbus_connection.h \
+    epoll_engine.h \
+    endpoints_dialog.h \
+    read_planner.h \
+    write_planner.h \
+    packed_bits.h \
+    poll_subscription.h \
+    register_block.h \
+    subscription_index.h
 
 FORMS += \
     mainwindow.ui \
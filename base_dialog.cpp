@@ -126,6 +126,25 @@ void BaseDialog::on_new_value(const quint16 reg, const quint16 value, const quin
 }
 
 
+void BaseDialog::on_endpoint_value(const quint8 endpoint,
+                                   const quint16 reg,
+                                   const quint16 value,
+                                   const quint8 unit_id)
+{
+    if (endpoint == get_endpoint()) {
+        on_new_value(reg, value, unit_id);
+    }
+}
+
+
+void BaseDialog::on_register_block(const quint8 endpoint, const RegisterBlock block)
+{
+    for (size_t i=0U; i<block.count; ++i) {
+        on_endpoint_value(endpoint, quint16(block.first_register + i), get_block_value(block, i), block.node);
+    }
+}
+
+
 void BaseDialog::on_exception_status(BaseDialog *requester, const QString exception)
 {
     static_cast<void>(requester);
@@ -133,6 +152,13 @@ void BaseDialog::on_exception_status(BaseDialog *requester, const QString except
 }
 
 
+void BaseDialog::on_poll_statistics(const quint8 endpoint, const PollStatistics statistics)
+{
+    static_cast<void>(endpoint);
+    static_cast<void>(statistics);
+}
+
+
 void BaseDialog::set_metadata(std::shared_ptr<Metadata> metadata, const quint8 node)
 {
     static_cast<void>(metadata);
@@ -141,8 +167,37 @@ void BaseDialog::set_metadata(std::shared_ptr<Metadata> metadata, const quint8 n
 }
 
 
-void BaseDialog::poll_register_set(ModbusThread *const engine)
+quint16 BaseDialog::poll_register_set(ModbusConnection *const engine)
 {
     static_cast<void>(engine);
     throw AppException("Polling not configured in this object");
 }
+
+
+quint8 BaseDialog::get_endpoint() const noexcept
+{
+    return 0;
+}
+
+
+ReadRange BaseDialog::get_read_range() const
+{
+    return {0, 0, 0};
+}
+
+
+std::vector<PollSubscription> BaseDialog::get_poll_subscriptions() const
+{
+    return {};
+}
+
+
+std::vector<DisplayedRange> BaseDialog::get_displayed_ranges() const
+{
+    const auto range = get_read_range();
+    if (0 == range.count) {
+        return {};
+    }
+
+    return {{get_endpoint(), range}};
+}
@@ -38,6 +38,7 @@
 #include <QVBoxLayout>  //  QVBoxLayout
 #include <QAbstractButton>  //  QAbstractButton
 #include <QStyle>  //  QStyle
+#include <vector>  //  std::vector
 
 // C includes
 /* -none- */
@@ -45,7 +46,11 @@
 // project includes
 #include "write_event.h"  //  WriteRequest
 #include "metadata_structs.h"  //  WindowMetadataRequest
-#include "modbusthread.h"  //  ModbusThread
+#include "modbus_connection.h"  //  ModbusConnection
+#include "read_planner.h"  //  ReadRange
+#include "poll_subscription.h"  //  PollSubscription, PollStatistics
+#include "register_block.h"  //  RegisterBlock
+#include "subscription_index.h"  //  DisplayedRange
 
 
 /**
@@ -77,8 +82,39 @@ public:
     /**
      * \brief Callback from scheduler to poll register data (1-poll)
      * @param engine Modbus connection
+     * @return transaction ID of the request
      */
-    virtual void poll_register_set(ModbusThread *const engine);
+    virtual quint16 poll_register_set(ModbusConnection *const engine);
+
+    /**
+     * \brief Get the registers read by ``poll_register_set``.
+     * \note
+     * Windows that report a range may have their polls merged with others.
+     *
+     * @return range read, count is 0 if the window can't be coalesced
+     */
+    [[nodiscard]] virtual ReadRange get_read_range() const;
+
+    /**
+     * \brief Get the endpoint (device connection) this window is bound to.
+     * @return endpoint index (0 = the main window host/port)
+     */
+    [[nodiscard]] virtual quint8 get_endpoint() const noexcept;
+
+    /**
+     * \brief Get the registers polled periodically while polling continuously.
+     * @return subscriptions, empty if the window is not polled
+     */
+    [[nodiscard]] virtual std::vector<PollSubscription> get_poll_subscriptions() const;
+
+    /**
+     * \brief Get the registers displayed, whatever polls them.
+     * \note
+     * The default implementation returns ``get_read_range`` on ``get_endpoint``.
+     *
+     * @return displayed registers \sa on_register_block
+     */
+    [[nodiscard]] virtual std::vector<DisplayedRange> get_displayed_ranges() const;
 
 public slots:
 
@@ -90,6 +126,34 @@ public slots:
      */
     virtual void on_new_value(const quint16 reg, const quint16 value, const quint8 unit_id);
 
+    /**
+     * \brief Signal to update a register value read from a given endpoint.
+     * \note
+     * The default implementation forwards to ``on_new_value`` when the
+     * endpoint matches ``get_endpoint``.
+     *
+     * @param endpoint endpoint the value was read from
+     * @param reg register number
+     * @param value raw register value
+     * @param unit_id node / unit ID polled
+     */
+    virtual void on_endpoint_value(const quint8 endpoint,
+                                   const quint16 reg,
+                                   const quint16 value,
+                                   const quint8 unit_id);
+
+    /**
+     * \brief Signal to update a block of registers read from a given endpoint.
+     * \note
+     * The default implementation forwards each register to
+     * ``on_endpoint_value``, windows should override this to only copy out the
+     * registers they display.
+     *
+     * @param endpoint endpoint the block was read from
+     * @param block registers read
+     */
+    virtual void on_register_block(const quint8 endpoint, const RegisterBlock block);
+
     /**
      * \brief Signal that a modbus exception occurred.
      * @param requester request source associated with the exception
@@ -97,6 +161,13 @@ public slots:
      */
     virtual void on_exception_status(BaseDialog *requester, const QString exception);
 
+    /**
+     * \brief Signal the timing achieved by a periodic poll.
+     * @param endpoint endpoint polled
+     * @param statistics rate and missed deadlines, \sa PollStatistics::requester
+     */
+    virtual void on_poll_statistics(const quint8 endpoint, const PollStatistics statistics);
+
 signals:
 
     /**
@@ -123,6 +194,12 @@ signals:
      */
     void metadata_requested(WindowMetadataRequest req);
 
+    /**
+     * \brief Emit that the registers polled or their period changed.
+     * @param window this window \sa get_poll_subscriptions
+     */
+    void poll_configuration_changed(BaseDialog *window);
+
 protected:
 
     /**
@@ -0,0 +1,15 @@
+# Settings shared by every benchmark, mirrors QModbusTool.pro
+QT       += core gui xml
+
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+QMAKE_CXXFLAGS += -std=c++17 -Wextra -Wpedantic
+
+DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000
+
+SOURCE_ROOT = $$PWD/..
+INCLUDEPATH += \
+    $$SOURCE_ROOT \
+    /usr/local/include
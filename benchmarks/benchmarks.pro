@@ -0,0 +1,10 @@
+# Stand-alone benchmarks, not part of the application build:
+#   qmake benchmarks/benchmarks.pro && make
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    trend_redraw \
+    stub_plugin \
+    metadata_decode
+
+metadata_decode.depends = stub_plugin
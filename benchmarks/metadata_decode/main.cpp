@@ -0,0 +1,236 @@
+/**
+ * \file benchmarks/metadata_decode/main.cpp
+ * \brief Compare metadata decode throughput with and without the dispatch table
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * Loads the stub plugin (\sa stub_plugin.c) as mod_plugin.so from the
+ * directory of the executable and times each stage of a metadata poll:
+ * create, encode, decode (``decode_response`` including ``decode_labels``
+ * and the other field decoders) and release.  Each stage is run through
+ * MetadataWrapper (entry points resolved once into its function table) and
+ * again with every entry point looked up by ``QLibrary::resolve`` on each
+ * call, as the wrapper did before.
+ */
+
+//  c++ includes
+#include <QCoreApplication>  //  QCoreApplication
+#include <QElapsedTimer>  //  QElapsedTimer
+#include <QLibrary>  //  QLibrary
+#include <QStringBuilder>  //  operator%
+#include <QTextStream>  //  QTextStream
+#include <array>  //  std::array
+#include <vector>  //  std::vector
+
+// C includes
+#include <metadata.h>  //  modbus_plugin: entry point types
+
+// project includes
+#include "metadata_wrapper.h"  //  MetadataWrapper
+#include "metadata_structs.h"  //  Metadata
+
+
+namespace {
+    const auto g_iterations = 100000;  /**< Metadata polls timed */
+    const auto g_first_register = quint16(40001);
+    const auto g_register_span = 100;  /**< Registers cycled through */
+    const std::array<quint8, 4> g_response = {0x41U, 0x00U, 0x01U, 0x02U};  /**< Any non-empty PDU */
+
+
+    /**
+     * \brief Time spent in each stage (ns, all iterations)
+     */
+    struct StageTimes {
+        qint64 create;
+        qint64 encode;
+        qint64 decode;
+        qint64 release;
+    };
+
+
+    /**
+     * \brief Look up a plugin entry point by name.
+     * @param library loaded plugin
+     * @param name symbol name
+     * @return entry point
+     */
+    template<typename T>
+    T resolve(QLibrary &library, const char *const name)
+    {
+        return reinterpret_cast<T>(library.resolve(name));
+    }
+
+
+    /**
+     * \brief Time metadata polls through MetadataWrapper.
+     * @param wrapper loaded wrapper
+     * @return stage times
+     */
+    StageTimes run_dispatch_table(MetadataWrapper *const wrapper)
+    {
+        StageTimes times{0, 0, 0, 0};
+        QElapsedTimer timer;
+        for (auto i=0; i<g_iterations; ++i) {
+            const auto reg = quint16(g_first_register + (i % g_register_span));
+
+            timer.start();
+            auto request = wrapper->create_request(reg);
+            times.create += timer.nsecsElapsed();
+
+            timer.start();
+            const auto pdu = wrapper->encode_request(request);
+            times.encode += timer.nsecsElapsed();
+            static_cast<void>(pdu);
+
+            timer.start();
+            static_cast<void>(wrapper->decode_response(request, g_response.data(), g_response.size()));
+            times.decode += timer.nsecsElapsed();
+
+            timer.start();
+            request.reset();
+            times.release += timer.nsecsElapsed();
+        }
+
+        return times;
+    }
+
+
+    /**
+     * \brief Time metadata polls resolving every entry point on each call.
+     * @param library loaded plugin
+     * @return stage times
+     */
+    StageTimes run_resolve_per_call(QLibrary &library)
+    {
+        StageTimes times{0, 0, 0, 0};
+        QElapsedTimer timer;
+        std::array<quint8, DATA_BUFFER_REQUIRED_SIZE> buffer;
+        std::vector<char> label_buffer;
+        for (auto i=0; i<g_iterations; ++i) {
+            const auto reg = quint16(g_first_register + (i % g_register_span));
+            Metadata record(reg);
+
+            timer.start();
+            quint8 fc;
+            const auto instance = resolve<create>(library, CREATE_SYMBOL)(reg, &fc);
+            times.create += timer.nsecsElapsed();
+
+            timer.start();
+            const auto length = resolve<encode>(library, ENCODE_SYMBOL)(instance, buffer.data());
+            times.encode += timer.nsecsElapsed();
+            static_cast<void>(length);
+
+            timer.start();
+            if (resolve<decode>(library, DECODE_SYMBOL)(instance, g_response.data(),
+                                                        uint8_t(g_response.size())) == 0) {
+                const auto lbl_len = resolve<label>(library, LABEL_SYMBOL)(instance, nullptr);
+                if (lbl_len > 0) {
+                    label_buffer.resize(size_t(lbl_len));
+                    resolve<label>(library, LABEL_SYMBOL)(instance, label_buffer.data());
+                    record.label = QString(label_buffer.data());
+                }
+
+                qint32 dflt;
+                if (resolve<get_default>(library, DEFAULT_SYMBOL)(instance, &dflt) == 0) {
+                    record.dflt = dflt;
+                }
+
+                const auto reported = resolve<encoding>(library, ENCODING_SYMBOL)(instance);
+                if (reported >= 0) {
+                    record.encoding = RegisterEncoding(reported);
+                }
+
+                qint32 min, max;
+                if (resolve<minmax>(library, MINMAX_SYMBOL)(instance, &min, &max) == 0) {
+                    record.min = min;
+                    record.max = max;
+                }
+            }
+            times.decode += timer.nsecsElapsed();
+
+            timer.start();
+            resolve<release>(library, RELEASE_SYMBOL)(instance);
+            times.release += timer.nsecsElapsed();
+        }
+
+        return times;
+    }
+
+
+    /**
+     * \brief Print one stage of both runs.
+     * @param out output stream
+     * @param stage stage name
+     * @param table time through the function table (ns, all iterations)
+     * @param per_call time resolving on each call (ns, all iterations)
+     */
+    void print_stage(QTextStream &out, const char *const stage, const qint64 table, const qint64 per_call)
+    {
+        out << stage << ", "
+            << (double(table) / g_iterations) << ", "
+            << (double(per_call) / g_iterations) << ", "
+            << (table > 0 ? double(per_call) / double(table) : 0.0) << '\n';
+    }
+
+}  //  Anonymous namespace
+
+
+/**
+ * \brief Main entry point
+ *
+ * @param argc standard argument
+ * @param argv standard argument
+ *
+ * @return exit code at exit
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QTextStream out(stdout);
+
+    const auto wrapper = MetadataWrapper::get_instance();
+    if (!wrapper->loaded()) {
+        out << "Plugin unavailable: " << wrapper->get_error() << '\n';
+        return 1;
+    }
+
+    QLibrary library(QCoreApplication::applicationDirPath() % QString("/mod_plugin.so"));
+    if (!library.load()) {
+        out << "Cannot load plugin: " << library.errorString() << '\n';
+        return 1;
+    }
+
+    const auto table = run_dispatch_table(wrapper);
+    const auto per_call = run_resolve_per_call(library);
+
+    out << "stage, function table (ns/op), resolve per call (ns/op), speed-up\n";
+    print_stage(out, "create_request", table.create, per_call.create);
+    print_stage(out, "encode_request", table.encode, per_call.encode);
+    print_stage(out, "decode_response", table.decode, per_call.decode);
+    print_stage(out, "release_request", table.release, per_call.release);
+    print_stage(out, "total",
+                table.create + table.encode + table.decode + table.release,
+                per_call.create + per_call.encode + per_call.decode + per_call.release);
+    return 0;
+}
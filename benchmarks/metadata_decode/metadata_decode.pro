@@ -0,0 +1,15 @@
+include(../benchmarks.pri)
+
+TARGET = metadata_decode
+
+SOURCES += \
+    main.cpp \
+    $$SOURCE_ROOT/exceptions.cpp \
+    $$SOURCE_ROOT/metadata_structs.cpp \
+    $$SOURCE_ROOT/metadata_wrapper.cpp
+
+HEADERS += \
+    $$SOURCE_ROOT/metadata_wrapper.h
+
+LIBS += \
+    -ldl
@@ -0,0 +1,123 @@
+/**
+ * \file benchmarks/stub_plugin/stub_plugin.c
+ * \brief Trivial metadata plugin used by the benchmarks
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * Implements the version 1 interface of metadata.h with a fixed response:
+ * every register reports a label, limits, a default and an encoding so that
+ * every decode function of MetadataWrapper is exercised.  Only the cost of
+ * calling into the plugin is of interest, the PDU is not parsed.
+ */
+
+//  c++ includes
+/* -none- */
+
+// C includes
+#include <stdio.h>  //  snprintf
+#include <stdlib.h>  //  malloc, free
+#include <metadata.h>  //  modbus_plugin: entry point types
+
+// project includes
+/* -none- */
+
+
+#define STUB_FUNCTION_CODE 0x41
+
+
+/**
+ * \brief Request instance
+ */
+struct stub_request {
+    uint16_t register_number; /**< Register requested */
+};
+
+
+void* create_request(uint16_t register_number, uint8_t *function_code)
+{
+    struct stub_request *request = malloc(sizeof(struct stub_request));
+    if (NULL != request) {
+        request->register_number = register_number;
+        if (NULL != function_code) {
+            *function_code = STUB_FUNCTION_CODE;
+        }
+    }
+    return request;
+}
+
+
+uint8_t encode_request(void *request, uint8_t *data)
+{
+    const struct stub_request *r = request;
+    data[0] = (uint8_t)(r->register_number >> 8);
+    data[1] = (uint8_t)(r->register_number & 0xFF);
+    return 2;
+}
+
+
+int decode_response(void *request, const uint8_t *data, uint8_t data_len)
+{
+    (void)request;
+    (void)data;
+    return (data_len > 0 ? 0 : 1);
+}
+
+
+int32_t decode_label(void *request, char *data)
+{
+    const struct stub_request *r = request;
+    if (NULL == data) {
+        return snprintf(NULL, 0, "Register %u", (unsigned)r->register_number) + 1;
+    }
+    return snprintf(data, DATA_BUFFER_REQUIRED_SIZE, "Register %u", (unsigned)r->register_number) + 1;
+}
+
+
+int read_min_max(void *request, int32_t *min, int32_t *max)
+{
+    (void)request;
+    *min = -32768;
+    *max = 32767;
+    return 0;
+}
+
+
+int read_default(void *request, int32_t *dflt)
+{
+    (void)request;
+    *dflt = 0;
+    return 0;
+}
+
+
+int8_t get_encoding(void *request)
+{
+    (void)request;
+    return 1;
+}
+
+
+void release_request(void *request)
+{
+    free(request);
+}
@@ -0,0 +1,11 @@
+# Loaded by metadata_decode from its own directory as mod_plugin.so
+TEMPLATE = lib
+TARGET = mod_plugin
+CONFIG += plugin no_plugin_name_prefix
+CONFIG -= qt
+DESTDIR = $$OUT_PWD/../metadata_decode
+
+INCLUDEPATH += $$PWD/../..
+
+SOURCES += \
+    stub_plugin.c
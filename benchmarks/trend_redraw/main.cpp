@@ -0,0 +1,147 @@
+/**
+ * \file benchmarks/trend_redraw/main.cpp
+ * \brief Time the trend scan path at several history lengths
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * Fills a single trend line with 1e3, 1e5 and 1e6 samples, then times the
+ * work done for each scan: ``TrendLine::add_sample`` followed by the replot
+ * (``TrendWindow::on_replot_timer_timeout``).  Samples are evenly spaced so
+ * that the decimation does not change while timing; the time per scan should
+ * not grow with the history length.
+ */
+
+//  c++ includes
+#include <QApplication>  //  QApplication
+#include <QElapsedTimer>  //  QElapsedTimer
+#include <QMetaObject>  //  QMetaObject::invokeMethod
+#include <QTextStream>  //  QTextStream
+
+// C includes
+/* -none- */
+
+// project includes
+#include "trend_window.h"  //  TrendWindow
+#include "trend_line.h"  //  TrendLine
+
+
+namespace {
+    const int g_history_sizes[] = {1000, 100000, 1000000};  /**< Points per line */
+    const auto g_scans = 1000;  /**< Scans timed at each history size */
+    const auto g_sample_period = 0.01;  /**< Time between samples (s) */
+
+
+    /**
+     * \brief Trend window exposing the scan path
+     */
+    class BenchmarkTrend : public TrendWindow
+    {
+    public:
+
+        /**
+         * \brief constructor
+         * @param points history size of every line
+         */
+        explicit BenchmarkTrend(const int points)
+            : TrendWindow(nullptr)
+        {
+            m_num_points = points;
+        }
+
+        /**
+         * \brief Add a line to the plot.
+         * @return line added
+         */
+        TrendLine *add_line()
+        {
+            auto line = new TrendLine(this, 40001U);
+            add_trend(line);
+            return line;
+        }
+
+        /**
+         * \brief Run the (throttled) replot now.
+         */
+        void replot()
+        {
+            QMetaObject::invokeMethod(this, "on_replot_timer_timeout", Qt::DirectConnection);
+        }
+    };
+
+}  //  Anonymous namespace
+
+
+/**
+ * \brief Main entry point
+ *
+ * @param argc standard argument
+ * @param argv standard argument
+ *
+ * @return exit code at exit
+ */
+int main(int argc, char *argv[])
+{
+    if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication a(argc, argv);
+    QTextStream out(stdout);
+    out << "points, add_sample (us/scan), replot (us/scan)\n";
+
+    for (const auto points: g_history_sizes) {
+        BenchmarkTrend window(points);
+        window.show();
+        QCoreApplication::processEvents();
+
+        auto line = window.add_line();
+        auto timestamp = 0.0;
+        for (auto i=0; i<points; ++i) {
+            line->add_sample(quint16(i), timestamp);
+            timestamp += g_sample_period;
+        }
+        window.replot();  //  Settle the decimation before timing
+
+        QElapsedTimer timer;
+        qint64 add_ns = 0;
+        qint64 replot_ns = 0;
+        for (auto i=0; i<g_scans; ++i) {
+            timer.start();
+            line->add_sample(quint16(i), timestamp);
+            add_ns += timer.nsecsElapsed();
+            timestamp += g_sample_period;
+
+            timer.start();
+            window.replot();
+            replot_ns += timer.nsecsElapsed();
+        }
+
+        out << points << ", "
+            << (double(add_ns) / g_scans / 1000.0) << ", "
+            << (double(replot_ns) / g_scans / 1000.0) << '\n';
+        out.flush();
+        window.close();
+    }
+
+    return 0;
+}
@@ -0,0 +1,34 @@
+include(../benchmarks.pri)
+
+TARGET = trend_redraw
+
+SOURCES += \
+    main.cpp \
+    $$SOURCE_ROOT/base_dialog.cpp \
+    $$SOURCE_ROOT/capture_file.cpp \
+    $$SOURCE_ROOT/configure_trend.cpp \
+    $$SOURCE_ROOT/configure_trend_line.cpp \
+    $$SOURCE_ROOT/exceptions.cpp \
+    $$SOURCE_ROOT/packed_bits.cpp \
+    $$SOURCE_ROOT/segment_store.cpp \
+    $$SOURCE_ROOT/trend_decimator.cpp \
+    $$SOURCE_ROOT/trend_exporter.cpp \
+    $$SOURCE_ROOT/trend_historian.cpp \
+    $$SOURCE_ROOT/trend_line.cpp \
+    $$SOURCE_ROOT/trend_window.cpp
+
+HEADERS += \
+    $$SOURCE_ROOT/base_dialog.h \
+    $$SOURCE_ROOT/configure_trend.h \
+    $$SOURCE_ROOT/configure_trend_line.h \
+    $$SOURCE_ROOT/modbus_connection.h \
+    $$SOURCE_ROOT/trend_exporter.h \
+    $$SOURCE_ROOT/trend_line.h \
+    $$SOURCE_ROOT/trend_window.h
+
+FORMS += \
+    $$SOURCE_ROOT/configure_trend_line.ui \
+    $$SOURCE_ROOT/configure_trend.ui
+
+LIBS += \
+    -L/usr/local/lib -lqcustomplot
@@ -0,0 +1,203 @@
+/**
+ * \file block_pool.h
+ * \brief Recycle fixed-size allocations of short-lived objects
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * Every metadata request and record is a small, short-lived object held by a
+ * ``std::shared_ptr``.  Rather than going to the heap for each one, blocks
+ * released are kept on a free list and handed out again.  ``PoolAllocator``
+ * lets ``std::allocate_shared`` place the object and its control block in a
+ * single pooled block; requests that do not fit a block fall back to the
+ * heap.  A pool is not thread safe, it is meant to be used from one thread.
+ */
+
+#ifndef BLOCK_POOL_H
+#define BLOCK_POOL_H
+
+//  c++ includes
+#include <cstddef>  //  size_t, std::max_align_t
+#include <memory>  //  std::allocator
+#include <new>  //  operator new, operator delete
+#include <vector>  //  std::vector
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+/**
+ * \brief Free list of equally sized memory blocks
+ */
+class BlockPool
+{
+public:
+
+    /**
+     * \brief constructor
+     * @param block_size size of every block (bytes)
+     */
+    explicit BlockPool(const size_t block_size)
+        : m_block_size{block_size},
+          m_free()
+    {
+    }
+
+    BlockPool(const BlockPool&) = delete;
+    BlockPool &operator=(const BlockPool&) = delete;
+
+    /**
+     * \brief Get the size of the blocks handed out.
+     */
+    [[nodiscard]] size_t block_size() const noexcept
+    {
+        return m_block_size;
+    }
+
+    /**
+     * \brief Take a block, from the free list if possible.
+     * @return block of ``block_size`` bytes
+     */
+    [[nodiscard]] void *allocate()
+    {
+        if (m_free.empty()) {
+            return ::operator new(m_block_size);
+        }
+
+        auto block = m_free.back();
+        m_free.pop_back();
+        return block;
+    }
+
+    /**
+     * \brief Return a block to the free list.
+     * @param block block previously returned by ``allocate``
+     */
+    void release(void *const block)
+    {
+        m_free.push_back(block);
+    }
+
+    /**
+     * \brief destructor
+     * \note
+     * Only blocks on the free list are released; every block must have been
+     * returned by then.
+     */
+    ~BlockPool()
+    {
+        for (auto i: m_free) {
+            ::operator delete(i);
+        }
+    }
+
+private:
+    const size_t m_block_size;
+    std::vector<void*> m_free;
+};
+
+
+/**
+ * \brief Allocator drawing single objects from a ``BlockPool``
+ */
+template<typename T>
+class PoolAllocator
+{
+    template<typename U> friend class PoolAllocator;
+
+public:
+    using value_type = T;
+
+    /**
+     * \brief constructor
+     * @param pool pool to draw from (must outlive every allocation)
+     */
+    explicit PoolAllocator(BlockPool *const pool) noexcept
+        : m_pool{pool}
+    {
+    }
+
+    template<typename U>
+    PoolAllocator(const PoolAllocator<U> &other) noexcept
+        : m_pool{other.m_pool}
+    {
+    }
+
+    /**
+     * \brief Allocate storage for ``n`` objects.
+     * @param n number of objects
+     * @return storage, pooled if it fits a single block
+     */
+    [[nodiscard]] T *allocate(const size_t n)
+    {
+        if (fits(n)) {
+            return static_cast<T*>(m_pool->allocate());
+        }
+
+        return std::allocator<T>().allocate(n);
+    }
+
+    /**
+     * \brief Release storage for ``n`` objects.
+     * @param p storage returned by ``allocate``
+     * @param n number of objects
+     */
+    void deallocate(T *const p, const size_t n)
+    {
+        if (fits(n)) {
+            m_pool->release(p);
+        } else {
+            std::allocator<T>().deallocate(p, n);
+        }
+    }
+
+    template<typename U>
+    bool operator==(const PoolAllocator<U> &other) const noexcept
+    {
+        return m_pool == other.m_pool;
+    }
+
+    template<typename U>
+    bool operator!=(const PoolAllocator<U> &other) const noexcept
+    {
+        return m_pool != other.m_pool;
+    }
+
+private:
+
+    /**
+     * \brief Test if ``n`` objects fit in a pool block.
+     */
+    [[nodiscard]] bool fits(const size_t n) const noexcept
+    {
+        return (1U == n) && (sizeof(T) <= m_pool->block_size()) &&
+                (alignof(T) <= alignof(std::max_align_t));
+    }
+
+    BlockPool *m_pool;
+};
+
+#endif // BLOCK_POOL_H
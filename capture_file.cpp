@@ -0,0 +1,340 @@
+/**
+ * \file capture_file.cpp
+ * \brief Compact columnar binary recordings of register data
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <QDataStream>  //  QDataStream
+#include <QtEndian>  //  qToLittleEndian, qFromLittleEndian
+#include <algorithm>  //  std::min
+
+// C includes
+/* -none- */
+
+// project includes
+#include "capture_file.h"  //  local include
+#include "exceptions.h"  //  FileLoadException
+
+
+namespace {
+    const auto g_magic = quint32(0x43544D51U);  /**< "QMTC" */
+    const auto g_version = quint16(1U);
+    const auto g_header_size = qint64(20);  /**< magic, version, reserved, count, directory */
+    const auto g_entry_size = qint64(60);  /**< Directory entry per series */
+    const auto g_block_entries = size_t(65536U);  /**< Entries per compressed block */
+
+
+    /**
+     * \brief Position of a column written
+     */
+    struct ColumnPosition {
+        qint64 offset; /**< First block */
+        qint64 size; /**< Bytes in all blocks */
+    };
+
+
+    /**
+     * \brief Encode the times of a block: zig-zag deltas as base-128 varints.
+     * \note
+     * Each block starts from 0 so that it may be decoded on its own.
+     *
+     * @param first first time of the block
+     * @param count number of times
+     * @return encoded block
+     */
+    QByteArray encode_timestamps(const qint64 *const first, const size_t count)
+    {
+        QByteArray data;
+        data.reserve(int(count * 2U));
+        auto previous = qint64(0);
+        for (auto i=first; i<(first + count); ++i) {
+            const auto delta = *i - previous;
+            previous = *i;
+            auto zigzag = (quint64(delta) << 1U) ^ quint64(delta >> 63U);
+            while (zigzag >= 0x80U) {
+                data.append(char((zigzag & 0x7FU) | 0x80U));
+                zigzag >>= 7U;
+            }
+            data.append(char(zigzag));
+        }
+
+        return data;
+    }
+
+
+    /**
+     * \brief Encode the raw values of a block as little-endian 16-bit words.
+     * @param first first value of the block
+     * @param count number of values
+     * @return encoded block
+     */
+    QByteArray encode_values(const quint16 *const first, const size_t count)
+    {
+        QByteArray data(int(count * sizeof(quint16)), '\0');
+        for (size_t i=0; i<count; ++i) {
+            qToLittleEndian<quint16>(first[i], data.data() + (i * sizeof(quint16)));
+        }
+
+        return data;
+    }
+
+
+    /**
+     * \brief Compress and write the blocks of a column.
+     * @param file output file
+     * @param count number of entries
+     * @param encode encodes the entries [first, first + count) of a block
+     * @return column position
+     * @throws AppException if a block is not written in full
+     */
+    template<typename Encoder>
+    ColumnPosition write_column(QFile &file, const size_t count, Encoder encode)
+    {
+        const auto offset = file.pos();
+        for (size_t i=0; i<count; i+=g_block_entries) {
+            const auto entries = std::min(g_block_entries, count - i);
+            const auto block = qCompress(encode(i, entries));
+            char header[8];
+            qToLittleEndian<quint32>(quint32(entries), header);
+            qToLittleEndian<quint32>(quint32(block.size()), header + 4);
+            if ((file.write(header, sizeof(header)) != qint64(sizeof(header))) ||
+                (file.write(block) != qint64(block.size()))) {
+                throw AppException(file.errorString());
+            }
+        }
+
+        return {offset, file.pos() - offset};
+    }
+
+}  //  Anonymous namespace
+
+
+bool capture_file::write(const QString &path, const std::vector<CaptureSeries> &series)
+{
+    for (const auto &i: series) {
+        if (i.values.size() != (i.timestamps.size() * i.width)) {
+            return false;
+        }
+    }
+
+    QFile file(path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        return false;
+    }
+
+    //  The header is rewritten with the directory position once known.
+    QDataStream stream(&file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream << g_magic << g_version << quint16(0U) << quint32(series.size()) << qint64(0);
+
+    std::vector<std::pair<ColumnPosition, ColumnPosition>> columns;
+    columns.reserve(series.size());
+    for (const auto &i: series) {
+        const auto times = write_column(file, i.timestamps.size(), [&](const size_t first, const size_t count) {
+            return encode_timestamps(i.timestamps.data() + first, count);
+        });
+        const auto values = write_column(file, i.values.size(), [&](const size_t first, const size_t count) {
+            return encode_values(i.values.data() + first, count);
+        });
+        columns.push_back({times, values});
+    }
+
+    const auto directory = file.pos();
+    for (size_t i=0; i<series.size(); ++i) {
+        const auto &s = series[i];
+        stream << s.first_register << s.width << s.node << s.endpoint
+               << quint8(s.is_signed) << quint8(0U) << s.mult << s.offset
+               << quint32(s.timestamps.size())
+               << columns[i].first.offset << columns[i].first.size
+               << columns[i].second.offset << columns[i].second.size;
+    }
+
+    file.seek(0);
+    stream << g_magic << g_version << quint16(0U) << quint32(series.size()) << directory;
+
+    return (QDataStream::Ok == stream.status()) && file.flush();
+}
+
+
+CaptureReader::CaptureReader(const QString &path) :
+    m_file(path),
+    m_series(),
+    m_time_columns(),
+    m_value_columns()
+{
+    if (!m_file.open(QFile::ReadOnly)) {
+        throw FileLoadException(m_file.errorString(), path);
+    }
+
+    QDataStream stream(&m_file);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    quint32 magic;
+    quint16 version;
+    quint16 reserved;
+    quint32 count;
+    qint64 directory;
+    stream >> magic >> version >> reserved >> count >> directory;
+    if ((QDataStream::Ok != stream.status()) || (g_magic != magic) || (g_version != version) ||
+            (directory < g_header_size) ||
+            ((m_file.size() - directory) != (qint64(count) * g_entry_size))) {
+        throw FileLoadException(QString("Not a capture file"), path);
+    }
+
+    m_file.seek(directory);
+    m_series.reserve(count);
+    for (quint32 i=0U; i<count; ++i) {
+        CaptureSeries series{0U, 0U, 0U, 0U, false, 1.0, 0.0, 0U, {}, {}};
+        quint8 is_signed;
+        quint8 unused;
+        Column times;
+        Column values;
+        stream >> series.first_register >> series.width >> series.node >> series.endpoint
+               >> is_signed >> unused >> series.mult >> series.offset >> series.rows
+               >> times.offset >> times.size >> values.offset >> values.size;
+        series.is_signed = bool(is_signed);
+
+        for (const auto &column: {times, values}) {
+            if ((column.offset < g_header_size) || (column.size < 0) ||
+                    (column.offset + column.size > directory)) {
+                throw FileLoadException(QString("Corrupt capture directory"), path);
+            }
+        }
+
+        m_series.push_back(std::move(series));
+        m_time_columns.push_back(times);
+        m_value_columns.push_back(values);
+    }
+
+    if (QDataStream::Ok != stream.status()) {
+        throw FileLoadException(QString("Corrupt capture directory"), path);
+    }
+}
+
+
+size_t CaptureReader::size() const noexcept
+{
+    return m_series.size();
+}
+
+
+const CaptureSeries &CaptureReader::get_series(const size_t index) const
+{
+    return m_series.at(index);
+}
+
+
+std::vector<std::pair<quint32, QByteArray>> CaptureReader::read_column(const Column &column,
+                                                                       const int entry_size,
+                                                                       const quint64 expected)
+{
+    const auto corrupt = FileLoadException(QString("Corrupt capture column"), m_file.fileName());
+    if (!m_file.seek(column.offset)) {
+        throw corrupt;
+    }
+
+    const auto data = m_file.read(column.size);
+    if (qint64(data.size()) != column.size) {
+        throw corrupt;
+    }
+
+    std::vector<std::pair<quint32, QByteArray>> blocks;
+    quint64 total = 0U;
+    auto position = 0;
+    while (position < data.size()) {
+        if ((data.size() - position) < 8) {
+            throw corrupt;
+        }
+        const auto entries = qFromLittleEndian<quint32>(data.constData() + position);
+        const auto length = qFromLittleEndian<quint32>(data.constData() + position + 4);
+        position += 8;
+        if (length > quint32(data.size() - position)) {
+            throw corrupt;
+        }
+
+        auto block = qUncompress(reinterpret_cast<const uchar*>(data.constData() + position), int(length));
+        position += int(length);
+        if ((entry_size > 0) && (qint64(block.size()) != (qint64(entries) * entry_size))) {
+            throw corrupt;
+        }
+
+        total += entries;
+        blocks.push_back({entries, std::move(block)});
+    }
+
+    if (total != expected) {
+        throw corrupt;
+    }
+
+    return blocks;
+}
+
+
+std::vector<qint64> CaptureReader::read_timestamps(const size_t index)
+{
+    const auto &series = m_series.at(index);
+    const auto blocks = read_column(m_time_columns.at(index), 0, series.rows);
+
+    std::vector<qint64> timestamps;
+    timestamps.reserve(series.rows);
+    for (const auto &block: blocks) {
+        const auto data = reinterpret_cast<const uchar*>(block.second.constData());
+        const auto end = data + block.second.size();
+        auto position = data;
+        auto previous = qint64(0);
+        for (quint32 i=0U; i<block.first; ++i) {
+            quint64 zigzag = 0U;
+            auto shift = 0U;
+            do {
+                if ((position >= end) || (shift > 63U)) {
+                    throw FileLoadException(QString("Corrupt capture column"), m_file.fileName());
+                }
+                zigzag |= quint64(*position & 0x7FU) << shift;
+                shift += 7U;
+            } while ((*(position++) & 0x80U) != 0U);
+
+            previous += qint64(zigzag >> 1U) ^ -qint64(zigzag & 1U);
+            timestamps.push_back(previous);
+        }
+    }
+
+    return timestamps;
+}
+
+
+std::vector<quint16> CaptureReader::read_values(const size_t index)
+{
+    const auto &series = m_series.at(index);
+    const auto blocks = read_column(m_value_columns.at(index), int(sizeof(quint16)),
+                                    quint64(series.rows) * series.width);
+
+    std::vector<quint16> values;
+    values.reserve(size_t(series.rows) * series.width);
+    for (const auto &block: blocks) {
+        const auto data = block.second.constData();
+        for (quint32 i=0U; i<block.first; ++i) {
+            values.push_back(qFromLittleEndian<quint16>(data + (i * sizeof(quint16))));
+        }
+    }
+
+    return values;
+}
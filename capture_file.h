@@ -0,0 +1,175 @@
+/**
+ * \file capture_file.h
+ * \brief Compact columnar binary recordings of register data
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * A capture holds one or more series, each a block of ``width`` consecutive
+ * registers sampled at a number of times (a trend line is 1 register wide, a
+ * saved register window is 1 row of every register in the window).  The
+ * times and the raw register values of each series are stored as separate
+ * columns:
+ * - times: milliseconds since the Unix epoch, delta and varint encoded.
+ * - values: raw 16-bit little-endian values, row after row.
+ *
+ * Each column is split into blocks of 65536 entries compressed on their own
+ * (zlib).  A directory at the end of the file gives the position of every
+ * column so that a reader can load one column without decoding any other.
+ */
+
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+//  c++ includes
+#include <QByteArray>  //  QByteArray
+#include <QFile>  //  QFile
+#include <QString>  //  QString
+#include <utility>  //  std::pair
+#include <vector>  //  std::vector
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+/**
+ * \brief Registers sampled together
+ */
+struct CaptureSeries {
+    quint16 first_register; /**< Register number of the first column (eg: 40001) */
+
+    quint16 width; /**< Registers sampled in each row */
+
+    quint8 node; /**< Node / device ID */
+
+    quint8 endpoint; /**< Endpoint */
+
+    bool is_signed; /**< Display the values as signed */
+
+    double mult; /**< Display scale (trend lines) */
+
+    double offset; /**< Display offset (trend lines) */
+
+    quint32 rows; /**< Number of samples (set by the reader) */
+
+    std::vector<qint64> timestamps; /**< Row times (ms since the Unix epoch) */
+
+    std::vector<quint16> values; /**< Raw values, ``width`` per row */
+};
+
+
+namespace capture_file {
+
+    const auto SUFFIX = "qmc"; /**< File name extension */
+
+    /**
+     * \brief Write a capture file.
+     * @param path file to write
+     * @param series series to write, ``rows`` is ignored
+     * @return ``true`` if written successfully
+     * @throws AppException if the file cannot be written in full
+     */
+    [[nodiscard]] bool write(const QString &path, const std::vector<CaptureSeries> &series);
+
+}  //  namespace capture_file
+
+
+/**
+ * \brief Capture file reader
+ * \note
+ * Only the directory is read when the file is opened, columns are read and
+ * decoded on request.
+ */
+class CaptureReader
+{
+public:
+
+    /**
+     * \brief constructor
+     * @param path capture file
+     * @throws FileLoadException if the file is not a valid capture
+     */
+    explicit CaptureReader(const QString &path);
+
+    /**
+     * \brief Get the number of series in the file
+     * @return series count
+     */
+    [[nodiscard]] size_t size() const noexcept;
+
+    /**
+     * \brief Get the description of a series
+     * @param index series index
+     * @return series with its timestamps and values left empty
+     */
+    [[nodiscard]] const CaptureSeries &get_series(const size_t index) const;
+
+    /**
+     * \brief Read the times of a series
+     * @param index series index
+     * @return one time per row (ms since the Unix epoch)
+     * @throws FileLoadException if the column is corrupt
+     */
+    [[nodiscard]] std::vector<qint64> read_timestamps(const size_t index);
+
+    /**
+     * \brief Read the raw values of a series
+     * @param index series index
+     * @return ``width`` values per row
+     * @throws FileLoadException if the column is corrupt
+     */
+    [[nodiscard]] std::vector<quint16> read_values(const size_t index);
+
+private:
+
+    /**
+     * \brief Position of a column in the file
+     */
+    struct Column {
+        qint64 offset; /**< First block */
+        qint64 size; /**< Bytes in all blocks */
+    };
+
+    /**
+     * \brief Read and uncompress the blocks of a column
+     * @param column column to read
+     * @param entry_size bytes per entry once uncompressed (0 = variable)
+     * @param expected number of entries expected
+     * @return uncompressed blocks {entries, data}
+     * @throws FileLoadException if the column is corrupt
+     */
+    [[nodiscard]] std::vector<std::pair<quint32, QByteArray>> read_column(const Column &column,
+                                                                          const int entry_size,
+                                                                          const quint64 expected);
+
+    QFile m_file;
+    std::vector<CaptureSeries> m_series;
+    std::vector<Column> m_time_columns;
+    std::vector<Column> m_value_columns;
+};
+
+
+#endif // CAPTURE_FILE_H
@@ -32,11 +32,17 @@
 
 // project includes
 #include "coils_display.h"  //  local include
+#include "packed_bits.h"  //  packed_bits::get, packed_bits::set
+
+
+namespace {
+    const auto g_coil_table_size = size_t(10000);  /**< Coils 1 - 9999 */
+}  //  Anonymous namespace
 
 
 CoilsDisplay::CoilsDisplay(QWidget *parent, const quint16 base_reg, const quint16 count, const quint8 uid)
     :RegisterDisplay(parent, base_reg, count, uid),
-      m_remote_state()
+      m_remote_state(packed_bits::get_word_count(g_coil_table_size), 0U)
 {
 
 }
@@ -45,10 +51,14 @@ CoilsDisplay::CoilsDisplay(QWidget *parent, const quint16 base_reg, const quint1
 void CoilsDisplay::updateRegisterValue(const size_t index, const QString &value)
 {
     static_cast<void>(value);
-    auto widget = dynamic_cast<QCheckBox*>(m_register_values[index]);
     auto bvalue = (m_raw_values[index] > 0);
-    m_remote_state[quint16(index + m_starting_register)] = bvalue;
-    widget->setChecked(bvalue);
+    packed_bits::set(m_remote_state, index + m_starting_register, bvalue);
+    if (m_table_view) {
+        m_model->set_value(int(index), (bvalue ? "1" : "0"));
+    } else {
+        auto widget = dynamic_cast<QCheckBox*>(m_register_values[index]);
+        widget->setChecked(bvalue);
+    }
 }
 
 
@@ -71,9 +81,23 @@ QWidget* CoilsDisplay::create_value_widget(const quint16 index, const bool initi
 void CoilsDisplay::on_checkbox_checked(quint16 index)
 {
     const auto checkbox = dynamic_cast<QCheckBox*>(m_register_values[index]);
-    const auto a = m_remote_state[index + m_starting_register];
-    const auto b = checkbox->isChecked();
+    request_write(index, checkbox->isChecked());
+}
+
+
+void CoilsDisplay::on_table_value_edited(const int row, const QString value)
+{
+    request_write(quint16(row), value == "1");
+}
+
+
+void CoilsDisplay::request_write(const quint16 index, const bool checked)
+{
+    const auto a = packed_bits::get(m_remote_state, index + m_starting_register);
+    const auto b = checked;
     if (a != b) {
+        //  Show the polled state again should the write not take effect.
+        invalidate_register(index);
         WriteRequest req{};
         req.first_register = m_starting_register + index;
         req.node = m_node;
@@ -110,6 +134,10 @@ bool CoilsDisplay::load_configuration_parameters(const QDomElement &node)
 
 QString CoilsDisplay::get_display_value(const size_t index) const
 {
+    if (m_table_view) {
+        return (m_model->get_value(int(index)) == "1" ? "1" : "0");
+    }
+
     auto widget = dynamic_cast<QCheckBox*>(m_register_values[index]);
     return (widget->isChecked() ? "1" : "0");
 }
@@ -120,3 +148,9 @@ QString CoilsDisplay::get_register_number_text(const quint16 reg_number)
     const auto padding = QString(5 - base_text.size(), QChar('0'));
     return padding % base_text;
 }
+
+
+RegisterTableModel::ValueEditor CoilsDisplay::get_value_editor() const
+{
+    return RegisterTableModel::EDITOR_CHECKBOX;
+}
@@ -32,7 +32,7 @@
 #define COILSDISPLAY_H
 
 //  c++ includes
-#include <unordered_map>  //  std::unordered_map
+#include <vector>  //  std::vector
 
 // C includes
 /* -none- */
@@ -66,6 +66,10 @@ protected:
     virtual QWidget* create_value_widget(const quint16 index, const bool initial) override;
     virtual QString get_display_value(const size_t index) const override;
     [[nodiscard]] virtual QString get_register_number_text(const quint16 reg_number) override;
+    [[nodiscard]] virtual RegisterTableModel::ValueEditor get_value_editor() const override;
+
+protected slots:
+    virtual void on_table_value_edited(const int row, const QString value) override;
 
 private slots:
     /**
@@ -82,7 +86,14 @@ private slots:
     void on_register_destroyed(QWidget *register_widget, const quint16 index);
 
 private:
-    std::unordered_map<quint16, bool> m_remote_state;
+    /**
+     * \brief Request a write if a coil differs from the last value polled.
+     * @param index register index in window
+     * @param checked state selected by the user
+     */
+    void request_write(const quint16 index, const bool checked);
+
+    std::vector<quint64> m_remote_state; /**< Coil states shown, packed by register number */
 
 };
 
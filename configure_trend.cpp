@@ -37,7 +37,7 @@
 
 
 namespace {
-    const auto g_max_points = 1000000;  //  some arbitrary limit.
+    const auto g_max_points = 10000000;  //  some arbitrary limit.
 }
 
 
@@ -28,6 +28,7 @@
 #include <QColorDialog>  //  QColorDialog
 #include <QMessageBox>  //  QMessageBox
 #include <QStringBuilder>  //  operator%
+#include <chrono>  //  std::chrono::milliseconds
 
 // C includes
 /* -none- */
@@ -72,6 +73,9 @@ void ConfigureTrendLine::setupUi()
         m_ui->RegEdit->setEnabled(false);
         m_ui->NodeEdit->setValue(int(m_trend->m_device_id));
         m_ui->NodeEdit->setEnabled(false);
+        m_ui->EndpointEdit->setValue(int(m_trend->m_endpoint));
+        m_ui->EndpointEdit->setEnabled(false);
+        m_ui->PeriodEdit->setValue(int(m_trend->m_poll_period.count()));
         m_ui->SignedEdit->setChecked(m_trend->m_signed_value);
         m_ui->MultBox->setText(QString::number(m_trend->m_mult));
         m_ui->OffsetBox->setText(QString::number(m_trend->m_offset));
@@ -113,6 +117,10 @@ void ConfigureTrendLine::on_Accept_pressed()
     if (nullptr != m_trend) {
         m_trend->configure(m, b, m_ui->SignedEdit->isChecked());
         m_trend->set_color(m_display_color);
+        if (m_trend->m_poll_period.count() != m_ui->PeriodEdit->value()) {
+            m_trend->set_poll_period(std::chrono::milliseconds(m_ui->PeriodEdit->value()));
+            emit m_parent->poll_configuration_changed(m_parent);
+        }
     }
 
     accept();
@@ -160,10 +168,12 @@ TrendLine* ConfigureTrendLine::create_trend()
     const auto m = m_ui->MultBox->text().toDouble();
     const auto b = m_ui->OffsetBox->text().toDouble();
     const auto node = m_ui->NodeEdit->value();
+    const auto endpoint = m_ui->EndpointEdit->value();
     const auto reg = m_ui->RegEdit->text().toInt();
-    auto trend = new TrendLine(m_parent, quint16(reg), quint8(node));
+    auto trend = new TrendLine(m_parent, quint16(reg), quint8(node), quint8(endpoint));
     trend->configure(m, b, m_ui->SignedEdit->isChecked());
     trend->set_color(m_display_color);
+    trend->set_poll_period(std::chrono::milliseconds(m_ui->PeriodEdit->value()));
     m_trend = trend;
 
     return trend;
@@ -173,7 +183,8 @@ TrendLine* ConfigureTrendLine::create_trend()
 ConfigureTrendLine::operator quint32() const
 {
     return m_parent->get_key(quint16(m_ui->RegEdit->text().toUInt()),
-                             quint8(m_ui->NodeEdit->value()));
+                             quint8(m_ui->NodeEdit->value()),
+                             quint8(m_ui->EndpointEdit->value()));
 }
 
 
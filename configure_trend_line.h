@@ -75,7 +75,7 @@ public:
     [[nodiscard]] TrendLine* create_trend();
 
     /**
-     * @brief get the key (IE node<<16|reg)
+     * @brief get the key (IE endpoint<<24|node<<16|reg)
      */
     operator quint32() const;
 
@@ -0,0 +1,359 @@
+/**
+ * \file csv_stream_reader.cpp
+ * \brief Stream register values from a CSV file on a worker thread
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <QByteArray>  //  QByteArray
+#include <QFile>  //  QFile
+#include <algorithm>  //  std::max
+#include <limits>  //  std::numeric_limits
+#include <utility>  //  std::move
+
+// C includes
+/* -none- */
+
+// project includes
+#include "csv_stream_reader.h"  //  local include
+#include "exceptions.h"  //  FileLoadException
+
+
+namespace {
+    const auto g_chunk_size = qint64(256 * 1024);  /**< Bytes read at a time */
+    const auto g_queued_chunks = size_t(8U);  /**< Chunks parsed ahead of the writes */
+    const auto g_full_wait_ms = 5UL;  /**< Wait for room in the ring */
+
+
+    /**
+     * \brief Call ``f`` for each complete line in a block of text.
+     * \note
+     * Line breaks inside quoted fields do not end the line.  A trailing
+     * carriage return is not part of the line.
+     *
+     * @param begin start of the text (must be the start of a line)
+     * @param end end of the text
+     * @param f called as ``f(line_begin, line_end)``
+     * @return start of the incomplete line following the last complete one
+     */
+    template<typename F>
+    const char *for_each_line(const char *begin, const char *const end, F &&f)
+    {
+        auto in_quotes = false;
+        auto line = begin;
+        for (auto i=begin; i<end; ++i) {
+            if ('"' == *i) {
+                in_quotes = !in_quotes;
+            } else if (('\n' == *i) && !in_quotes) {
+                f(line, (i > line && '\r' == i[-1]) ? i - 1 : i);
+                line = i + 1;
+            } else {}
+        }
+
+        return line;
+    }
+
+
+    /**
+     * \brief Call ``f`` for each field of a line.
+     * @param begin start of the line
+     * @param end end of the line
+     * @param f called as ``f(index, field_begin, field_end, quoted)``, the
+     *        enclosing quotes are not part of the field; return ``false`` to
+     *        stop
+     */
+    template<typename F>
+    void for_each_field(const char *begin, const char *const end, F &&f)
+    {
+        for (size_t index=0U; ; ++index) {
+            const auto quoted = (begin < end) && ('"' == *begin);
+            auto field_begin = begin;
+            auto field_end = begin;
+            if (quoted) {
+                field_begin = ++begin;
+                //  A doubled quote is an escaped quote.
+                while ((begin < end) &&
+                       (('"' != *begin) || ((begin + 1 < end) && ('"' == begin[1])))) {
+                    begin += ('"' == *begin) ? 2 : 1;
+                }
+                field_end = begin;
+                while ((begin < end) && (',' != *begin)) {
+                    ++begin;
+                }
+            } else {
+                while ((begin < end) && (',' != *begin)) {
+                    ++begin;
+                }
+                field_end = begin;
+            }
+
+            if (!f(index, field_begin, field_end, quoted) || (begin >= end)) {
+                return;
+            }
+            ++begin;
+        }
+    }
+
+
+    /**
+     * \brief Convert a field to an integer.
+     * \note
+     * Follows ``QString::toInt``: surrounding spaces are ignored and a field
+     * that is not a (base 10) number reads as 0.
+     *
+     * @param begin start of the field
+     * @param end end of the field
+     * @return value
+     */
+    int parse_int(const char *begin, const char *end) noexcept
+    {
+        while ((begin < end) && ((' ' == *begin) || ('\t' == *begin))) {
+            ++begin;
+        }
+        while ((end > begin) && ((' ' == end[-1]) || ('\t' == end[-1]))) {
+            --end;
+        }
+
+        auto negative = false;
+        if ((begin < end) && (('-' == *begin) || ('+' == *begin))) {
+            negative = ('-' == *begin);
+            ++begin;
+        }
+
+        if (begin == end) {
+            return 0;
+        }
+
+        qint64 value = 0;
+        for (; begin<end; ++begin) {
+            if ((*begin < '0') || (*begin > '9')) {
+                return 0;
+            }
+
+            value = (value * 10) + (*begin - '0');
+            if (value > std::numeric_limits<int>::max()) {
+                return 0;
+            }
+        }
+
+        return int(negative ? -value : value);
+    }
+
+}  //  Anonymous namespace
+
+
+CsvStreamReader::CsvStreamReader(QObject *parent,
+                                 const QString &path,
+                                 const size_t value_index,
+                                 const size_t register_index,
+                                 const ssize_t node_index,
+                                 const bool skip_first_row) :
+    QObject(parent),
+    m_thread{QThread::create([this]() { run(); })},
+    m_chunks(g_queued_chunks),
+    m_path(path),
+    m_value_index{value_index},
+    m_register_index{register_index},
+    m_node_index{node_index},
+    m_skip_first_row{skip_first_row},
+    m_chunk{},
+    m_writable{},
+    m_plan{{}, 0U, 0U}
+{
+    m_thread->setParent(this);
+}
+
+
+CsvStreamReader::~CsvStreamReader()
+{
+    cancel();
+    m_thread->wait();
+}
+
+
+QList<QStringList> CsvStreamReader::read_preview(const QString &path, const int rows)
+{
+    QFile file(path);
+    if (!file.open(QFile::ReadOnly)) {
+        throw FileLoadException(file.errorString(), path);
+    }
+
+    QList<QStringList> preview;
+    QByteArray buffer;
+    const auto add_row = [&](const char *const begin, const char *const end) {
+        if ((begin == end) || (preview.size() >= rows)) {
+            return;
+        }
+
+        QStringList row;
+        for_each_field(begin, end, [&](const size_t, const char *const field_begin,
+                                       const char *const field_end, const bool quoted) {
+            auto text = QString::fromUtf8(field_begin, int(field_end - field_begin));
+            row << (quoted ? text.replace("\"\"", "\"") : text);
+            return true;
+        });
+        preview << row;
+    };
+
+    while ((preview.size() < rows) && !file.atEnd()) {
+        buffer += file.read(g_chunk_size);
+        const auto rest = for_each_line(buffer.constData(), buffer.constData() + buffer.size(),
+                                        add_row);
+        buffer.remove(0, int(rest - buffer.constData()));
+    }
+    add_row(buffer.constData(), buffer.constData() + buffer.size());
+
+    if (preview.isEmpty()) {
+        throw FileLoadException(QString("Empty file"), path);
+    }
+
+    return preview;
+}
+
+
+void CsvStreamReader::start()
+{
+    m_thread->start();
+}
+
+
+void CsvStreamReader::cancel() noexcept
+{
+    m_cancel = true;
+}
+
+
+bool CsvStreamReader::take_chunk(CsvChunk &chunk)
+{
+    return m_chunks.try_pop(chunk);
+}
+
+
+WritePlan CsvStreamReader::take_plan()
+{
+    return std::move(m_plan);
+}
+
+
+void CsvStreamReader::run()
+{
+    QFile file(m_path);
+    if (!file.open(QFile::ReadOnly)) {
+        emit finished(false, file.errorString());
+        return;
+    }
+
+    const auto total = std::max(file.size(), qint64(1));
+    auto skip_row = m_skip_first_row;
+    const auto parse = [&](const char *const begin, const char *const end) {
+        if (skip_row) {
+            skip_row = false;
+        } else {
+            parse_line(begin, end);
+        }
+    };
+
+    QByteArray buffer;
+    auto done = false;
+    while (!done) {
+        const auto data = file.read(g_chunk_size);
+        if ((data.isEmpty()) && (file.error() != QFile::NoError)) {
+            emit finished(false, file.errorString());
+            return;
+        }
+
+        buffer += data;
+        done = file.atEnd();
+        const auto rest = for_each_line(buffer.constData(), buffer.constData() + buffer.size(),
+                                        parse);
+        buffer.remove(0, int(rest - buffer.constData()));
+        if (done) {
+            //  The last line need not end with a line break.
+            parse(buffer.constData(), buffer.constData() + buffer.size());
+        }
+
+        m_chunk.percent = int((file.pos() * 100) / total);
+        if (!push_chunk()) {
+            emit finished(false, QString());
+            return;
+        }
+    }
+
+    m_plan = write_planner::plan(std::move(m_writable));
+    emit finished(true, QString());
+}
+
+
+void CsvStreamReader::parse_line(const char *const begin, const char *const end)
+{
+    //  Fixed node is stored as -(node + 1).
+    auto node = (m_node_index < 0) ? int(-m_node_index - 1) : 0;
+    auto reg = 0;
+    auto value = 0;
+    auto found = 0;
+    const auto wanted = (m_node_index < 0) ? 2 : 3;
+    const auto last = std::max({m_value_index, m_register_index,
+                                (m_node_index < 0) ? size_t(0U) : size_t(m_node_index)});
+    for_each_field(begin, end, [&](const size_t index, const char *const field_begin,
+                                   const char *const field_end, const bool) {
+        if (index == m_register_index) {
+            reg = parse_int(field_begin, field_end);
+            ++found;
+        }
+        if (index == m_value_index) {
+            value = parse_int(field_begin, field_end);
+            ++found;
+        }
+        if ((m_node_index >= 0) && (index == size_t(m_node_index))) {
+            node = parse_int(field_begin, field_end);
+            ++found;
+        }
+        return index < last;
+    });
+
+    //  Blank or short lines carry no value.
+    if (found < wanted) {
+        return;
+    }
+
+    const auto v = WriteValue{quint8(node), quint16(reg), quint16(value)};
+    m_chunk.values.push_back(v);
+    if (write_planner::is_writable(v.reg)) {
+        m_writable.push_back(v);
+    }
+}
+
+
+bool CsvStreamReader::push_chunk()
+{
+    while (!m_chunks.try_push(std::move(m_chunk))) {
+        if (m_cancel) {
+            return false;
+        }
+
+        QThread::msleep(g_full_wait_ms);
+    }
+
+    m_chunk = CsvChunk{};
+    emit chunk_ready();
+    return !m_cancel;
+}
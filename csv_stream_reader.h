@@ -0,0 +1,188 @@
+/**
+ * \file csv_stream_reader.h
+ * \brief Stream register values from a CSV file on a worker thread
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * Register restore files may hold millions of rows.  Rather than decoding the
+ * whole file into a list of strings before the first write is sent, the
+ * reader works through the file in fixed-size chunks on its own thread,
+ * converting only the selected fields straight from the bytes read.  The
+ * values of each chunk are handed to the main thread through a bounded ring
+ * (\sa SpscRing) while the next one is parsed; the reader waits while the
+ * ring is full.  Once the whole file is read the values are packed into write
+ * requests (\sa write_planner) on the same thread, ready for ``take_plan``.
+ *
+ * Fields follow the same rules as the spreadsheet parser: separated by
+ * commas, optionally enclosed in double quotes.  A field that is not a number
+ * reads as 0.
+ */
+
+#ifndef CSV_STREAM_READER_H
+#define CSV_STREAM_READER_H
+
+//  c++ includes
+#include <QList>  //  QList
+#include <QObject>  //  QObject
+#include <QString>  //  QString
+#include <QStringList>  //  QStringList
+#include <QThread>  //  QThread
+#include <atomic>  //  std::atomic
+#include <vector>  //  std::vector
+
+// C includes
+/* -none- */
+
+// project includes
+#include "spsc_ring.h"  //  SpscRing
+#include "write_planner.h"  //  WritePlan, WriteValue
+
+
+/**
+ * \brief Rows parsed from one chunk of the file
+ */
+struct CsvChunk {
+    std::vector<WriteValue> values; /**< Every value read, in file order */
+
+    int percent; /**< Part of the file read, 0-100 */
+};
+
+
+/**
+ * \brief CSV register data read on its own thread
+ */
+class CsvStreamReader : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * \brief constructor
+     * @param parent parent QObject owner
+     * @param path file to read
+     * @param value_index index of field to interpret as the "value"
+     * @param register_index index of field to interpret as the "register number"
+     * @param node_index when >= 0 index of the field to interpret as the "Device ID"
+     *                   when < 0 the absolute value is \f node + 1 \f
+     * @param skip_first_row set ``true`` to skip the first row
+     */
+    CsvStreamReader(QObject *parent,
+                    const QString &path,
+                    const size_t value_index,
+                    const size_t register_index,
+                    const ssize_t node_index,
+                    const bool skip_first_row);
+
+    /**
+     * \brief Read the first rows of a file to preview the columns.
+     * @param path file to read
+     * @param rows maximum number of rows
+     * @throws FileLoadException if the file cannot be read or is empty
+     * @return fields of each row read
+     */
+    [[nodiscard]] static QList<QStringList> read_preview(const QString &path, const int rows);
+
+    /**
+     * \brief Start reading the file.
+     */
+    void start();
+
+    /**
+     * \brief Stop reading as soon as possible (``finished`` is still emitted).
+     */
+    void cancel() noexcept;
+
+    /**
+     * \brief Take the next chunk parsed (main thread only).
+     * @param chunk [out] updated with the chunk removed
+     * @return ``true`` if a chunk was available
+     */
+    [[nodiscard]] bool take_chunk(CsvChunk &chunk);
+
+    /**
+     * \brief Take the writes planned for the file (once ``finished``).
+     * @return planned writes, empty if the read failed
+     */
+    [[nodiscard]] WritePlan take_plan();
+
+    /**
+     * \brief destructor
+     * \note
+     * Cancels and waits for the reader thread.
+     */
+    ~CsvStreamReader() override;
+
+signals:
+
+    /**
+     * \brief One or more chunks are waiting in ``take_chunk``
+     */
+    void chunk_ready();
+
+    /**
+     * \brief Read complete, all chunks have been queued.
+     * @param success ``true`` if the whole file was read
+     * @param error reason for failure, empty if cancelled
+     */
+    void finished(const bool success, const QString error);
+
+private:
+
+    /**
+     * \brief Thread main.
+     */
+    void run();
+
+    /**
+     * \brief Parse one line and append its value to the chunk.
+     * @param begin first character of the line
+     * @param end character following the line (end of line excluded)
+     */
+    void parse_line(const char *begin, const char *end);
+
+    /**
+     * \brief Queue the chunk for the main thread, waiting for room if needed.
+     * @return ``false`` if cancelled
+     */
+    bool push_chunk();
+
+    QThread *const m_thread;
+    std::atomic<bool> m_cancel{false};
+    SpscRing<CsvChunk> m_chunks;
+    const QString m_path;
+    const size_t m_value_index;
+    const size_t m_register_index;
+    const ssize_t m_node_index;
+    const bool m_skip_first_row;
+
+    /* Reader thread only */
+    CsvChunk m_chunk;
+    std::vector<WriteValue> m_writable;  /**< Values to plan, in file order */
+
+    /* Written by the reader thread before ``finished`` */
+    WritePlan m_plan;
+};
+
+#endif // CSV_STREAM_READER_H
@@ -0,0 +1,175 @@
+/**
+ * \file endpoints_dialog.cpp
+ * \brief Edit the list of devices polled by the session.
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <QMessageBox>  //  QMessageBox
+#include <QHeaderView>  //  QHeaderView
+#include <QStringList>  //  QStringList
+
+// C includes
+/* -none- */
+
+// project includes
+#include "endpoints_dialog.h"  //  local include
+#include "exceptions.h"  //  AppException
+
+
+namespace {
+    const auto g_max_endpoints = 256;  /**< Endpoint index is a quint8 */
+    const auto g_default_port = quint16(502);
+}  //  Anonymous namespace
+
+
+EndpointsDialog::EndpointsDialog(QWidget *parent, const std::vector<EndpointAddress> &endpoints)
+    : BaseDialog(parent),
+      m_table{new QTableWidget(0, 2, this)},
+      m_grid_container{new QWidget(this)},
+      m_control_grid{new QGridLayout(m_grid_container)},
+      m_add{new QPushButton(tr("Add"), m_grid_container)},
+      m_remove{new QPushButton(tr("Remove Last"), m_grid_container)},
+      m_ok{new QPushButton(tr("Ok"), m_grid_container)},
+      m_cancel{new QPushButton(tr("Cancel"), m_grid_container)},
+      m_endpoints{}
+{
+    m_table->setHorizontalHeaderLabels({tr("Host"), tr("Port")});
+    for (const auto &i: endpoints) {
+        append_row(i);
+    }
+
+    connect(m_ok, &QPushButton::clicked, this, &EndpointsDialog::on_ok_clicked);
+    connect(m_cancel, &QPushButton::clicked, this, &EndpointsDialog::close);
+    connect(m_add, &QPushButton::clicked, this, &EndpointsDialog::on_add_clicked);
+    connect(m_remove, &QPushButton::clicked, this, &EndpointsDialog::on_remove_clicked);
+}
+
+
+void EndpointsDialog::setupUi()
+{
+    m_top_layout->addWidget(m_table);
+    m_top_layout->addWidget(m_grid_container);
+    m_top_layout->setSizeConstraint(QLayout::SetMinimumSize);
+    m_top_layout->setContentsMargins(0, 0, 0, 0);
+    setContentsMargins(0, 0, 0, 0);
+
+    m_table->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    m_table->horizontalHeader()->setStretchLastSection(true);
+
+    m_grid_container->setLayout(m_control_grid);
+    m_control_grid->addWidget(m_add, 0, 0);
+    add_icon_to_button(m_add, QStyle::SP_FileDialogNewFolder);
+    m_control_grid->addWidget(m_remove, 0, 2);
+    add_icon_to_button(m_remove, QStyle::SP_TrashIcon);
+    m_control_grid->addWidget(m_ok, 1, 0);
+    add_icon_to_button(m_ok, QStyle::SP_DialogApplyButton);
+    m_control_grid->addWidget(m_cancel, 1, 2);
+    add_icon_to_button(m_cancel, QStyle::SP_DialogCloseButton);
+    m_remove->setEnabled(m_table->rowCount() > 1);
+    m_table->show();
+    m_grid_container->show();
+    m_table->resizeColumnsToContents();
+    resize(360, 280);
+    setWindowTitle(tr("Endpoints"));
+}
+
+
+void EndpointsDialog::append_row(const EndpointAddress &endpoint)
+{
+    const auto row = m_table->rowCount();
+    m_table->insertRow(row);
+    m_table->setItem(row, 0, new QTableWidgetItem(endpoint.first));
+    m_table->setItem(row, 1, new QTableWidgetItem(QString::number(endpoint.second)));
+
+    //  Endpoints are referenced by index, not by the 1-based row number.
+    m_table->setVerticalHeaderItem(row, new QTableWidgetItem(QString::number(row)));
+}
+
+
+void EndpointsDialog::on_add_clicked()
+{
+    if (m_table->rowCount() < g_max_endpoints) {
+        append_row({m_table->item(m_table->rowCount() - 1, 0)->text(), g_default_port});
+    }
+    m_add->setEnabled(m_table->rowCount() < g_max_endpoints);
+    m_remove->setEnabled(m_table->rowCount() > 1);
+}
+
+
+void EndpointsDialog::on_remove_clicked()
+{
+    //  Only the last entry may be removed so that the index of every other
+    // endpoint (and the windows bound to them) is preserved.
+    if (m_table->rowCount() > 1) {
+        m_table->removeRow(m_table->rowCount() - 1);
+    }
+    m_add->setEnabled(m_table->rowCount() < g_max_endpoints);
+    m_remove->setEnabled(m_table->rowCount() > 1);
+}
+
+
+void EndpointsDialog::on_ok_clicked()
+{
+    QStringList error_text;
+    std::vector<EndpointAddress> endpoints;
+    endpoints.reserve(size_t(m_table->rowCount()));
+    for (auto row=0; row<m_table->rowCount(); ++row) {
+        const auto host = m_table->item(row, 0)->text().trimmed();
+        bool ok;
+        const auto port = m_table->item(row, 1)->text().toInt(&ok);
+        if (host.isEmpty()) {
+            error_text << tr("No host for endpoint %1").arg(row);
+        }
+
+        if (!ok || port < 1 || port > 65535) {
+            error_text << tr("Illegal port for endpoint %1").arg(row);
+        }
+
+        endpoints.push_back({host, quint16(port)});
+    }
+
+    if (error_text.size() == 0) {
+        m_endpoints = std::move(endpoints);
+        m_is_valid = true;
+        emit accept();
+    } else {
+        auto error_box = QMessageBox(this);
+        error_box.setIcon(QMessageBox::Critical);
+        error_box.setStandardButtons(QMessageBox::Ok);
+        error_box.setText(tr("Invalid endpoint configuration specified"));
+        error_box.setInformativeText(tr("Errors were detected"));
+        error_box.setWindowTitle(tr("Invalid Configuration"));
+        error_box.setDetailedText(error_text.join('\n'));
+        error_box.exec();
+    }
+}
+
+
+const std::vector<EndpointAddress> &EndpointsDialog::get_endpoints() const
+{
+    if (!m_is_valid) {
+        throw AppException("Requested invalid configuration");
+    }
+
+    return m_endpoints;
+}
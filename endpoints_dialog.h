@@ -0,0 +1,123 @@
+/**
+ * \file endpoints_dialog.h
+ * \brief Edit the list of devices polled by the session.
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * A session may talk to several Modbus/TCP devices at once.  Each device is an
+ * "endpoint" identified by its position in the list: register windows and
+ * trend lines refer to the endpoint by that index.  Endpoint 0 is always the
+ * host/port shown in the main window.
+ */
+
+#ifndef ENDPOINTS_DIALOG_H
+#define ENDPOINTS_DIALOG_H
+
+//  c++ includes
+#include <QString>  //  QString
+#include <QGridLayout>  //  QGridLayout
+#include <QTableWidget>  //  QTableWidget
+#include <QPushButton>  //  QPushButton
+#include <utility>  //  std::pair
+#include <vector>  //  std::vector
+
+// C includes
+/* -none- */
+
+// project includes
+#include "base_dialog.h"  //  BaseDialog
+
+
+/**
+ * \brief Remote device address {host, port}
+ */
+using EndpointAddress = std::pair<QString, quint16>;
+
+
+/**
+ * \brief Endpoint list editor
+ */
+class EndpointsDialog : public BaseDialog
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * \brief constructor
+     * @param parent parent QObject owner
+     * @param endpoints current endpoint list (must contain at least 1 entry)
+     */
+    EndpointsDialog(QWidget *parent, const std::vector<EndpointAddress> &endpoints);
+
+    /**
+     * \brief Get the endpoints configured.
+     * @throws AppException if the dialog is not "finished"
+     * @return endpoint list, index 0 first
+     */
+    [[nodiscard]] const std::vector<EndpointAddress> &get_endpoints() const;
+
+private slots:
+
+    /**
+     * \brief OK Button clicked - verify input
+     */
+    void on_ok_clicked();
+
+    /**
+     * \brief Add Button clicked - append a new endpoint
+     */
+    void on_add_clicked();
+
+    /**
+     * \brief Remove Button clicked - remove the last endpoint
+     */
+    void on_remove_clicked();
+
+private:
+
+    /**
+     * \brief Initialize the UI components.
+     */
+    void setupUi() override;
+
+    /**
+     * \brief Append a row to the table.
+     * @param endpoint row contents
+     */
+    void append_row(const EndpointAddress &endpoint);
+
+    bool m_is_valid = false;
+    QTableWidget *const m_table;
+    QWidget *const m_grid_container;
+    QGridLayout *const m_control_grid;
+    QPushButton *const m_add;
+    QPushButton *const m_remove;
+    QPushButton *const m_ok;
+    QPushButton *const m_cancel;
+
+    /* Only updated when ok clicked is successful */
+    std::vector<EndpointAddress> m_endpoints;
+};
+
+#endif // ENDPOINTS_DIALOG_H
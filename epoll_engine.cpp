@@ -0,0 +1,637 @@
+/**
+ * \file epoll_engine.cpp
+ * \brief Shared non-blocking Modbus/TCP transport
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <algorithm>  //  std::min
+#include <array>  //  std::array
+#include <deque>  //  std::deque
+#include <unordered_map>  //  std::unordered_map
+
+// C includes
+#include <sys/epoll.h>  //  epoll_create1, epoll_ctl, epoll_wait
+#include <sys/eventfd.h>  //  eventfd
+#include <sys/socket.h>  //  socket, connect, send, recv
+#include <netinet/in.h>  //  IPPROTO_TCP
+#include <netinet/tcp.h>  //  TCP_NODELAY
+#include <netdb.h>  //  getaddrinfo
+#include <unistd.h>  //  ::close
+#include <cerrno>  //  errno
+#include <modbus/modbus.h>  //  MODBUS_ENOBASE, MODBUS_TCP_MAX_ADU_LENGTH
+
+// project includes
+#include "epoll_engine.h"  //  local include
+
+
+using std::chrono::steady_clock;
+
+
+/**
+ * \brief State of a single connection
+ *
+ * Members above ``host`` are shared with the owning EpollConnection and are
+ * protected by ``mx``; the remainder belong to the I/O thread.
+ */
+struct EpollEndpoint {
+    QMutex mx;
+    EpollConnection *owner=nullptr; /**< ``nullptr`` once closed */
+    bool closing=false;
+    quint16 next_transaction=0;
+    std::chrono::milliseconds timeout{3000};
+    std::deque<ModbusTransaction> pending;
+    std::deque<ModbusResult> results;
+
+    /**
+     * \brief Connection progress
+     */
+    enum class State {
+        IDLE,
+        CONNECTING,
+        CONNECTED,
+        FAILED
+    };
+
+    /**
+     * \brief Request in flight on the socket
+     */
+    struct Outstanding {
+        ModbusTransaction request; /**< Original request */
+        steady_clock::time_point deadline; /**< Response timeout */
+    };
+
+    QString host;
+    quint16 port=0;
+    int pipeline_depth=1;
+    int fd=-1;
+    State state=State::IDLE;
+    steady_clock::time_point connect_deadline;
+    std::vector<quint8> tx_buffer;
+    std::vector<quint8> rx_buffer;
+    std::unordered_map<quint16, Outstanding> outstanding;
+    std::vector<ModbusResult> completed;
+};
+
+
+namespace {
+    const auto g_max_events = 64;
+
+
+    /**
+     * \brief Hand completed transactions to the application.
+     * @param endpoint connection state
+     */
+    void publish(EpollEndpoint &endpoint)
+    {
+        if (endpoint.completed.empty()) {
+            return;
+        }
+
+        endpoint.mx.lock();
+        for (auto &i: endpoint.completed) {
+            endpoint.results.push_back(std::move(i));
+        }
+        if (nullptr != endpoint.owner) {
+            emit endpoint.owner->transactions_ready();
+        }
+        endpoint.mx.unlock();
+        endpoint.completed.clear();
+    }
+
+
+    /**
+     * \brief Report a connection level event to the application.
+     * @param endpoint connection state
+     * @param error_code 0 for connected, errno otherwise
+     */
+    void notify(EpollEndpoint &endpoint, const int error_code)
+    {
+        endpoint.mx.lock();
+        if (nullptr == endpoint.owner) {
+            //  Closed, nobody to tell.
+        } else if (0 == error_code) {
+            emit endpoint.owner->complete();
+        } else {
+            emit endpoint.owner->modbus_error(error_code);
+        }
+        endpoint.mx.unlock();
+    }
+
+}  //  Anonymous namespace
+
+
+EpollEngine::EpollEngine(QObject *parent)
+    :QThread(parent),
+      m_epoll_fd{epoll_create1(EPOLL_CLOEXEC)},
+      m_wake_fd{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)},
+      m_mx(),
+      m_attached(),
+      m_endpoints()
+{
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    static_cast<void>(epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wake_fd, &ev));
+}
+
+
+EpollEngine::~EpollEngine()
+{
+    close();
+    ::close(m_wake_fd);
+    ::close(m_epoll_fd);
+}
+
+
+EpollConnection *EpollEngine::create_connection(QObject *parent,
+                                                const QString &host,
+                                                const quint16 port,
+                                                const int pipeline_depth)
+{
+    if (!isRunning()) {
+        m_mx.lock();
+        m_quit = false;
+        m_mx.unlock();
+        start();
+    }
+
+    return new EpollConnection(this, parent, host, port, pipeline_depth);
+}
+
+
+void EpollEngine::close()
+{
+    m_mx.lock();
+    m_quit = true;
+    m_mx.unlock();
+    wake();
+    wait();
+}
+
+
+void EpollEngine::attach(const std::shared_ptr<EpollEndpoint> &endpoint)
+{
+    m_mx.lock();
+    m_attached.push_back(endpoint);
+    m_mx.unlock();
+    wake();
+}
+
+
+void EpollEngine::wake()
+{
+    static_cast<void>(eventfd_write(m_wake_fd, 1));
+}
+
+
+void EpollEngine::run()
+{
+    std::array<epoll_event, g_max_events> events;
+    auto exit_signal = false;
+    while (!exit_signal) {
+        m_mx.lock();
+        exit_signal = m_quit;
+        auto attached = std::move(m_attached);
+        m_attached = {};
+        m_mx.unlock();
+
+        for (auto &i: attached) {
+            open_endpoint(*i);
+            publish(*i);
+            m_endpoints.push_back(std::move(i));
+        }
+
+        //  Drop closed connections, send whatever is queued.
+        for (auto i=m_endpoints.begin(); m_endpoints.end() != i;) {
+            auto &endpoint = **i;
+            endpoint.mx.lock();
+            const auto closing = endpoint.closing || exit_signal;
+            endpoint.mx.unlock();
+            if (closing) {
+                if (endpoint.fd >= 0) {
+                    ::close(endpoint.fd);
+                    endpoint.fd = -1;
+                }
+                i = m_endpoints.erase(i);
+            } else {
+                send_pending(endpoint);
+                publish(endpoint);
+                ++i;
+            }
+        }
+
+        if (exit_signal) {
+            break;
+        }
+
+        //  Sleep until there is I/O, more requests are queued or the nearest
+        // deadline passes.
+        const auto now = steady_clock::now();
+        auto next_deadline = steady_clock::time_point::max();
+        for (const auto &i: m_endpoints) {
+            if (EpollEndpoint::State::CONNECTING == i->state) {
+                next_deadline = std::min(next_deadline, i->connect_deadline);
+            }
+            for (const auto &j: i->outstanding) {
+                next_deadline = std::min(next_deadline, j.second.deadline);
+            }
+        }
+
+        auto wait_ms = -1;
+        if (steady_clock::time_point::max() != next_deadline) {
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        next_deadline - now);
+            wait_ms = std::max(0, int(remaining.count()) + 1);
+        }
+
+        const auto count = epoll_wait(m_epoll_fd, events.data(), g_max_events, wait_ms);
+        for (auto i=0; i<count; ++i) {
+            if (nullptr == events[size_t(i)].data.ptr) {
+                eventfd_t unused;
+                static_cast<void>(eventfd_read(m_wake_fd, &unused));
+            } else {
+                auto endpoint = static_cast<EpollEndpoint*>(events[size_t(i)].data.ptr);
+                service(*endpoint, events[size_t(i)].events);
+            }
+        }
+
+        for (auto &i: m_endpoints) {
+            expire(*i);
+            publish(*i);
+        }
+    }
+
+    m_endpoints.clear();
+}
+
+
+void EpollEngine::open_endpoint(EpollEndpoint &endpoint)
+{
+    endpoint.mx.lock();
+    const auto timeout = endpoint.timeout;
+    endpoint.mx.unlock();
+
+    //  Resolution is blocking, but the host is normally a numeric address.
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_NUMERICSERV;
+    addrinfo *address = nullptr;
+    const auto service_name = QString::number(endpoint.port);
+    if (getaddrinfo(endpoint.host.toLocal8Bit().data(),
+                    service_name.toLocal8Bit().data(),
+                    &hints,
+                    &address) != 0 || nullptr == address) {
+        drop_connection(endpoint, EHOSTUNREACH);
+        return;
+    }
+
+    endpoint.fd = socket(address->ai_family,
+                         address->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                         address->ai_protocol);
+    auto result = -1;
+    if (endpoint.fd >= 0) {
+        const auto nodelay = 1;
+        static_cast<void>(setsockopt(endpoint.fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)));
+        result = ::connect(endpoint.fd, address->ai_addr, address->ai_addrlen);
+    }
+    const auto error_code = errno;
+    freeaddrinfo(address);
+
+    if (endpoint.fd < 0 || (result < 0 && EINPROGRESS != error_code)) {
+        drop_connection(endpoint, error_code);
+        return;
+    }
+
+    endpoint.state = EpollEndpoint::State::CONNECTING;
+    endpoint.connect_deadline = steady_clock::now() + timeout;
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLOUT;
+    ev.data.ptr = &endpoint;
+    static_cast<void>(epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, endpoint.fd, &ev));
+}
+
+
+void EpollEngine::send_pending(EpollEndpoint &endpoint)
+{
+    if (EpollEndpoint::State::CONNECTING == endpoint.state) {
+        //  Hold requests until connected.
+        return;
+    }
+
+    std::vector<ModbusTransaction> to_send;
+    endpoint.mx.lock();
+    while (!endpoint.pending.empty() &&
+           (endpoint.outstanding.size() + to_send.size()) < size_t(endpoint.pipeline_depth)) {
+        to_send.push_back(std::move(endpoint.pending.front()));
+        endpoint.pending.pop_front();
+    }
+    const auto timeout = endpoint.timeout;
+    endpoint.mx.unlock();
+
+    const auto deadline = steady_clock::now() + timeout;
+    for (auto &i: to_send) {
+        const auto adu = mbap::encode_request(i);
+        if (EpollEndpoint::State::CONNECTED != endpoint.state) {
+            endpoint.completed.push_back(mbap::error_result(i, ENOTCONN));
+        } else if (adu.empty()) {
+            endpoint.completed.push_back(mbap::error_result(
+                    i, MODBUS_ENOBASE + MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS));
+        } else {
+            endpoint.tx_buffer.insert(endpoint.tx_buffer.end(), adu.begin(), adu.end());
+            const auto transaction_id = i.transaction_id;
+            endpoint.outstanding[transaction_id] = EpollEndpoint::Outstanding{std::move(i), deadline};
+        }
+    }
+
+    if (!to_send.empty()) {
+        service(endpoint, EPOLLOUT);
+    }
+}
+
+
+void EpollEngine::service(EpollEndpoint &endpoint, const quint32 events)
+{
+    if (EpollEndpoint::State::CONNECTING == endpoint.state) {
+        if (0 == (events & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+            return;
+        }
+
+        auto error_code = 0;
+        socklen_t length = sizeof(error_code);
+        if (getsockopt(endpoint.fd, SOL_SOCKET, SO_ERROR, &error_code, &length) < 0) {
+            error_code = errno;
+        }
+
+        if (0 != error_code) {
+            drop_connection(endpoint, error_code);
+            return;
+        }
+
+        endpoint.state = EpollEndpoint::State::CONNECTED;
+        notify(endpoint, 0);
+        update_interest(endpoint);
+        send_pending(endpoint);
+        return;
+    }
+
+    if (EpollEndpoint::State::CONNECTED != endpoint.state) {
+        return;
+    }
+
+    if (0 != (events & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+        std::array<quint8, MODBUS_TCP_MAX_ADU_LENGTH> rx_chunk;
+        while (true) {
+            const auto rx = recv(endpoint.fd, rx_chunk.data(), rx_chunk.size(), MSG_DONTWAIT);
+            if (rx > 0) {
+                endpoint.rx_buffer.insert(endpoint.rx_buffer.end(), rx_chunk.begin(), rx_chunk.begin() + rx);
+            } else if (rx < 0 && EINTR == errno) {
+                continue;
+            } else if (rx < 0 && (EAGAIN == errno || EWOULDBLOCK == errno)) {
+                break;
+            } else {
+                drop_connection(endpoint, (0 == rx ? ECONNRESET : errno));
+                return;
+            }
+        }
+
+        auto &rx_buffer = endpoint.rx_buffer;
+        size_t consumed = 0U;
+        int frame;
+        while ((frame = mbap::frame_length(rx_buffer.data() + consumed, rx_buffer.size() - consumed)) > 0) {
+            const auto adu = rx_buffer.data() + consumed;
+            const auto transaction = endpoint.outstanding.find(mbap::transaction_id(adu));
+            if (endpoint.outstanding.end() != transaction) {
+                endpoint.completed.push_back(mbap::decode_response(transaction->second.request,
+                                                                   adu,
+                                                                   size_t(frame)));
+                endpoint.outstanding.erase(transaction);
+            }
+            consumed += size_t(frame);
+        }
+
+        if (frame < 0) {
+            drop_connection(endpoint, EMBBADDATA);
+            return;
+        }
+        rx_buffer.erase(rx_buffer.begin(), rx_buffer.begin() + ssize_t(consumed));
+    }
+
+    if (0 != (events & EPOLLOUT) && !endpoint.tx_buffer.empty()) {
+        size_t sent = 0U;
+        while (sent < endpoint.tx_buffer.size()) {
+            const auto tx = send(endpoint.fd,
+                                 &endpoint.tx_buffer[sent],
+                                 endpoint.tx_buffer.size() - sent,
+                                 MSG_NOSIGNAL | MSG_DONTWAIT);
+            if (tx >= 0) {
+                sent += size_t(tx);
+            } else if (EINTR == errno) {
+                continue;
+            } else if (EAGAIN == errno || EWOULDBLOCK == errno) {
+                break;
+            } else {
+                drop_connection(endpoint, errno);
+                return;
+            }
+        }
+        endpoint.tx_buffer.erase(endpoint.tx_buffer.begin(), endpoint.tx_buffer.begin() + ssize_t(sent));
+        update_interest(endpoint);
+    }
+}
+
+
+void EpollEngine::expire(EpollEndpoint &endpoint)
+{
+    const auto now = steady_clock::now();
+    if (EpollEndpoint::State::CONNECTING == endpoint.state) {
+        if (endpoint.connect_deadline <= now) {
+            drop_connection(endpoint, ETIMEDOUT);
+        }
+        return;
+    }
+
+    for (auto i=endpoint.outstanding.begin(); endpoint.outstanding.end() != i;) {
+        if (i->second.deadline <= now) {
+            endpoint.completed.push_back(mbap::error_result(i->second.request, ETIMEDOUT));
+            i = endpoint.outstanding.erase(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+
+void EpollEngine::drop_connection(EpollEndpoint &endpoint, const int error_code)
+{
+    if (endpoint.fd >= 0) {
+        ::close(endpoint.fd);
+        endpoint.fd = -1;
+    }
+
+    endpoint.state = EpollEndpoint::State::FAILED;
+    endpoint.tx_buffer.clear();
+    endpoint.rx_buffer.clear();
+    for (auto &i: endpoint.outstanding) {
+        endpoint.completed.push_back(mbap::error_result(i.second.request, ECONNRESET));
+    }
+    endpoint.outstanding.clear();
+
+    notify(endpoint, error_code);
+}
+
+
+void EpollEngine::update_interest(EpollEndpoint &endpoint)
+{
+    epoll_event ev{};
+    ev.events = EPOLLIN | (endpoint.tx_buffer.empty() ? 0U : quint32(EPOLLOUT));
+    ev.data.ptr = &endpoint;
+    static_cast<void>(epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, endpoint.fd, &ev));
+}
+
+
+EpollConnection::EpollConnection(EpollEngine *const engine,
+                                 QObject *parent,
+                                 const QString &host,
+                                 const quint16 port,
+                                 const int pipeline_depth)
+    :ModbusConnection(parent),
+      m_engine{engine},
+      m_endpoint{std::make_shared<EpollEndpoint>()}
+{
+    m_endpoint->owner = this;
+    m_endpoint->host = host;
+    m_endpoint->port = port;
+    m_endpoint->pipeline_depth = (pipeline_depth > 1 ? pipeline_depth : 1);
+}
+
+
+EpollConnection::~EpollConnection()
+{
+    detach();
+}
+
+
+void EpollConnection::start()
+{
+    m_engine->attach(m_endpoint);
+}
+
+
+void EpollConnection::close()
+{
+    detach();
+    deleteLater();
+}
+
+
+void EpollConnection::detach()
+{
+    m_endpoint->mx.lock();
+    const auto attached = (nullptr != m_endpoint->owner);
+    m_endpoint->owner = nullptr;
+    m_endpoint->closing = true;
+    m_endpoint->mx.unlock();
+
+    if (attached) {
+        m_engine->wake();
+    }
+}
+
+
+quint16 EpollConnection::modbus_request(const quint16 first_reg, const quint16 num_regs, const quint8 uid)
+{
+    ModbusTransaction transaction;
+    transaction.first_register = first_reg;
+    transaction.count = num_regs;
+    transaction.node = uid;
+    return enqueue(std::move(transaction));
+}
+
+
+quint16 EpollConnection::modbus_request(const quint16 first_reg,
+                                        std::vector<quint16> &&regs_to_write,
+                                        const quint8 uid)
+{
+    ModbusTransaction transaction;
+    transaction.first_register = first_reg;
+    transaction.node = uid;
+    transaction.write = true;
+    transaction.values = std::move(regs_to_write);
+    return enqueue(std::move(transaction));
+}
+
+
+quint16 EpollConnection::modbus_request(const quint8 *pdu,
+                                        const quint8 length,
+                                        const qint8 fc,
+                                        const quint8 uid)
+{
+    ModbusTransaction transaction;
+    transaction.node = uid;
+    transaction.function_code = fc;
+    transaction.raw_pdu.assign(pdu, pdu + length);
+    return enqueue(std::move(transaction));
+}
+
+
+quint16 EpollConnection::enqueue(ModbusTransaction &&transaction)
+{
+    m_endpoint->mx.lock();
+    const auto transaction_id = m_endpoint->next_transaction++;
+    transaction.transaction_id = transaction_id;
+    m_endpoint->pending.push_back(std::move(transaction));
+    m_endpoint->mx.unlock();
+    m_engine->wake();
+
+    return transaction_id;
+}
+
+
+bool EpollConnection::take_result(ModbusResult &result)
+{
+    m_endpoint->mx.lock();
+    const auto available = !m_endpoint->results.empty();
+    if (available) {
+        result = std::move(m_endpoint->results.front());
+        m_endpoint->results.pop_front();
+    }
+    m_endpoint->mx.unlock();
+
+    return available;
+}
+
+
+int EpollConnection::pipeline_depth() const noexcept
+{
+    return m_endpoint->pipeline_depth;
+}
+
+
+void EpollConnection::set_response_timeout(const std::chrono::milliseconds timeout)
+{
+    m_endpoint->mx.lock();
+    m_endpoint->timeout = timeout;
+    m_endpoint->mx.unlock();
+}
@@ -0,0 +1,235 @@
+/**
+ * \file epoll_engine.h
+ * \brief Shared non-blocking Modbus/TCP transport
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * A single I/O thread that services any number of Modbus/TCP connections
+ * using non-blocking sockets and epoll.  libmodbus is not used at all: the
+ * engine does its own MBAP framing (\sa mbap_codec.h), keeps up to
+ * ``pipeline_depth`` requests in flight per connection and enforces a deadline
+ * on every request (and on the connect itself) from within the epoll loop.
+ * The application talks to each device through an ``EpollConnection`` handle
+ * which implements the same interface as ModbusThread.
+ */
+
+#ifndef EPOLL_ENGINE_H
+#define EPOLL_ENGINE_H
+
+//  c++ includes
+#include <chrono>  //  std::chrono::milliseconds
+#include <memory>  //  std::shared_ptr
+#include <vector>  //  std::vector
+#include <QThread>  //  QThread
+#include <QMutex>  //  QMutex
+#include <QString>  //  QString
+
+// C includes
+/* -none- */
+
+// project includes
+#include "modbus_connection.h"  //  ModbusConnection
+#include "mbap_codec.h"  //  ModbusTransaction, ModbusResult
+
+
+struct EpollEndpoint;
+class EpollConnection;
+
+
+/**
+ * \brief I/O thread shared by all epoll connections
+ */
+class EpollEngine : public QThread
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * \brief constructor
+     * @param parent parent QObject owner
+     */
+    explicit EpollEngine(QObject *parent);
+
+    /**
+     * \brief Create a new connection serviced by this engine.
+     * \note
+     * The connection is not opened until ``start`` is called on it.
+     *
+     * @param parent parent QObject owner of the connection handle
+     * @param host host to be resolved and connected to
+     * @param port destination port
+     * @param pipeline_depth maximum number of outstanding transactions
+     * @return connection handle
+     */
+    [[nodiscard]] EpollConnection *create_connection(QObject *parent,
+                                                     const QString &host,
+                                                     const quint16 port,
+                                                     const int pipeline_depth);
+
+    /**
+     * \brief Close all connections and exit thread.
+     * \note
+     * Blocking call
+     */
+    void close();
+
+    ~EpollEngine() override;
+
+protected:
+
+    virtual void run() override;
+
+private:
+
+    friend class EpollConnection;
+
+    /**
+     * \brief Hand a connection to the I/O thread.
+     * @param endpoint connection state
+     */
+    void attach(const std::shared_ptr<EpollEndpoint> &endpoint);
+
+    /**
+     * \brief Wake the I/O thread.
+     */
+    void wake();
+
+    /**
+     * \brief Begin a non-blocking connect.
+     * @param endpoint connection state
+     */
+    void open_endpoint(EpollEndpoint &endpoint);
+
+    /**
+     * \brief Move queued requests onto the wire.
+     * @param endpoint connection state
+     */
+    void send_pending(EpollEndpoint &endpoint);
+
+    /**
+     * \brief Handle readiness reported by epoll.
+     * @param endpoint connection state
+     * @param events epoll event mask
+     */
+    void service(EpollEndpoint &endpoint, const quint32 events);
+
+    /**
+     * \brief Fail requests and connects that are past their deadline.
+     * @param endpoint connection state
+     */
+    void expire(EpollEndpoint &endpoint);
+
+    /**
+     * \brief Close the socket and fail everything outstanding.
+     * @param endpoint connection state
+     * @param error_code reason reported to the application
+     */
+    void drop_connection(EpollEndpoint &endpoint, const int error_code);
+
+    /**
+     * \brief Update the epoll interest set for a connection.
+     * @param endpoint connection state
+     */
+    void update_interest(EpollEndpoint &endpoint);
+
+    int m_epoll_fd=-1;
+    int m_wake_fd=-1;
+    QMutex m_mx;
+    bool m_quit=false;
+    std::vector<std::shared_ptr<EpollEndpoint>> m_attached;
+    std::vector<std::shared_ptr<EpollEndpoint>> m_endpoints;
+};
+
+
+/**
+ * \brief Handle to a single connection serviced by an EpollEngine
+ */
+class EpollConnection : public ModbusConnection
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * \brief constructor \sa EpollEngine::create_connection
+     * @param engine I/O thread
+     * @param parent parent QObject owner
+     * @param host host to be resolved and connected to
+     * @param port destination port
+     * @param pipeline_depth maximum number of outstanding transactions
+     */
+    EpollConnection(EpollEngine *const engine,
+                    QObject *parent,
+                    const QString &host,
+                    const quint16 port,
+                    const int pipeline_depth);
+
+    virtual void start() override;
+
+    /**
+     * \brief Close the connection.
+     * \note
+     * Non-blocking, the socket is closed by the I/O thread.
+     */
+    virtual void close() override;
+
+    virtual quint16 modbus_request(const quint16 first_reg, const quint16 num_regs, const quint8 uid) override;
+
+    virtual quint16 modbus_request(const quint16 first_reg,
+                                   std::vector<quint16> &&regs_to_write,
+                                   const quint8 uid) override;
+
+    virtual quint16 modbus_request(const quint8 *pdu,
+                                   const quint8 length,
+                                   const qint8 fc,
+                                   const quint8 uid) override;
+
+    [[nodiscard]] virtual bool take_result(ModbusResult &result) override;
+
+    [[nodiscard]] virtual int pipeline_depth() const noexcept override;
+
+    virtual void set_response_timeout(const std::chrono::milliseconds timeout) override;
+
+    ~EpollConnection() override;
+
+private:
+
+    /**
+     * \brief Queue a transaction for the I/O thread.
+     * @param transaction request to send
+     * @return transaction ID
+     */
+    quint16 enqueue(ModbusTransaction &&transaction);
+
+    /**
+     * \brief Detach from the I/O thread.
+     */
+    void detach();
+
+    EpollEngine *const m_engine;
+    const std::shared_ptr<EpollEndpoint> m_endpoint;
+};
+
+
+#endif // EPOLL_ENGINE_H
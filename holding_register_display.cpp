@@ -48,7 +48,10 @@ HoldingRegisterDisplay::HoldingRegisterDisplay(QWidget *parent, const quint16 ba
 
 void HoldingRegisterDisplay::updateRegisterValue(const size_t index, const QString &value)
 {
-    if (!m_activity_timer->isActive() || int(index) != m_active_index) {
+    if (m_table_view) {
+        //  The value delegate keeps an editor being typed in.
+        RegisterDisplay::updateRegisterValue(index, value);
+    } else if (!m_activity_timer->isActive() || int(index) != m_active_index) {
         auto widget = dynamic_cast<QLineEdit*>(m_register_values[index]);
         widget->setText(value);
     }
@@ -88,7 +91,20 @@ void HoldingRegisterDisplay::on_register_textEdited(const quint16 index)
 void HoldingRegisterDisplay::on_register_returnPressed(const quint16 index)
 {
     on_register_editingFinished(index);
-    const auto display_value = get_display_value(index);
+    write_display_value(index, get_display_value(index));
+}
+
+
+void HoldingRegisterDisplay::on_table_value_edited(const int row, const QString value)
+{
+    write_display_value(quint16(row), value);
+}
+
+
+void HoldingRegisterDisplay::write_display_value(const quint16 index, const QString &display_value)
+{
+    //  Show the polled value again should the write not take effect.
+    invalidate_register(index);
     auto encoded_regs = encode_register(display_value, m_register_encoding[index]);
 
     if (encoded_regs.size() == 0) {
@@ -112,8 +128,16 @@ void HoldingRegisterDisplay::on_register_returnPressed(const quint16 index)
 
 void HoldingRegisterDisplay::on_register_editingFinished(const quint16 index)
 {
+    if (index >= m_register_values.size()) {
+        //  Row removed (or table view selected) while being edited.
+        m_active_index=-1;
+        m_activity_timer->stop();
+        return;
+    }
+
     auto widget = dynamic_cast<QLineEdit*>(m_register_values[index]);
     widget->setStyleSheet("background-color: #FFF;");
+    invalidate_register(index);
     m_active_index=-1;
     m_activity_timer->stop();
 }
@@ -153,11 +177,21 @@ bool HoldingRegisterDisplay::load_configuration_parameters(const QDomElement &no
 
 QString HoldingRegisterDisplay::get_display_value(const size_t index) const
 {
+    if (m_table_view) {
+        return RegisterDisplay::get_display_value(index);
+    }
+
     const auto widget = dynamic_cast<QLineEdit*>(m_register_values[index]);
     return widget->text();
 }
 
 
+RegisterTableModel::ValueEditor HoldingRegisterDisplay::get_value_editor() const
+{
+    return RegisterTableModel::EDITOR_TEXT;
+}
+
+
 std::vector<quint16> HoldingRegisterDisplay::encode_register(
         const QString &value, const RegisterEncoding encoding) const
 {
@@ -77,8 +77,12 @@ protected:
     virtual void updateRegisterValue(const size_t index, const QString &value) override;
     virtual QWidget* create_value_widget(const quint16 index, const bool initial) override;
     virtual QString get_display_value(const size_t index) const override;
+    [[nodiscard]] virtual RegisterTableModel::ValueEditor get_value_editor() const override;
     virtual void setupUi() override;
 
+protected slots:
+    virtual void on_table_value_edited(const int row, const QString value) override;
+
 private slots:
     /**
      * \brief Signal that a register text box is active for editing.
@@ -111,6 +115,13 @@ private slots:
     void on_timer_expired();
 
 private:
+    /**
+     * \brief Encode and write the value entered for a register.
+     * @param index register index in window
+     * @param display_value text entered
+     */
+    void write_display_value(const quint16 index, const QString &display_value);
+
     int m_active_index=-1;
     QTimer *const m_activity_timer;
 
@@ -24,13 +24,15 @@
  */
 
 //  c++ includes
+#include <algorithm>  //  std::clamp
 #include <chrono>  //  std::chrono::milliseconds
 #include <vector>  //  std::vector
+#include <map>  //  std::map
 #include <string_view>  //  std::swap (as of c++17)
+#include <QDir>  //  QDir
 #include <QFileDialog>  //  QFileDialog
 #include <QMessageBox>  //  QMessageBox
 #include <QTextStream>  //  QTextStream
-#include <qtcsv/reader.h>  //  QtCSV::Reader::readToList
 
 // C includes
 #include <modbus/modbus.h>  //  modbus_strerror
@@ -43,29 +45,43 @@
 #include "exceptions.h"  //  AppException, FileLoadException
 #include "csv_importer.h"  //  CsvImporter
 #include "metadata_wrapper.h"  //  MetadataWrapper
+#include "modbusthread.h"  //  ModbusThread
+#include "read_planner.h"  //  read_planner::MAX_GAP
+#include "capture_file.h"  //  CaptureReader
 
 
 using BaseData = std::tuple<quint8, quint16, quint16>;
 
 
+namespace {
+    const auto g_max_pipeline_depth = 32;
+    const auto g_csv_preview_rows = 7;  /**< Rows shown by the CSV importer */
+    const auto g_transport_libmodbus = 0;  /**< transportCombo index */
+    const auto g_transport_epoll = 1;  /**< transportCombo index */
+    const auto g_transport_names = QStringList{"libmodbus", "epoll"};
+}  //  Anonymous namespace
+
+
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent),
       m_ui(new Ui::MainWindow), m_connected(false),
       m_register_windows(),
-      m_scheduler{new Scheduler(this)},
+      m_endpoints(),
       m_update_timer{new QTimer(this)},
+      m_io_engine{new EpollEngine(this)},
       m_trend{nullptr}
 {
     m_ui->setupUi(this);
     m_update_timer->setInterval(std::chrono::milliseconds(100));
     m_update_timer->setSingleShot(false);
     connect(m_update_timer, &QTimer::timeout, this, &MainWindow::update_timer_on_expired);
-    connect(m_scheduler, &Scheduler::poll_exception, this, &MainWindow::modbus_on_error);
-    connect(m_scheduler, &Scheduler::polling_complete, this, &MainWindow::polling_on_complete);
+    connect(this, &MainWindow::poll_exception, this, &MainWindow::modbus_on_error);
+    set_endpoints({{m_ui->ipEdit->text(), quint16(m_ui->portEdit->text().toInt())}});
     const auto wrapper = MetadataWrapper::get_instance();
     if (!wrapper->loaded()) {
         m_ui->actionRead_Metadata->setEnabled(false);
-        m_ui->actionRead_Metadata->setToolTip(tr("Plugin unavailable"));
+        m_ui->actionRead_Metadata->setToolTip(tr("Plugin unavailable: %1").arg(wrapper->get_error()));
+        m_ui->actionRevalidate_Metadata->setEnabled(false);
     }
 }
 
@@ -81,21 +97,59 @@ void MainWindow::on_actionConnect_triggered()
     m_ui->actionContinuous->setChecked(false);
     if (m_connected) {
         m_ui->statusbar->showMessage("");
-        m_engine->close();
-        post_disconnected();
+        close_endpoints();
     } else {
         m_connecting=true;
-        m_connecting2=false;
         m_ui->statusbar->showMessage(tr("..."));
         m_ui->actionConnect->setEnabled(false);
         m_ui->ipEdit->setEnabled(false);
         m_ui->portEdit->setEnabled(false);
         m_ui->timeoutEdit->setEnabled(false);
-        m_engine = new ModbusThread(this, m_ui->ipEdit->text(), quint16(m_ui->portEdit->text().toInt()));
-        connect(m_engine, &ModbusThread::complete, this, &MainWindow::modbus_on_data);\
-        connect(m_engine, &ModbusThread::modbus_error, this, &MainWindow::modbus_on_error_protocol);
-        //  TODO: Raw error / route startup through the scheduler.
-        m_engine->start();
+        m_ui->pipelineEdit->setEnabled(false);
+        m_ui->transportCombo->setEnabled(false);
+        m_ui->gapEdit->setEnabled(false);
+        m_ui->actionEndpoints->setEnabled(false);
+
+        auto pipeline_depth = m_ui->pipelineEdit->text().toInt();
+        if (pipeline_depth < 1 || pipeline_depth > g_max_pipeline_depth) {
+            pipeline_depth = std::clamp(pipeline_depth, 1, g_max_pipeline_depth);
+            m_ui->pipelineEdit->setText(QString::number(pipeline_depth));
+        }
+
+        auto read_gap = m_ui->gapEdit->text().toInt();
+        if (read_gap < 0 || read_gap > read_planner::MAX_GAP) {
+            read_gap = std::clamp(read_gap, 0, int(read_planner::MAX_GAP));
+            m_ui->gapEdit->setText(QString::number(read_gap));
+        }
+
+        //  Every endpoint gets its own connection and scheduler so that
+        // independent devices are polled in parallel.
+        set_endpoints(get_endpoint_addresses());
+        const auto timeout = get_timeout();
+        for (size_t i=0U; i<m_endpoints.size(); ++i) {
+            auto &endpoint = m_endpoints[i];
+            const auto index = quint8(i);
+            const auto &host = endpoint.address.first;
+            const auto port = endpoint.address.second;
+            if (g_transport_epoll == m_ui->transportCombo->currentIndex()) {
+                endpoint.engine = m_io_engine->create_connection(this, host, port, pipeline_depth);
+            } else {
+                endpoint.engine = new ModbusThread(this, host, port, pipeline_depth);
+            }
+            endpoint.engine->set_response_timeout(timeout);
+            endpoint.scheduler->set_read_gap(quint16(read_gap));
+            endpoint.connecting = true;
+            connect(endpoint.engine, &ModbusConnection::complete, this, [=]() {
+                modbus_on_data(index);
+            });
+            connect(endpoint.engine, &ModbusConnection::modbus_error, this, [=](const int error_code) {
+                modbus_on_error_protocol(index, error_code);
+            });
+        }
+
+        for (auto &i: m_endpoints) {
+            i.engine->start();
+        }
     }
 }
 
@@ -127,8 +181,7 @@ void MainWindow::on_actionHolding_Registers_triggered()
 void MainWindow::closeEvent(QCloseEvent *evt)
 {
     if (m_connected) {
-        m_engine->close();
-        post_disconnected();
+        close_endpoints();
     }
     const std::vector<RegisterDisplay*> windows_to_close(m_register_windows.begin(),
                                                          m_register_windows.end());
@@ -154,67 +207,115 @@ void MainWindow::modbus_on_error(BaseDialog *requester, const QString exception)
 }
 
 
-void MainWindow::modbus_on_data()
+void MainWindow::modbus_on_data(const quint8 endpoint)
 {
-    if (m_connecting) {
-        //post_connected("");
-        m_connecting = false;
-        m_connecting2 = true;
-        m_engine->modbus_request(0, 0, 0);
-        m_ui->statusbar->showMessage(tr("Connected to %1:%2")
-                                     .arg(m_ui->ipEdit->text())
-                                     .arg(m_ui->portEdit->text()));
-        post_connected();
-    } else if (m_connecting2) {
-        auto data = m_engine->modbus_result();
-        //  strip off null terminator and RUN/STOP indicator
-        QString device_id(int(data.size()) - 2, ' ');
-        for (int i=0; i < device_id.size(); ++i) {
-            device_id[i] = QChar(uchar(data[unsigned(i)]));
+    auto &connection = m_endpoints[endpoint];
+    if (connection.connecting) {
+        connection.connecting = false;
+        connection.connected = true;
+        m_connecting = std::any_of(m_endpoints.begin(), m_endpoints.end(),
+                                   [](const Endpoint &i) { return i.connecting; });
+        m_ui->statusbar->showMessage(tr("Connected to %1").arg(get_endpoint_name(endpoint)));
+        connection.scheduler->start_modbus(connection.engine, get_timeout());
+        if (!m_connected) {
+            post_connected();
+        } else if (m_ui->actionContinuous->isChecked()) {
+            //  Join the continuous poll already running on the others.
+            for (auto i: m_register_windows) {
+                connection.scheduler->set_subscriptions(i, std::move(get_subscriptions(i)[endpoint]));
+            }
+            if (nullptr != m_trend) {
+                connection.scheduler->set_subscriptions(m_trend, std::move(get_subscriptions(m_trend)[endpoint]));
+            }
+        } else {
+
         }
-        m_ui->statusbar->showMessage(tr("Connected to %1").arg(device_id));
-        m_connecting2=false;
+        connection.scheduler->request_device_id();
     } else {
     }
 }
 
 
+void MainWindow::modbus_on_device_identified(const quint8 endpoint, const QString device_id)
+{
+    //  The scheduler has opened the metadata cache of this device.
+    for (auto i: m_register_windows) {
+        if (i->get_endpoint() == endpoint) {
+            m_endpoints[endpoint].scheduler->fill_metadata(i, i->get_read_range());
+        }
+    }
+
+    if (m_endpoints.size() > 1U) {
+        m_ui->statusbar->showMessage(tr("Connected to %1 (%2)")
+                                     .arg(device_id)
+                                     .arg(get_endpoint_name(endpoint)));
+    } else {
+        m_ui->statusbar->showMessage(tr("Connected to %1").arg(device_id));
+    }
+}
+
+
 void MainWindow::post_connected()
 {
     m_active = false;
     m_update_timer->start();
 
+    m_ui->actionConnect->setEnabled(true);
+
+    m_ui->menuPoll->setEnabled(true);
+    m_ui->actionConnect->setText(tr("Disconnect"));
+    m_connected = true;
+}
+
+
+std::chrono::milliseconds MainWindow::get_timeout()
+{
     auto timeout = m_ui->timeoutEdit->text().toInt();
     if (timeout < 1) {
         m_ui->timeoutEdit->setText("3000");
         timeout=3000;
     }
-    m_scheduler->start_modbus(m_engine, std::chrono::milliseconds(timeout));
-    m_ui->actionConnect->setEnabled(true);
 
-    m_ui->menuPoll->setEnabled(true);
-    m_ui->actionConnect->setText(tr("Disconnect"));
-    m_connected = true;
+    return std::chrono::milliseconds(timeout);
+}
+
+
+void MainWindow::close_endpoints()
+{
+    for (auto &i: m_endpoints) {
+        if (nullptr != i.engine) {
+            i.engine->close();
+        }
+    }
+    post_disconnected();
 }
 
 
 void MainWindow::post_disconnected()
 {
-    m_scheduler->stop_modbus();
+    for (auto &i: m_endpoints) {
+        i.scheduler->stop_modbus();
+        if (nullptr != i.engine) {
+            disconnect(i.engine, nullptr, this, nullptr);
+            i.engine = nullptr;
+        }
+        i.connecting = false;
+        i.connected = false;
+    }
     m_connecting=false;
-    m_connecting2=false;
     m_ui->actionConnect->setEnabled(true);
     m_ui->ipEdit->setEnabled(true);
     m_ui->portEdit->setEnabled(true);
     m_ui->timeoutEdit->setEnabled(true);
+    m_ui->pipelineEdit->setEnabled(true);
+    m_ui->transportCombo->setEnabled(true);
+    m_ui->gapEdit->setEnabled(true);
+    m_ui->actionEndpoints->setEnabled(true);
     m_ui->actionConnect->setText(tr("Connect"));
     m_ui->actionContinuous->setChecked(false);
     m_ui->menuPoll->setEnabled(false);
     m_update_timer->stop();
     m_active = false;
-    disconnect(m_engine, &ModbusThread::modbus_error, this, &MainWindow::modbus_on_error_protocol);
-    disconnect(m_engine, &ModbusThread::complete, this, &MainWindow::modbus_on_data);
-    m_engine=nullptr;
     m_connected = false;
 }
 
@@ -228,7 +329,10 @@ void MainWindow::on_actionOnce_triggered()
             m_ui->actionContinuous->setChecked(false);
         } else {
             for (auto i: m_register_windows) {
-                m_scheduler->enqueue_request(i);
+                auto scheduler = get_scheduler(i);
+                if (nullptr != scheduler) {
+                    scheduler->enqueue_request(i);
+                }
             }
         }
     }
@@ -238,7 +342,29 @@ void MainWindow::on_actionOnce_triggered()
 void MainWindow::on_actionContinuous_triggered()
 {
     if (m_connected && m_ui->actionContinuous->isChecked()) {
-        on_actionOnce_triggered();
+        if (m_register_windows.size() == 0 && nullptr == m_trend) {
+            m_ui->actionContinuous->setChecked(false);
+        } else {
+            for (auto i: m_register_windows) {
+                subscribe_window(i);
+            }
+            if (nullptr != m_trend) {
+                subscribe_window(m_trend);
+            }
+        }
+    } else {
+        for (auto &i: m_endpoints) {
+            i.scheduler->clear_subscriptions();
+        }
+    }
+}
+
+
+void MainWindow::window_on_poll_configuration_changed(BaseDialog *window)
+{
+    register_displayed_ranges(window);
+    if (m_connected && m_ui->actionContinuous->isChecked()) {
+        subscribe_window(window);
     }
 }
 
@@ -247,16 +373,22 @@ void MainWindow::register_window_destroyed(BaseDialog *window)
 {
     const auto element = m_register_windows.find(dynamic_cast<RegisterDisplay*>(window));
     if (m_register_windows.end() != element) {
-        disconnect(m_scheduler, &Scheduler::new_register_data,
-                   *element, &RegisterDisplay::on_new_value);
-        disconnect(m_scheduler, &Scheduler::poll_exception,
+        disconnect(this, &MainWindow::register_data,
+                   *element, &RegisterDisplay::on_endpoint_value);
+        disconnect(this, &MainWindow::poll_exception,
                    *element, &RegisterDisplay::on_exception_status);
         disconnect(*element, &RegisterDisplay::write_requested,
-                   m_scheduler, &Scheduler::modbus_on_write_request);
+                   this, &MainWindow::window_on_write_request);
         disconnect(*element, &RegisterDisplay::metadata_requested,
-                   m_scheduler, &Scheduler::modbus_on_poll_meta);
+                   this, &MainWindow::window_on_metadata_request);
+        disconnect(this, &MainWindow::poll_statistics,
+                   *element, &RegisterDisplay::on_poll_statistics);
+        disconnect(*element, &RegisterDisplay::poll_configuration_changed,
+                   this, &MainWindow::window_on_poll_configuration_changed);
         m_register_windows.erase(element);
-        m_scheduler->remove_reference(window);
+        for (auto &i: m_endpoints) {
+            i.scheduler->remove_reference(window);
+        }
     }
 }
 
@@ -265,24 +397,46 @@ void MainWindow::add_window(RegisterDisplay *window)
 {
     window->show();
     m_register_windows.insert(window);
-    connect(m_scheduler, &Scheduler::new_register_data, window, &RegisterDisplay::on_new_value);
-    connect(m_scheduler, &Scheduler::poll_exception, window, &RegisterDisplay::on_exception_status);
-    connect(window, &RegisterDisplay::write_requested, m_scheduler, &Scheduler::modbus_on_write_request);
-    connect(window, &RegisterDisplay::metadata_requested, m_scheduler, &Scheduler::modbus_on_poll_meta);
+    connect(this, &MainWindow::register_data, window, &RegisterDisplay::on_endpoint_value);
+    connect(this, &MainWindow::poll_exception, window, &RegisterDisplay::on_exception_status);
+    connect(window, &RegisterDisplay::write_requested, this, &MainWindow::window_on_write_request);
+    connect(window, &RegisterDisplay::metadata_requested, this, &MainWindow::window_on_metadata_request);
+    connect(this, &MainWindow::poll_statistics, window, &RegisterDisplay::on_poll_statistics);
+    connect(window, &RegisterDisplay::poll_configuration_changed,
+            this, &MainWindow::window_on_poll_configuration_changed);
     connect(window, &RegisterDisplay::window_closed, this, &MainWindow::register_window_destroyed);
+    window_on_poll_configuration_changed(window);
 }
 
 
 void MainWindow::update_timer_on_expired()
 {
     BaseDialog *unused;
-    if (m_scheduler->get_active(unused)) {
-        const auto counts = m_scheduler->get_counts();
+    auto active = false;
+    QPair<quint64, quint64> counts{0U, 0U};
+    QPair<quint64, quint64> dispatch{0U, 0U};
+    for (const auto &i: m_endpoints) {
+        if (i.connected) {
+            active = (i.scheduler->get_active(unused) || active);
+            const auto endpoint_counts = i.scheduler->get_counts();
+            counts.first += endpoint_counts.first;
+            counts.second += endpoint_counts.second;
+            const auto dispatch_counts = i.scheduler->get_dispatch_counts();
+            dispatch.first += dispatch_counts.first;
+            dispatch.second += dispatch_counts.second;
+        }
+    }
+
+    if (active) {
         m_ui->statusbar->showMessage(tr("Polling: (rx: ") %
                                      QString::number(counts.first) %
                                      tr(" / err: ") %
                                      QString::number(counts.second) %
-                                     QChar(')'));
+                                     tr(" / blocks: ") %
+                                     QString::number(dispatch.first) %
+                                     tr(" -> ") %
+                                     QString::number(dispatch.second) %
+                                     tr(" windows)"));
         m_active = true;
     } else if (m_active) {
         m_ui->statusbar->showMessage(tr("Idle"));
@@ -292,14 +446,6 @@ void MainWindow::update_timer_on_expired()
 }
 
 
-void MainWindow::polling_on_complete()
-{
-    if (m_connected && m_ui->actionContinuous->isChecked()) {
-        on_actionOnce_triggered();
-    }
-}
-
-
 void MainWindow::on_actionSave_Session_triggered()
 {
     auto dialog = QFileDialog(this, tr("Save session as..."));
@@ -352,6 +498,10 @@ void MainWindow::on_actionRestore_Session_triggered()
         auto ip_text = m_ui->ipEdit->text();
         auto port_text = m_ui->portEdit->text();
         auto timeout_text = m_ui->timeoutEdit->text();
+        auto pipeline_text = m_ui->pipelineEdit->text();
+        auto transport_index = m_ui->transportCombo->currentIndex();
+        auto gap_text = m_ui->gapEdit->text();
+        auto old_endpoints = get_endpoint_addresses();
         auto old_windows = std::unordered_set<RegisterDisplay*>(
                     m_register_windows.begin(), m_register_windows.end());
         auto old_trend = m_trend;
@@ -383,6 +533,10 @@ void MainWindow::on_actionRestore_Session_triggered()
             m_ui->ipEdit->setText(ip_text);
             m_ui->portEdit->setText(port_text);
             m_ui->timeoutEdit->setText(timeout_text);
+            m_ui->pipelineEdit->setText(pipeline_text);
+            m_ui->transportCombo->setCurrentIndex(transport_index);
+            m_ui->gapEdit->setText(gap_text);
+            set_endpoints(old_endpoints);
         } if (success) {
             if (nullptr != old_trend) {
                 /* swap old and new so we can close the old */
@@ -421,6 +575,9 @@ QDomDocument MainWindow::save_config() const
     auto common = document.createElement("common");
     common.setAttribute("method", "TCP");
     common.setAttribute("timeout", m_ui->timeoutEdit->text());
+    common.setAttribute("pipeline", m_ui->pipelineEdit->text());
+    common.setAttribute("transport", g_transport_names[m_ui->transportCombo->currentIndex()]);
+    common.setAttribute("gap", m_ui->gapEdit->text());
     core.appendChild(common);
 
     const auto position = pos();
@@ -435,6 +592,16 @@ QDomDocument MainWindow::save_config() const
     tcp.setAttribute("port", m_ui->portEdit->text());
     core.appendChild(tcp);
 
+    //  Endpoint 0 is the "TCP" element above.
+    const auto endpoints = get_endpoint_addresses();
+    for (size_t i=1U; i<endpoints.size(); ++i) {
+        auto endpoint = document.createElement("endpoint");
+        endpoint.setAttribute("index", QString::number(i));
+        endpoint.setAttribute("ip", endpoints[i].first);
+        endpoint.setAttribute("port", QString::number(endpoints[i].second));
+        core.appendChild(endpoint);
+    }
+
     for (auto i: m_register_windows) {
         auto window = document.createElement(i->get_object_name());
         windows.appendChild(window);
@@ -503,6 +670,10 @@ void MainWindow::load_communications_config(const QDomElement &node)
 
     const auto &method = common_config.attribute("method");
     const auto &timeout = common_config.attribute("timeout");
+    const auto &pipeline = common_config.attribute("pipeline", "1");
+    const auto &gap = common_config.attribute("gap", "0");
+    const auto transport = g_transport_names.indexOf(
+                common_config.attribute("transport", g_transport_names[g_transport_libmodbus]));
     if ("TCP" != method) {
         throw AppException("Invalid file");
     }
@@ -511,7 +682,18 @@ void MainWindow::load_communications_config(const QDomElement &node)
         throw AppException("Invalid file");
     }
 
+    if (pipeline.toInt() < 1 || pipeline.toInt() > g_max_pipeline_depth || transport < 0) {
+        throw AppException("Invalid file");
+    }
+
+    if (gap.toInt() < 0 || gap.toInt() > read_planner::MAX_GAP) {
+        throw AppException("Invalid file");
+    }
+
     m_ui->timeoutEdit->setText(timeout);
+    m_ui->pipelineEdit->setText(pipeline);
+    m_ui->transportCombo->setCurrentIndex(transport);
+    m_ui->gapEdit->setText(gap);
 
     const auto &port = tcp_config.attribute("port");
     const auto &ip = tcp_config.attribute("ip");
@@ -519,8 +701,21 @@ void MainWindow::load_communications_config(const QDomElement &node)
         throw AppException("Invalid file");
     }
 
-    m_ui->portEdit->setText(port);
-    m_ui->ipEdit->setText(ip);
+    std::vector<EndpointAddress> endpoints{{ip, quint16(port.toInt())}};
+    for (auto endpoint = node.firstChildElement("endpoint");
+         !endpoint.isNull();
+         endpoint = endpoint.nextSiblingElement("endpoint")) {
+        const auto index = endpoint.attribute("index", "-1").toInt();
+        const auto endpoint_ip = endpoint.attribute("ip");
+        const auto endpoint_port = endpoint.attribute("port").toInt();
+        if (index != int(endpoints.size()) || index > 255 || endpoint_ip.isEmpty() ||
+                endpoint_port < 1 || endpoint_port > 65535) {
+            throw AppException("Invalid file");
+        }
+        endpoints.push_back({endpoint_ip, quint16(endpoint_port)});
+    }
+
+    set_endpoints(endpoints);
     const auto h = node.attribute("h", "-1").toInt();
     const auto w = node.attribute("w", "-1").toInt();
     if (h > 0 && w > 0) {
@@ -548,22 +743,14 @@ void MainWindow::load_windows(const QDomNode &node)
                                                std::get<1>(config),
                                                std::get<2>(config),
                                                std::get<0>(config));
-                if (window->load_configuration_parameters(element)) {
-                    add_window(window);
-                } else {
-                    window->deleteLater();
-                }
+                add_loaded_window(window, element);
             } else if (node.nodeName() == "RegisterDisplay") {
                 auto config = load_base_data(element);
                 auto window = new RegisterDisplay(this,
                                                  std::get<1>(config),
                                                  std::get<2>(config),
                                                  std::get<0>(config));
-                if (window->load_configuration_parameters(element)) {
-                    add_window(window);
-                } else {
-                    window->deleteLater();
-                }
+                add_loaded_window(window, element);
 
             } else if (node.nodeName() == "HoldingRegisterDisplay") {
                 auto config = load_base_data(element);
@@ -571,11 +758,7 @@ void MainWindow::load_windows(const QDomNode &node)
                                                          std::get<1>(config),
                                                          std::get<2>(config),
                                                          std::get<0>(config));
-                if (window->load_configuration_parameters(element)) {
-                    add_window(window);
-                } else {
-                    window->deleteLater();
-                }
+                add_loaded_window(window, element);
 
             } else if (node.nodeName() == "InputsDisplay") {
                 auto config = load_base_data(element);
@@ -583,11 +766,7 @@ void MainWindow::load_windows(const QDomNode &node)
                                                 std::get<1>(config),
                                                 std::get<2>(config),
                                                 std::get<0>(config));
-                if (window->load_configuration_parameters(element)) {
-                    add_window(window);
-                } else {
-                    window->deleteLater();
-                }
+                add_loaded_window(window, element);
 
             } else {
                 throw AppException("Invalid file");
@@ -597,6 +776,20 @@ void MainWindow::load_windows(const QDomNode &node)
 }
 
 
+void MainWindow::add_loaded_window(RegisterDisplay *const window, const QDomElement &element)
+{
+    if (window->load_configuration_parameters(element)) {
+        if (window->get_endpoint() >= m_endpoints.size()) {
+            window->deleteLater();
+            throw AppException("Invalid file");
+        }
+        add_window(window);
+    } else {
+        window->deleteLater();
+    }
+}
+
+
 BaseData MainWindow::load_base_data(const QDomElement &node) const
 {
     auto slave_id = node.attribute("node").toInt();
@@ -628,91 +821,183 @@ void MainWindow::on_actionRead_Metadata_triggered()
 }
 
 
+void MainWindow::on_actionRevalidate_Metadata_triggered()
+{
+    for (auto &i: m_endpoints) {
+        i.scheduler->set_metadata_revalidation(m_ui->actionRevalidate_Metadata->isChecked());
+    }
+}
+
+
 void MainWindow::on_actionLoad_Register_Data_triggered()
 {
     auto file_dialog = QFileDialog(this, tr("Load data..."));
     file_dialog.setNameFilters({tr("Spreadsheet (*.csv)"),
+                           tr("Capture (*.%1)").arg(capture_file::SUFFIX),
                            tr("All files (*)")});
     file_dialog.setAcceptMode(QFileDialog::AcceptOpen);
     file_dialog.setViewMode(QFileDialog::Detail);
     file_dialog.setFileMode(QFileDialog::ExistingFile);
     if (file_dialog.exec() != 0) {
-        auto success = true;
         try {
             const auto filename = file_dialog.selectedFiles().first();
-            const auto all_data = QtCSV::Reader::readToList(filename);
-            auto csv_dialog = CsvImporter(this, all_data);
+            if (filename.endsWith(QString(".") + capture_file::SUFFIX)) {
+                try {
+                    load_capture_data(filename);
+                } catch (const FileLoadException &e) {
+                    QMessageBox::warning(this, tr("Load Register Data"), QString(e));
+                }
+                return;
+            }
+
+            if (nullptr != m_csv_reader) {
+                QMessageBox::information(this, tr("Load data"),
+                                         tr("The previous file is still being loaded."));
+                return;
+            }
+
+            const auto preview = CsvStreamReader::read_preview(filename, g_csv_preview_rows);
+            auto csv_dialog = CsvImporter(this, preview);
             if (csv_dialog.exec() != 0) {
                 auto config = csv_dialog.get_config();
-                load_csv_data(all_data,
+                load_csv_data(filename,
                               std::get<TestFields::REG_VALUE>(config),
                               std::get<TestFields::REG_NUMBER>(config),
                               std::get<TestFields::NODE_ID>(config),
                               std::get<TestFields::HEADER_ROW>(config));
             }
-        } catch (const FileLoadException&) {
-            success = false;
-        } if (success) {
+        } catch (const FileLoadException &e) {
+            QMessageBox::warning(this, tr("Load Register Data"), QString(e));
         }
     }
 }
 
 
-void MainWindow::load_csv_data(const QList<QStringList> &all_data,
+void MainWindow::load_csv_data(const QString &path,
                                const size_t value_index,
                                const size_t register_index,
                                const ssize_t node_index,
                                const bool skip_first_row)
 {
-    int fixed_node=0;
-    if (node_index < 0) {
-        fixed_node = qint16(node_index * -1);
-        --fixed_node;
-    }
+    m_csv_reader = new CsvStreamReader(this, path, value_index, register_index,
+                                       node_index, skip_first_row);
+    connect(m_csv_reader, &CsvStreamReader::chunk_ready, this, &MainWindow::csv_on_chunk_ready);
+    connect(m_csv_reader, &CsvStreamReader::finished,
+            this, [=](const bool success, const QString error) {
+        //  Chunks are queued before ``finished`` is emitted, collect any left.
+        csv_on_chunk_ready();
+        auto plan = m_csv_reader->take_plan();
+        m_csv_reader->deleteLater();
+        m_csv_reader = nullptr;
+        if (success) {
+            m_ui->statusbar->showMessage(tr("Register data loaded"));
+            send_writes(0, std::move(plan));
+        } else if (!error.isEmpty()) {
+            QMessageBox::warning(this, tr("Load data"),
+                                 tr("Cannot read file %1:\n%2.")
+                                 .arg(QDir::toNativeSeparators(path), error));
+        } else {}
+    });
+    m_csv_reader->start();
+}
 
-    WriteRequest writes{};
 
-    auto i = all_data.begin();
-    if (skip_first_row) {
-        ++i;
+void MainWindow::csv_on_chunk_ready()
+{
+    if (nullptr == m_csv_reader) {
+        return;
     }
-    for (; all_data.end() != i; ++i) {
-        auto regnum = (*i)[int(register_index)].toInt();
-        auto value = (*i)[int(value_index)].toInt();
-        auto node = (node_index < 0 ? fixed_node : (*i)[node_index].toInt());
 
-        emit m_scheduler->new_register_data(quint16(regnum), quint16(value), quint8(node));
-        if ((regnum < 10000 && regnum > 0) || (regnum > 40000 && regnum < 50000)) {
-            append_write(writes, quint16(regnum), quint16(value), quint8(node));
+    CsvChunk chunk;
+    while (m_csv_reader->take_chunk(chunk)) {
+        for (const auto &i: chunk.values) {
+            emit register_data(0, i.reg, i.value, i.node);
         }
+        m_ui->statusbar->showMessage(tr("Loading register data %1%").arg(chunk.percent));
     }
+}
+
 
-    if (writes.values.size() > 0) {
-        m_scheduler->modbus_on_write_request(std::move(writes));
+void MainWindow::load_capture_data(const QString &path)
+{
+    auto reader = CaptureReader(path);
+    std::map<quint8, std::vector<WriteValue>> writes;
+    QStringList unconfigured;
+    for (size_t i=0; i<reader.size(); ++i) {
+        const auto &series = reader.get_series(i);
+        if (0U == series.rows) {
+            continue;
+        }
+
+        const auto configured = (size_t(series.endpoint) < m_endpoints.size());
+        if (!configured) {
+            unconfigured << tr("Endpoint %1, node %2, registers %3 - %4")
+                            .arg(series.endpoint).arg(series.node)
+                            .arg(series.first_register)
+                            .arg(series.first_register + series.width - 1);
+        }
+
+        const auto values = reader.read_values(i);
+        const auto newest = values.data() + (size_t(series.rows - 1U) * series.width);
+        for (quint16 j=0U; j<series.width; ++j) {
+            const auto regnum = quint16(series.first_register + j);
+            emit register_data(series.endpoint, regnum, newest[j], series.node);
+            if (configured) {
+                writes[series.endpoint].push_back({series.node, regnum, newest[j]});
+            }
+        }
+    }
+
+    if (!unconfigured.isEmpty()) {
+        auto warning = QMessageBox(this);
+        warning.setIcon(QMessageBox::Warning);
+        warning.setStandardButtons(QMessageBox::Ok);
+        warning.setWindowTitle(tr("Write Register Data"));
+        warning.setText(tr("%1 series were recorded from endpoints not configured "
+                           "in this session and will not be written.")
+                        .arg(unconfigured.size()));
+        warning.setDetailedText(unconfigured.join('\n'));
+        warning.exec();
+    }
+
+    for (auto &i: writes) {
+        send_writes(i.first, write_planner::plan(std::move(i.second)));
     }
 }
 
 
-void MainWindow::append_write(WriteRequest &wr,
-                              const quint16 reg,
-                              const quint16 value,
-                              const quint8 node)
+void MainWindow::send_writes(const quint8 endpoint, WritePlan &&plan)
 {
-    if (wr.values.size() > 0) {
-        const auto next_reg = quint16(wr.first_register + wr.values.size());
-        const auto max = (reg < 10000 ? 0x7D0U : 127U);
-        if (reg != next_reg || node != wr.node || wr.values.size() >= max) {
-            m_scheduler->modbus_on_write_request(std::move(wr));
-            wr = WriteRequest{};
-            wr.first_register = reg;
-        }
+    if (plan.writes.empty()) {
+        return;
+    }
+
+    size_t coils;
+    size_t registers;
+    write_planner::count_requests(plan, coils, registers);
+    auto summary = QMessageBox(this);
+    summary.setIcon(QMessageBox::Question);
+    summary.setStandardButtons(QMessageBox::Ok | QMessageBox::Cancel);
+    summary.setWindowTitle(tr("Write Register Data"));
+    if (m_endpoints.size() > 1U) {
+        summary.setText(tr("Write %1 values to %2 in %3 requests?")
+                        .arg(plan.values - plan.duplicates)
+                        .arg(get_endpoint_name(endpoint))
+                        .arg(plan.writes.size()));
     } else {
-        wr.first_register = reg;
+        summary.setText(tr("Write %1 values to the device in %2 requests?")
+                        .arg(plan.values - plan.duplicates).arg(plan.writes.size()));
+    }
+    summary.setInformativeText(tr("%1 coil writes, %2 holding register writes.\n"
+                                  "%3 values replaced by a later value for the same register.")
+                               .arg(coils).arg(registers).arg(plan.duplicates));
+    if (summary.exec() != QMessageBox::Ok) {
+        return;
     }
 
-    wr.values.push_back(value);
-    wr.node = node;
-    wr.requester = nullptr;
+    for (auto &i: plan.writes) {
+        m_endpoints[endpoint].scheduler->modbus_on_write_request(std::move(i));
+    }
 }
 
 
@@ -721,8 +1006,12 @@ void MainWindow::on_actionTrend_triggered()
     if (nullptr == m_trend) {
         m_ui->actionTrend->setEnabled(false);
         m_trend = new TrendWindow(this);
-        connect(m_scheduler, &Scheduler::new_register_data,
-                m_trend, &TrendWindow::on_new_value);
+        connect(this, &MainWindow::register_data,
+                m_trend, &TrendWindow::on_endpoint_value);
+        connect(this, &MainWindow::poll_statistics,
+                m_trend, &TrendWindow::on_poll_statistics);
+        connect(m_trend, &TrendWindow::poll_configuration_changed,
+                this, &MainWindow::window_on_poll_configuration_changed);
         connect(m_trend, &TrendWindow::window_closed,
                 this, &MainWindow::trend_on_closed);
         m_trend->show();
@@ -733,23 +1022,191 @@ void MainWindow::on_actionTrend_triggered()
 void MainWindow::trend_on_closed(BaseDialog *w)
 {
     if (w == m_trend) {
-        disconnect(m_scheduler, &Scheduler::new_register_data,
-                   m_trend, &TrendWindow::on_new_value);
+        disconnect(this, &MainWindow::register_data,
+                   m_trend, &TrendWindow::on_endpoint_value);
+        disconnect(this, &MainWindow::poll_statistics,
+                   m_trend, &TrendWindow::on_poll_statistics);
+        disconnect(m_trend, &TrendWindow::poll_configuration_changed,
+                   this, &MainWindow::window_on_poll_configuration_changed);
+        for (auto &i: m_endpoints) {
+            i.scheduler->remove_reference(m_trend);
+        }
         m_trend = nullptr;
         m_ui->actionTrend->setEnabled(true);
     }
 }
 
 
-void MainWindow::modbus_on_error_protocol(const int error_code)
+void MainWindow::modbus_on_error_protocol(const quint8 endpoint, const int error_code)
 {
-    if (m_connecting) {
-        post_disconnected();
-        m_ui->statusbar->showMessage(tr("Connection failed: %1")
-                                     .arg(tr(modbus_strerror(error_code))));
-    } else if (m_connecting2) {
-        //  Device ID probably unsupported
-        m_connecting2=false;
+    auto &connection = m_endpoints[endpoint];
+    if (connection.connecting) {
+        //  A device that cannot be reached does not stop the others.
+        connection.connecting = false;
+        disconnect(connection.engine, nullptr, this, nullptr);
+        //  Release the connection (the polling thread has already exited).
+        connection.engine->close();
+        connection.engine = nullptr;
+        m_connecting = std::any_of(m_endpoints.begin(), m_endpoints.end(),
+                                   [](const Endpoint &i) { return i.connecting; });
+        if (!m_connected && !m_connecting) {
+            post_disconnected();
+        }
+
+        if (m_endpoints.size() > 1U) {
+            m_ui->statusbar->showMessage(tr("Connection to %1 failed: %2")
+                                         .arg(get_endpoint_name(endpoint))
+                                         .arg(tr(modbus_strerror(error_code))));
+        } else {
+            m_ui->statusbar->showMessage(tr("Connection failed: %1")
+                                         .arg(tr(modbus_strerror(error_code))));
+        }
     } else {
     }
 }
+
+
+void MainWindow::window_on_write_request(WriteRequest request)
+{
+    auto scheduler = get_scheduler(request.requester);
+    if (nullptr != scheduler) {
+        scheduler->modbus_on_write_request(std::move(request));
+    }
+}
+
+
+void MainWindow::window_on_metadata_request(WindowMetadataRequest request)
+{
+    auto scheduler = get_scheduler(request.requester);
+    if (nullptr != scheduler) {
+        scheduler->modbus_on_poll_meta(std::move(request));
+    }
+}
+
+
+void MainWindow::on_actionEndpoints_triggered()
+{
+    auto dialog = EndpointsDialog(this, get_endpoint_addresses());
+    if (dialog.exec() != 0) {
+        set_endpoints(dialog.get_endpoints());
+    }
+}
+
+
+void MainWindow::set_endpoints(const std::vector<EndpointAddress> &endpoints)
+{
+    while (m_endpoints.size() > endpoints.size()) {
+        m_endpoints.back().scheduler->deleteLater();
+        m_endpoints.pop_back();
+    }
+
+    for (size_t i=0U; i<endpoints.size(); ++i) {
+        if (i < m_endpoints.size()) {
+            m_endpoints[i].address = endpoints[i];
+        } else {
+            m_endpoints.push_back({endpoints[i], create_scheduler(quint8(i)), nullptr, false, false});
+        }
+    }
+
+    m_ui->ipEdit->setText(endpoints[0].first);
+    m_ui->portEdit->setText(QString::number(endpoints[0].second));
+
+    //  New schedulers start with an empty index.
+    for (auto i: m_register_windows) {
+        register_displayed_ranges(i);
+    }
+    if (nullptr != m_trend) {
+        register_displayed_ranges(m_trend);
+    }
+}
+
+
+std::vector<EndpointAddress> MainWindow::get_endpoint_addresses() const
+{
+    std::vector<EndpointAddress> endpoints;
+    endpoints.reserve(m_endpoints.size());
+    for (const auto &i: m_endpoints) {
+        endpoints.push_back(i.address);
+    }
+    endpoints[0] = {m_ui->ipEdit->text(), quint16(m_ui->portEdit->text().toInt())};
+
+    return endpoints;
+}
+
+
+Scheduler *MainWindow::create_scheduler(const quint8 endpoint)
+{
+    auto scheduler = new Scheduler(this, endpoint);
+    scheduler->set_metadata_revalidation(m_ui->actionRevalidate_Metadata->isChecked());
+    connect(scheduler, &Scheduler::new_register_data, this,
+            [=](const quint16 regnumber, const quint16 value, const quint8 device_id) {
+        emit register_data(endpoint, regnumber, value, device_id);
+    });
+    connect(scheduler, &Scheduler::poll_exception, this, &MainWindow::poll_exception);
+    connect(scheduler, &Scheduler::poll_statistics, this, [=](const PollStatistics statistics) {
+        emit poll_statistics(endpoint, statistics);
+    });
+    connect(scheduler, &Scheduler::device_identified, this, [=](const QString device_id) {
+        modbus_on_device_identified(endpoint, device_id);
+    });
+
+    return scheduler;
+}
+
+
+Scheduler *MainWindow::get_scheduler(BaseDialog *const requester)
+{
+    const auto endpoint = (nullptr == requester ? quint8(0) : requester->get_endpoint());
+    if (endpoint >= m_endpoints.size()) {
+        emit poll_exception(requester, tr("Endpoint %1 not configured").arg(int(endpoint)));
+        return nullptr;
+    }
+
+    return m_endpoints[endpoint].scheduler;
+}
+
+
+std::vector<std::vector<PollSubscription>> MainWindow::get_subscriptions(BaseDialog *const window)
+{
+    std::vector<std::vector<PollSubscription>> subscriptions(m_endpoints.size());
+    for (const auto &i: window->get_poll_subscriptions()) {
+        if (i.endpoint < m_endpoints.size()) {
+            subscriptions[i.endpoint].push_back(i);
+        } else {
+            emit poll_exception(window, tr("Endpoint %1 not configured").arg(int(i.endpoint)));
+        }
+    }
+
+    return subscriptions;
+}
+
+
+void MainWindow::subscribe_window(BaseDialog *const window)
+{
+    auto subscriptions = get_subscriptions(window);
+    for (size_t i=0U; i<m_endpoints.size(); ++i) {
+        m_endpoints[i].scheduler->set_subscriptions(window, std::move(subscriptions[i]));
+    }
+}
+
+
+void MainWindow::register_displayed_ranges(BaseDialog *const window)
+{
+    for (auto &i: m_endpoints) {
+        i.scheduler->unsubscribe_registers(window);
+    }
+
+    //  Ranges bound to an unknown endpoint are reported when polled.
+    for (const auto &i: window->get_displayed_ranges()) {
+        if (i.endpoint < m_endpoints.size()) {
+            m_endpoints[i.endpoint].scheduler->subscribe_registers(window, i.range);
+        }
+    }
+}
+
+
+QString MainWindow::get_endpoint_name(const quint8 endpoint) const
+{
+    const auto &address = m_endpoints[endpoint].address;
+    return address.first % QChar(':') % QString::number(address.second);
+}
@@ -27,7 +27,9 @@
 #define MAINWINDOW_H
 
 //  c++ includes
+#include <chrono>  //  std::chrono::milliseconds
 #include <unordered_set>  //  std::unordered_set
+#include <vector>  //  std::vector
 #include <QList>  //  QList
 #include <QMainWindow>  //  QMainWindow
 #include <QTimer>  //  QTimer
@@ -40,12 +42,18 @@
 
 // project includes
 #include "register_display.h"  //  RegisterDisplay
-#include "modbusthread.h"  //  ModbusThread
+#include "modbus_connection.h"  //  ModbusConnection
+#include "epoll_engine.h"  //  EpollEngine
 #include "write_event.h"  //  WriteRequest
 #include "scheduler.h"  //  Scheduler
 #include "ui_mainwindow.h"  //  Ui::MainWindow
 #include "trend_window.h"  //  TrendWindow
 #include "base_dialog.h"  //  BaseDialog
+#include "endpoints_dialog.h"  //  EndpointAddress
+#include "metadata_structs.h"  //  WindowMetadataRequest
+#include "poll_subscription.h"  //  PollSubscription, PollStatistics
+#include "csv_stream_reader.h"  //  CsvStreamReader
+#include "write_planner.h"  //  WritePlan
 
 
 /**
@@ -67,6 +75,39 @@ public:
 
     virtual void closeEvent(QCloseEvent *evt) override;
 
+signals:
+
+    /**
+     * \brief Emit register data received from any endpoint.
+     * \note
+     * Carries the scheduler system registers and values loaded from CSV or
+     * capture files.  Polled reads are delivered to the windows directly by
+     * the scheduler \sa Scheduler::subscribe_registers
+     *
+     * @param endpoint endpoint the data was read from
+     * @param regnumber register number
+     * @param value raw register value
+     * @param device_id node / unit ID polled
+     */
+    void register_data(const quint8 endpoint,
+                       const quint16 regnumber,
+                       const quint16 value,
+                       const quint8 device_id);
+
+    /**
+     * \brief Emit poll exception reported by any endpoint.
+     * @param requester Originating reqest window
+     * @param exception exception text
+     */
+    void poll_exception(BaseDialog *const requester, const QString exception);
+
+    /**
+     * \brief Emit the timing achieved by a periodic poll of any endpoint.
+     * @param endpoint endpoint polled
+     * @param statistics rate and missed deadlines of the poll
+     */
+    void poll_statistics(const quint8 endpoint, const PollStatistics statistics);
+
 private slots:
 
     /**
@@ -102,15 +143,36 @@ private slots:
     void modbus_on_error(BaseDialog *const requester, const QString exception);
 
     /**
-     * \brief Signal modbus poll complete (from modbus thread).
+     * \brief Signal modbus connection complete (from modbus thread).
+     * @param endpoint endpoint that connected
      */
-    void modbus_on_data();
+    void modbus_on_data(const quint8 endpoint);
 
     /**
      * @brief Signal modbus error (from modbus thread).
+     * @param endpoint endpoint reporting the error
      * @param error_code modbus error code
      */
-    void modbus_on_error_protocol(const int error_code);
+    void modbus_on_error_protocol(const quint8 endpoint, const int error_code);
+
+    /**
+     * \brief Signal device ID read after connecting (scheduler).
+     * @param endpoint endpoint identified
+     * @param device_id device identification string
+     */
+    void modbus_on_device_identified(const quint8 endpoint, const QString device_id);
+
+    /**
+     * \brief Signal a window requested a write (routed to its endpoint).
+     * @param request write request structure
+     */
+    void window_on_write_request(WriteRequest request);
+
+    /**
+     * \brief Signal a window requested metadata (routed to its endpoint).
+     * @param request read metadata request structure
+     */
+    void window_on_metadata_request(WindowMetadataRequest request);
 
     /**
      * \brief Signal Poll Once menu item triggered.
@@ -134,9 +196,10 @@ private slots:
     void update_timer_on_expired();
 
     /**
-     * \brief Signal that standard polling is complete (scheduler).
+     * \brief Signal a window changed the registers it polls or their period.
+     * @param window window to re-subscribe
      */
-    void polling_on_complete();
+    void window_on_poll_configuration_changed(BaseDialog *window);
 
     /**
      * \brief Signal save current session menu item triggered.
@@ -153,11 +216,21 @@ private slots:
      */
     void on_actionRead_Metadata_triggered();
 
+    /**
+     * \brief Signal Revalidate Cached Metadata menu item triggered.
+     */
+    void on_actionRevalidate_Metadata_triggered();
+
     /**
      * \brief Signal read metadata menu item triggered.
      */
     void on_actionLoad_Register_Data_triggered();
 
+    /**
+     * \brief Signal edit endpoints menu item triggered.
+     */
+    void on_actionEndpoints_triggered();
+
     /**
      * \brief Signal new Trend menu item triggered.
      */
@@ -168,13 +241,95 @@ private slots:
      */
     void trend_on_closed(BaseDialog *w);
 
+    /**
+     * \brief Signal CSV rows read - disseminate values and issue the writes.
+     */
+    void csv_on_chunk_ready();
+
 private:
 
+    /**
+     * \brief Run-time state of a single endpoint (device connection)
+     */
+    struct Endpoint {
+        EndpointAddress address;  /**< host / port (0 = taken from the UI) */
+        Scheduler *scheduler;  /**< Dedicated poll scheduler */
+        ModbusConnection *engine;  /**< Connection, ``nullptr`` when closed */
+        bool connecting;  /**< Connection in progress */
+        bool connected;  /**< Connection established */
+    };
+
+    /**
+     * \brief Replace the session endpoint list.
+     * \note
+     * Only to be called while disconnected.
+     *
+     * @param endpoints new endpoint list (must contain at least 1 entry)
+     */
+    void set_endpoints(const std::vector<EndpointAddress> &endpoints);
+
+    /**
+     * \brief Get the session endpoint list (endpoint 0 read from the UI).
+     * @return endpoint list
+     */
+    [[nodiscard]] std::vector<EndpointAddress> get_endpoint_addresses() const;
+
+    /**
+     * \brief Create and connect the scheduler for an endpoint.
+     * @param endpoint endpoint index
+     * @return new scheduler
+     */
+    [[nodiscard]] Scheduler *create_scheduler(const quint8 endpoint);
+
+    /**
+     * \brief Find the scheduler polling on behalf of a window.
+     * @param requester window (``nullptr`` = endpoint 0)
+     * @return scheduler, ``nullptr`` if the endpoint is not configured
+     */
+    [[nodiscard]] Scheduler *get_scheduler(BaseDialog *const requester);
+
+    /**
+     * \brief Split the periodic polls of a window by endpoint.
+     * @param window window (or trend) polled
+     * @return subscriptions, indexed by endpoint
+     */
+    [[nodiscard]] std::vector<std::vector<PollSubscription>>
+        get_subscriptions(BaseDialog *const window);
+
+    /**
+     * \brief Hand the periodic polls of a window to every endpoint.
+     * @param window window (or trend) polled
+     */
+    void subscribe_window(BaseDialog *const window);
+
+    /**
+     * \brief Register the registers displayed by a window for delivery.
+     * @param window window (or trend) displaying data
+     */
+    void register_displayed_ranges(BaseDialog *const window);
+
+    /**
+     * \brief Get the display name (host:port) of an endpoint.
+     * @param endpoint endpoint index
+     */
+    [[nodiscard]] QString get_endpoint_name(const quint8 endpoint) const;
+
+    /**
+     * \brief Close every open connection and apply disconnected logic.
+     */
+    void close_endpoints();
+
     /**
      * \brief After connection completed logic.
      */
     void post_connected();
 
+    /**
+     * \brief Read (and correct) the request timeout from the UI.
+     * @return request timeout
+     */
+    [[nodiscard]] std::chrono::milliseconds get_timeout();
+
     /**
      * \brief After Modbus thread closed logic.
      */
@@ -201,6 +356,14 @@ private:
      */
     void add_window(RegisterDisplay *const window);
 
+    /**
+     * \brief Apply saved parameters to a window and add it if valid.
+     * @throws AppException if the window is bound to an unknown endpoint
+     * @param window window created from the configuration
+     * @param element Window XML element node.
+     */
+    void add_loaded_window(RegisterDisplay *const window, const QDomElement &element);
+
     /**
      * \brief Load the "communications" section of the configuration.
      * @throws AppException on error
@@ -225,39 +388,51 @@ private:
         load_base_data(const QDomElement &node) const;
 
     /**
-     * \brief Load data from CSV and disseminate to components (windows, protocol layer)
-     * @param all_data parsed array of CSV data
+     * \brief Start loading data from CSV and disseminating it to components
+     *        (windows, protocol layer) as the file is read.
+     * @param path CSV file
      * @param value_index index of field to interpret as the "value"
      * @param register_index index of field to interpret as the "register number"
      * @param node_index when >= 0 index of the field to interpret as the "Device ID"
      *                   when < 0 the absolute value is \f node + 1 \f
      * @param skip_first_row set ``true`` to skip the first row
      */
-    void load_csv_data(const QList<QStringList> &all_data,
+    void load_csv_data(const QString &path,
                        const size_t value_index,
                        const size_t register_index,
                        const ssize_t node_index,
                        const bool skip_first_row);
 
     /**
-     * \brief Append data to an outgoind write request
-     * @param wr reference to the write request
-     * @param reg register number
-     * @param value value to write
-     * @param node Device ID receiving the write
+     * \brief Load the newest values of a capture file and disseminate to
+     *        components (windows, protocol layer)
+     * \note
+     * Only the value columns are decoded.  Writes are planned and sent
+     * separately for each endpoint recorded, series recorded from an endpoint
+     * not configured in this session are reported and not written.
+     *
+     * @param path capture file
+     * @throws FileLoadException if the file is not a valid capture
+     */
+    void load_capture_data(const QString &path);
+
+    /**
+     * \brief Show a summary of the writes planned and send them if accepted.
+     * @param endpoint endpoint written to (must be configured)
+     * @param plan planned writes
      */
-    void append_write(WriteRequest &wr, const quint16 reg, const quint16 value, const quint8 node);
+    void send_writes(const quint8 endpoint, WritePlan &&plan);
 
     Ui::MainWindow *const m_ui;
     bool m_connected;
     bool m_connecting=false;
-    bool m_connecting2=false;
     bool m_active=false;
     std::unordered_set<RegisterDisplay*> m_register_windows;
-    ModbusThread *m_engine=nullptr;
-    Scheduler *const m_scheduler;
+    std::vector<Endpoint> m_endpoints;
     QTimer *const m_update_timer;
+    EpollEngine *const m_io_engine;
     TrendWindow *m_trend;
+    CsvStreamReader *m_csv_reader = nullptr;  /**< CSV file being loaded */
 };
 
 
@@ -0,0 +1,316 @@
+/**
+ * \file mbap_codec.cpp
+ * \brief Modbus/TCP (MBAP) request/response framing
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <algorithm>  //  std::min
+
+// C includes
+#include <modbus/modbus.h>  //  MODBUS_ENOBASE, EMBBADDATA, MODBUS_MAX_*
+
+// project includes
+#include "mbap_codec.h"  //  local include
+#include "packed_bits.h"  //  packed_bits::pack_bytes
+
+
+namespace {
+    const quint8 g_fc_read_coils = 0x01;
+    const quint8 g_fc_read_inputs = 0x02;
+    const quint8 g_fc_read_holding = 0x03;
+    const quint8 g_fc_read_input_regs = 0x04;
+    const quint8 g_fc_write_coil = 0x05;
+    const quint8 g_fc_write_register = 0x06;
+    const quint8 g_fc_write_coils = 0x0F;
+    const quint8 g_fc_write_registers = 0x10;
+    const quint8 g_fc_report_slave_id = 0x11;
+    const quint8 g_exception_flag = 0x80;
+
+
+    /**
+     * \brief Determine the function code and zero-based address of a request.
+     * @param t transaction
+     * @param address [out] protocol address
+     * @return function code, 0 if the request is illegal
+     */
+    quint8 get_function_code(const ModbusTransaction &t, quint16 &address)
+    {
+        address = 0;
+        if (0 != t.function_code) {
+            return quint8(t.function_code);
+        }
+
+        const auto reg = t.first_register;
+        if (t.write) {
+            const auto single = (t.values.size() == 1U);
+            if (reg >= 1 && reg <= 9999) {
+                address = quint16(reg - 1);
+                return (single ? g_fc_write_coil : g_fc_write_coils);
+            } else if (reg >= 40001 && reg <= 49999) {
+                address = quint16(reg - 40001);
+                return (single ? g_fc_write_register : g_fc_write_registers);
+            } else {
+                return 0;
+            }
+        }
+
+        if (0 == reg) {
+            return g_fc_report_slave_id;
+        } else if (reg >= 1 && reg <= 9999) {
+            address = quint16(reg - 1);
+            return g_fc_read_coils;
+        } else if (reg >= 10001 && reg <= 19999) {
+            address = quint16(reg - 10001);
+            return g_fc_read_inputs;
+        } else if (reg >= 30001 && reg <= 39999) {
+            address = quint16(reg - 30001);
+            return g_fc_read_input_regs;
+        } else if (reg >= 40001 && reg <= 49999) {
+            address = quint16(reg - 40001);
+            return g_fc_read_holding;
+        } else {
+            return 0;
+        }
+    }
+
+
+    void append_u16(std::vector<quint8> &buffer, const quint16 value)
+    {
+        buffer.push_back(quint8(value >> 8U));
+        buffer.push_back(quint8(value));
+    }
+
+
+    quint16 read_u16(const quint8 *const data)
+    {
+        return quint16((quint16(data[0]) << 8U) | quint16(data[1]));
+    }
+
+}  //  Anonymous namespace
+
+
+std::vector<quint8> mbap::encode_request(const ModbusTransaction &transaction)
+{
+    quint16 address;
+    const auto fc = get_function_code(transaction, address);
+    if (0 == fc) {
+        return {};
+    }
+
+    std::vector<quint8> pdu;
+    pdu.reserve(MODBUS_MAX_PDU_LENGTH);
+    pdu.push_back(fc);
+
+    const auto write_count = transaction.values.size();
+    switch (fc) {
+    case g_fc_read_coils:
+    case g_fc_read_inputs:
+        if (transaction.count < 1 || transaction.count > MODBUS_MAX_READ_BITS) {
+            return {};
+        }
+        append_u16(pdu, address);
+        append_u16(pdu, transaction.count);
+        break;
+
+    case g_fc_read_holding:
+    case g_fc_read_input_regs:
+        if (transaction.count < 1 || transaction.count > MODBUS_MAX_READ_REGISTERS) {
+            return {};
+        }
+        append_u16(pdu, address);
+        append_u16(pdu, transaction.count);
+        break;
+
+    case g_fc_write_coil:
+        append_u16(pdu, address);
+        append_u16(pdu, (transaction.values[0] > 0 ? 0xFF00U : 0x0000U));
+        break;
+
+    case g_fc_write_register:
+        append_u16(pdu, address);
+        append_u16(pdu, transaction.values[0]);
+        break;
+
+    case g_fc_write_coils: {
+            if (write_count < 1 || write_count > MODBUS_MAX_WRITE_BITS) {
+                return {};
+            }
+            const auto byte_count = (write_count + 7U) / 8U;
+            append_u16(pdu, address);
+            append_u16(pdu, quint16(write_count));
+            pdu.push_back(quint8(byte_count));
+            const auto first_byte = pdu.size();
+            pdu.resize(first_byte + byte_count, 0);
+            for (size_t i=0U; i<write_count; ++i) {
+                if (transaction.values[i] > 0) {
+                    pdu[first_byte + (i / 8U)] |= quint8(1U << (i % 8U));
+                }
+            }
+        } break;
+
+    case g_fc_write_registers:
+        if (write_count < 1 || write_count > MODBUS_MAX_WRITE_REGISTERS) {
+            return {};
+        }
+        append_u16(pdu, address);
+        append_u16(pdu, quint16(write_count));
+        pdu.push_back(quint8(write_count * 2U));
+        for (const auto i: transaction.values) {
+            append_u16(pdu, i);
+        }
+        break;
+
+    case g_fc_report_slave_id:
+        break;
+
+    default:
+        //  Custom function
+        if (transaction.raw_pdu.size() >= MODBUS_MAX_PDU_LENGTH) {
+            return {};
+        }
+        pdu.insert(pdu.end(), transaction.raw_pdu.begin(), transaction.raw_pdu.end());
+        break;
+    }
+
+    std::vector<quint8> adu;
+    adu.reserve(HEADER_LENGTH + pdu.size());
+    append_u16(adu, transaction.transaction_id);
+    append_u16(adu, 0);  //  Protocol ID: Modbus
+    append_u16(adu, quint16(pdu.size() + 1U));  //  Unit ID + PDU
+    adu.push_back(transaction.node);
+    adu.insert(adu.end(), pdu.begin(), pdu.end());
+
+    return adu;
+}
+
+
+int mbap::frame_length(const quint8 *const data, const size_t length)
+{
+    if (length < HEADER_LENGTH) {
+        return 0;
+    }
+
+    if (read_u16(&data[2]) != 0) {
+        return -1;
+    }
+
+    const auto adu_length = int(read_u16(&data[4]));
+    if (adu_length < 2 || adu_length > MODBUS_MAX_PDU_LENGTH + 1) {
+        return -1;
+    }
+
+    const auto total = adu_length + int(HEADER_LENGTH) - 1;
+    if (size_t(total) > length) {
+        return 0;
+    }
+
+    return total;
+}
+
+
+quint16 mbap::transaction_id(const quint8 *const data)
+{
+    return read_u16(data);
+}
+
+
+ModbusResult mbap::decode_response(const ModbusTransaction &transaction,
+                                   const quint8 *const data,
+                                   const size_t length)
+{
+    quint16 address;
+    const auto fc = get_function_code(transaction, address);
+    auto result = error_result(transaction, 0);
+    if (length < HEADER_LENGTH + 2U) {
+        result.error_code = EMBBADDATA;
+        return result;
+    }
+
+    const auto pdu = &data[HEADER_LENGTH];
+    const auto pdu_length = length - HEADER_LENGTH;
+    if (pdu[0] == (fc | g_exception_flag)) {
+        result.error_code = MODBUS_ENOBASE + int(pdu[1]);
+        return result;
+    } else if (pdu[0] != fc) {
+        result.error_code = EMBBADDATA;
+        return result;
+    } else {
+
+    }
+
+    const auto byte_count = size_t(pdu[1]);
+    switch (fc) {
+    case g_fc_read_coils:
+    case g_fc_read_inputs:
+        if ((byte_count < (transaction.count + 7U) / 8U) || (pdu_length < byte_count + 2U)) {
+            result.error_code = EMBBADDATA;
+        } else {
+            packed_bits::pack_bytes(&pdu[2U], transaction.count, result.bits);
+            result.bit_count = transaction.count;
+        }
+        break;
+
+    case g_fc_read_holding:
+    case g_fc_read_input_regs:
+        if ((byte_count != transaction.count * 2U) || (pdu_length < byte_count + 2U)) {
+            result.error_code = EMBBADDATA;
+        } else {
+            result.regs.resize(transaction.count);
+            for (size_t i=0U; i<transaction.count; ++i) {
+                result.regs[i] = read_u16(&pdu[2U + (i * 2U)]);
+            }
+        }
+        break;
+
+    case g_fc_write_coil:
+    case g_fc_write_register:
+    case g_fc_write_coils:
+    case g_fc_write_registers:
+        //  Echo of the request, nothing to report.
+        break;
+
+    case g_fc_report_slave_id:
+        result.bytes.assign(pdu + 2U, pdu + std::min(byte_count + 2U, pdu_length));
+        break;
+
+    default:
+        //  Custom function: everything following the function code.
+        result.bytes.assign(pdu + 1U, pdu + pdu_length);
+        break;
+    }
+
+    return result;
+}
+
+
+ModbusResult mbap::error_result(const ModbusTransaction &transaction, const int error_code)
+{
+    quint16 address;
+    ModbusResult result;
+    result.transaction_id = transaction.transaction_id;
+    result.node = transaction.node;
+    result.function_code = qint8(get_function_code(transaction, address));
+    result.first_register = (0 != transaction.function_code ? 0xFFFFU : transaction.first_register);
+    result.error_code = error_code;
+    return result;
+}
@@ -0,0 +1,162 @@
+/**
+ * \file mbap_codec.h
+ * \brief Modbus/TCP (MBAP) request/response framing
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * libmodbus hides the MBAP transaction identifier and only supports a single
+ * outstanding request.  This module builds request ADUs and decodes response
+ * ADUs directly so that several transactions may be queued on one socket and
+ * matched back up by their transaction ID.  Register numbers follow the same
+ * conventions as the rest of the application (eg: 1, 10001, 30001, 40001).
+ */
+
+#ifndef MBAP_CODEC_H
+#define MBAP_CODEC_H
+
+//  c++ includes
+#include <vector>  //  std::vector
+#include <QtGlobal>  //  quint8, quint16
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+/**
+ * \brief Description of a single outgoing Modbus transaction
+ */
+struct ModbusTransaction {
+    quint16 transaction_id=0; /**< MBAP transaction ID (assigned when queued) */
+
+    quint8 node=0; /**< Send request to node */
+
+    quint16 first_register=0; /**< Starting register number (0 = device id) */
+
+    quint16 count=0; /**< Number of registers to read */
+
+    bool write=false; /**< ``true`` if ``values`` are to be written */
+
+    std::vector<quint16> values; /**< List of values to be written */
+
+    qint8 function_code=0; /**< Custom function code (0 for standard requests) */
+
+    std::vector<quint8> raw_pdu; /**< Custom request data following the function code */
+};
+
+
+/**
+ * \brief Outcome of a single Modbus transaction
+ */
+struct ModbusResult {
+    quint16 transaction_id=0; /**< MBAP transaction ID of the request */
+
+    quint8 node=0; /**< Node the request was sent to */
+
+    quint16 first_register=0; /**< Starting register (0 = id, 0xffff = custom) */
+
+    qint8 function_code=0; /**< Function code of the request */
+
+    int error_code=0; /**< 0 on success, errno (libmodbus compatible) otherwise */
+
+    /**
+     * \var regs
+     * Register values.  Empty for coil / input reads \sa bits and device ID
+     * and custom responses \sa bytes
+     */
+    std::vector<quint16> regs;
+
+    /**
+     * \var bits
+     * Coil / input states packed 64 per word, least significant bit first
+     * \sa packed_bits
+     */
+    std::vector<quint64> bits;
+
+    quint16 bit_count=0; /**< Number of coils / inputs in bits */
+
+    /**
+     * \var bytes
+     * Payload of device ID and custom responses, as received.  Empty for
+     * standard register reads.
+     */
+    std::vector<quint8> bytes;
+};
+
+
+namespace mbap {
+
+    /**
+     * \brief Length of the MBAP header including the unit identifier
+     */
+    constexpr size_t HEADER_LENGTH = 7U;
+
+    /**
+     * \brief Build a complete request ADU for a transaction.
+     * @param transaction request description (including transaction ID)
+     * @return ADU bytes, empty if the register range is illegal
+     */
+    [[nodiscard]] std::vector<quint8> encode_request(const ModbusTransaction &transaction);
+
+    /**
+     * \brief Test the receive buffer for a complete response ADU.
+     * @param data start of the receive buffer
+     * @param length number of bytes available
+     * @return length of the first complete ADU, 0 if more data is needed or
+     *         <0 if the stream is not valid Modbus/TCP
+     */
+    [[nodiscard]] int frame_length(const quint8 *const data, const size_t length);
+
+    /**
+     * \brief Extract the transaction ID from an ADU.
+     * @param data start of a complete ADU
+     * @return transaction ID
+     */
+    [[nodiscard]] quint16 transaction_id(const quint8 *const data);
+
+    /**
+     * \brief Decode a response ADU against its originating request.
+     * @param transaction originating request
+     * @param data start of a complete ADU \sa frame_length
+     * @param length length of the ADU
+     * @return decoded result (``error_code`` set on an exception response)
+     */
+    [[nodiscard]] ModbusResult decode_response(const ModbusTransaction &transaction,
+                                               const quint8 *const data,
+                                               const size_t length);
+
+    /**
+     * \brief Generate a failed result for a request that was never answered.
+     * @param transaction originating request
+     * @param error_code errno (libmodbus compatible) to report
+     * @return result
+     */
+    [[nodiscard]] ModbusResult error_result(const ModbusTransaction &transaction,
+                                            const int error_code);
+
+}  //  namespace mbap
+
+
+#endif // MBAP_CODEC_H
@@ -129,6 +129,52 @@ typedef int8_t (*encoding)(void* /*request*/);
 typedef void (*release)(void* /*request*/);
 #define RELEASE_SYMBOL "release_request"
 
+
+/*
+ * API version 2 (optional)
+ *
+ * A version 2 plugin can request the metadata of a range of registers in a
+ * single PDU.  A range request is created by ``create_range_request``, then
+ * encoded, decoded and released with the version 1 functions above.  Once a
+ * response has been decoded, ``select_record`` chooses the register reported
+ * by ``decode_label``, ``read_min_max``, ``read_default`` and ``get_encoding``.
+ * Plugins that do not export all of the symbols below are used through the
+ * version 1 interface.
+ */
+
+#define PLUGIN_API_VERSION 2
+
+/**
+ * \fn plugin_api_version
+ * \brief Get the interface version implemented by the plugin.
+ * @return ``PLUGIN_API_VERSION`` (or 1)
+ */
+typedef uint32_t (*api_version)(void);
+#define API_VERSION_SYMBOL "plugin_api_version"
+
+/**
+ * \fn create_range_request
+ * \brief Create a request instance covering a range of registers.
+ * @param first_register First register number (IE 40001, or 10003)
+ * @param count [in, out] Number of registers wanted, updated with the number
+ *              the request covers (at least 1, may be fewer than wanted)
+ * @param function_code [optional, out] update with the function code
+ * @return pointer to data, or ``NULL`` if invalid
+ */
+typedef void* (*create_range)(uint16_t /*first_register*/, uint16_t* /*count*/,
+                              uint8_t* /*function_code*/);
+#define CREATE_RANGE_SYMBOL "create_range_request"
+
+/**
+ * \fn select_record
+ * \brief Select the register reported by the decode functions.
+ * @param request Range request instance with a decoded response
+ * @param register_number Register within the range
+ * @return 0 if the response holds this register, != 0 otherwise
+ */
+typedef int (*record)(void* /*request*/, uint16_t /*register_number*/);
+#define SELECT_SYMBOL "select_record"
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,254 @@
+/**
+ * \file metadata_cache.cpp
+ * \brief Register metadata remembered per device between sessions
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <QCryptographicHash>  //  QCryptographicHash
+#include <QDir>  //  QDir
+#include <QDomDocument>  //  QDomDocument
+#include <QDomElement>  //  QDomElement
+#include <QFile>  //  QFile
+#include <QFileInfo>  //  QFileInfo
+#include <QStandardPaths>  //  QStandardPaths
+#include <QTextStream>  //  QTextStream
+
+// C includes
+/* -none- */
+
+// project includes
+#include "metadata_cache.h"  //  local include
+#include "metadata_wrapper.h"  //  MetadataWrapper
+
+
+namespace {
+    const auto g_cache_directory = "metadata";  /**< Below the application data directory */
+    const auto g_root_name = "QtModbusTool_Metadata";
+    const auto g_version = "1.0";
+
+
+    /**
+     * \brief Write an optional value as an attribute.
+     * @param element element updated
+     * @param name attribute name
+     * @param value value, the attribute is omitted if empty
+     */
+    void set_optional(QDomElement &element, const QString &name, const std::optional<qint32> &value)
+    {
+        if (value) {
+            element.setAttribute(name, QString::number(*value));
+        }
+    }
+
+
+    /**
+     * \brief Read an optional value from an attribute.
+     * @param element element read
+     * @param name attribute name
+     * @return value, empty if the attribute is missing or invalid
+     */
+    std::optional<qint32> get_optional(const QDomElement &element, const QString &name)
+    {
+        if (!element.hasAttribute(name)) {
+            return std::nullopt;
+        }
+
+        bool ok;
+        const auto value = element.attribute(name).toInt(&ok);
+        if (!ok) {
+            return std::nullopt;
+        }
+        return value;
+    }
+
+}  //  Anonymous namespace
+
+
+MetadataCache::MetadataCache() :
+    m_device_id{},
+    m_path{},
+    m_entries{},
+    m_dirty{false}
+{
+}
+
+
+MetadataCache::~MetadataCache()
+{
+    close();
+}
+
+
+void MetadataCache::open(const QString &device_id)
+{
+    if (is_open() && (device_id == m_device_id)) {
+        return;
+    }
+
+    close();
+    m_device_id = device_id;
+    m_path = get_path(device_id);
+    load();
+}
+
+
+void MetadataCache::close()
+{
+    if (m_dirty) {
+        static_cast<void>(save());
+    }
+
+    m_device_id.clear();
+    m_path.clear();
+    m_entries.clear();
+    m_dirty = false;
+}
+
+
+bool MetadataCache::is_open() const noexcept
+{
+    return !m_path.isEmpty();
+}
+
+
+std::shared_ptr<Metadata> MetadataCache::find(const quint8 node, const quint16 reg) const
+{
+    const auto entry = m_entries.find(get_key(node, reg));
+    if (m_entries.end() == entry) {
+        return nullptr;
+    }
+
+    return entry->second;
+}
+
+
+void MetadataCache::store(const quint8 node, const Metadata &metadata)
+{
+    if (!is_open()) {
+        return;
+    }
+
+    //  The plugin request behind ``metadata`` is released with it, keep a copy.
+    auto entry = MetadataWrapper::get_instance()->create_record(metadata.register_number);
+    entry->label = metadata.label;
+    entry->encoding = metadata.encoding;
+    entry->min = metadata.min;
+    entry->max = metadata.max;
+    entry->dflt = metadata.dflt;
+    m_entries[get_key(node, metadata.register_number)] = std::move(entry);
+    m_dirty = true;
+}
+
+
+bool MetadataCache::save()
+{
+    if (!is_open() || !QDir().mkpath(QFileInfo(m_path).absolutePath())) {
+        return false;
+    }
+
+    auto document = QDomDocument();
+    auto root = document.createElement(g_root_name);
+    root.setAttribute("version", g_version);
+    root.setAttribute("device", m_device_id);
+    for (const auto &i: m_entries) {
+        const auto &metadata = *i.second;
+        auto element = document.createElement("register");
+        element.setAttribute("node", QString::number(i.first >> 16U));
+        element.setAttribute("number", QString::number(metadata.register_number));
+        element.setAttribute("label", metadata.label);
+        element.setAttribute("encoding", QString::number(int(metadata.encoding)));
+        set_optional(element, "min", metadata.min);
+        set_optional(element, "max", metadata.max);
+        set_optional(element, "default", metadata.dflt);
+        root.appendChild(element);
+    }
+    document.appendChild(root);
+
+    auto f = QFile(m_path);
+    if (!f.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+        return false;
+    }
+
+    auto out = QTextStream(&f);
+    out << "<?xml version=\"1.0\"?>\n";
+    document.save(out, 0);
+    f.close();
+    m_dirty = false;
+    return true;
+}
+
+
+quint32 MetadataCache::get_key(const quint8 node, const quint16 reg) noexcept
+{
+    return (quint32(node) << 16U) | quint32(reg);
+}
+
+
+QString MetadataCache::get_path(const QString &device_id)
+{
+    //  Identification strings are free text, name the file by their hash.
+    const auto name = QCryptographicHash::hash(device_id.toUtf8(), QCryptographicHash::Sha1).toHex();
+    const auto directory = QDir(QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation));
+    return directory.filePath(QString(g_cache_directory) + "/" + QString::fromLatin1(name) + ".xml");
+}
+
+
+void MetadataCache::load()
+{
+    auto f = QFile(m_path);
+    if (!f.open(QFile::ReadOnly | QFile::Text)) {
+        return;
+    }
+
+    auto document = QDomDocument();
+    const auto loaded = document.setContent(&f);
+    f.close();
+    const auto root = document.documentElement();
+    if (!loaded || (root.nodeName() != g_root_name) ||
+            (root.attribute("version") != g_version) ||
+            (root.attribute("device") != m_device_id)) {
+        return;
+    }
+
+    for (auto i=root.firstChildElement("register"); !i.isNull();
+         i=i.nextSiblingElement("register")) {
+        bool node_ok;
+        bool number_ok;
+        bool encoding_ok;
+        const auto node = i.attribute("node").toUInt(&node_ok);
+        const auto number = i.attribute("number").toUInt(&number_ok);
+        const auto encoding = i.attribute("encoding").toInt(&encoding_ok);
+        if (!node_ok || !number_ok || !encoding_ok || (node > 255U) || (number > 0xFFFFU) ||
+                (encoding < 0) || (encoding > int(RegisterEncoding::ENCODING_UNKNOWN))) {
+            continue;
+        }
+
+        auto entry = MetadataWrapper::get_instance()->create_record(quint16(number));
+        entry->label = i.attribute("label");
+        entry->encoding = RegisterEncoding(encoding);
+        entry->min = get_optional(i, "min");
+        entry->max = get_optional(i, "max");
+        entry->dflt = get_optional(i, "default");
+        m_entries[get_key(quint8(node), quint16(number))] = std::move(entry);
+    }
+}
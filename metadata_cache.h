@@ -0,0 +1,142 @@
+/**
+ * \file metadata_cache.h
+ * \brief Register metadata remembered per device between sessions
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * Reading the metadata of a window costs one custom request per register,
+ * yet labels, limits and encodings rarely change.  Once a device has been
+ * identified (Report Slave ID) its scheduler opens the cache for that
+ * identity; windows are filled from it at once and only registers missing
+ * from the cache are read from the device.  The cache of each device is kept
+ * in its own file under the application data directory and written back when
+ * the connection closes.
+ */
+
+#ifndef METADATA_CACHE_H
+#define METADATA_CACHE_H
+
+//  c++ includes
+#include <QString>  //  QString
+#include <memory>  //  std::shared_ptr
+#include <unordered_map>  //  std::unordered_map
+
+// C includes
+/* -none- */
+
+// project includes
+#include "metadata_structs.h"  //  Metadata
+
+
+/**
+ * \brief Metadata of one device, by node and register
+ */
+class MetadataCache
+{
+public:
+
+    /**
+     * \brief constructor
+     */
+    MetadataCache();
+
+    MetadataCache(const MetadataCache&) = delete;
+    MetadataCache &operator=(const MetadataCache&) = delete;
+
+    /**
+     * \brief Load the cache of a device (closing any previous device).
+     * \note
+     * A missing or unreadable cache file starts an empty cache.
+     *
+     * @param device_id device identification string (Report Slave ID)
+     */
+    void open(const QString &device_id);
+
+    /**
+     * \brief Write the cache back if changed and forget the device.
+     */
+    void close();
+
+    /**
+     * \brief Test if a device has been opened.
+     */
+    [[nodiscard]] bool is_open() const noexcept;
+
+    /**
+     * \brief Find the metadata of a register.
+     * @param node node / device ID
+     * @param reg register number
+     * @return cached metadata, ``nullptr`` if not cached
+     */
+    [[nodiscard]] std::shared_ptr<Metadata> find(const quint8 node, const quint16 reg) const;
+
+    /**
+     * \brief Remember the metadata read for a register.
+     * @param node node / device ID
+     * @param metadata decoded metadata
+     */
+    void store(const quint8 node, const Metadata &metadata);
+
+    /**
+     * \brief Write the cache file.
+     * @return ``false`` if the file could not be written
+     */
+    bool save();
+
+    /**
+     * \brief destructor
+     * \note
+     * Writes the cache back if changed.
+     */
+    ~MetadataCache();
+
+private:
+
+    /**
+     * \brief Get the lookup key of a register.
+     * @param node node / device ID
+     * @param reg register number
+     * @return key
+     */
+    [[nodiscard]] static quint32 get_key(const quint8 node, const quint16 reg) noexcept;
+
+    /**
+     * \brief Get the cache file of a device.
+     * @param device_id device identification string
+     * @return file path
+     */
+    [[nodiscard]] static QString get_path(const QString &device_id);
+
+    /**
+     * \brief Read the cache file.
+     */
+    void load();
+
+    QString m_device_id;
+    QString m_path;
+    std::unordered_map<quint32, std::shared_ptr<Metadata>> m_entries;
+    bool m_dirty;
+};
+
+#endif // METADATA_CACHE_H
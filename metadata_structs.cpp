@@ -32,10 +32,9 @@
 // project includes
 #include "metadata_structs.h"  //  local include
 #include "metadata_wrapper.h"  //  MetadataWrapper
-#include <metadata.h>  //  modbus_plugin: DATA_BUFFER_REQUIRED_SIZE
 
 
-Metadata::Metadata(const quint16 reg_num, void *const instance, const quint8 fc) :
+Metadata::Metadata(const quint16 reg_num, void *const instance, const quint8 fc, const quint16 count) :
     register_number{reg_num},
     label{},
     encoding{RegisterEncoding::ENCODING_UNKNOWN},
@@ -43,14 +42,30 @@ Metadata::Metadata(const quint16 reg_num, void *const instance, const quint8 fc)
     max(false),
     dflt(false),
     function_code{qint8(fc)},
-    m_request_instance{instance},
-    m_request(DATA_BUFFER_REQUIRED_SIZE)
+    register_count{count},
+    m_request_instance{instance}
+{
+}
+
+
+Metadata::Metadata(const quint16 reg_num) :
+    register_number{reg_num},
+    label{},
+    encoding{RegisterEncoding::ENCODING_UNKNOWN},
+    min{},
+    max{},
+    dflt{},
+    function_code{0},
+    register_count{0},
+    m_request_instance{nullptr}
 {
 }
 
 
 Metadata::~Metadata()
 {
-    auto inst = MetadataWrapper::get_instance();
-    inst->dispose_metadata(this);
+    if (nullptr != m_request_instance) {
+        auto inst = MetadataWrapper::get_instance();
+        inst->dispose_metadata(this);
+    }
 }
@@ -73,11 +73,20 @@ public:
      * \note
      * This function shall only be called by the Metadata wrapper
      *
-     * @param reg_num Register number
+     * @param reg_num Register number (first register of a range request)
      * @param instance plugin instance value
      * @param fc function code
+     * @param count registers covered by a range request, 0 for a single
+     *        register (API v1) request
+     */
+    Metadata(const quint16 reg_num, void *const instance, const quint8 fc, const quint16 count=0);
+
+    /**
+     * \brief Construct an empty container not bound to a plugin request
+     *        (eg: cached metadata).
+     * @param reg_num Register number
      */
-    Metadata(const quint16 reg_num, void *const instance, const quint8 fc);
+    explicit Metadata(const quint16 reg_num);
     Metadata(const Metadata&) = delete;
 
     const quint16 register_number; /**< Register numer */
@@ -87,12 +96,12 @@ public:
     std::optional<qint32> max; /**< Maximum allowed range */
     std::optional<qint32> dflt; /**< register default value */
     const qint8 function_code; /**< function code of the request */
+    const quint16 register_count; /**< Registers covered by a range request, 0 if not a range */
 
     ~Metadata();
 
 private:
     void *const m_request_instance;
-    std::vector<quint8> m_request;
 
 };
 
@@ -106,6 +115,7 @@ struct WindowMetadataRequest {
     quint8 node; /**< Node to poll */
     BaseDialog *requester; /**< Pointer to window requesting */
     std::shared_ptr<Metadata> request = nullptr; /**< Pointer to container */
+    bool cached = false; /**< Registers held in the metadata cache already delivered */
 };
 
 
@@ -26,6 +26,7 @@
 //  c++ includes
 #include <QStringBuilder>  //  operator %
 #include <QCoreApplication>  //  QCoreApplication
+#include <algorithm>  //  std::clamp, std::max
 
 
 // C includes
@@ -41,14 +42,85 @@ using namespace std::string_view_literals;
 
 namespace {
     const auto g_dll_name = "mod_plugin.so"sv;
-}
+    const auto g_pool_block_size = size_t(256U);  /**< Metadata and shared_ptr control block */
+
+
+    /**
+     * \brief Look up one entry point of the plugin.
+     * @param library loaded plugin
+     * @param name symbol name
+     * @param fn [out] updated with the entry point, ``nullptr`` if not found
+     * @param missing [out] name appended if not found
+     */
+    template<typename T>
+    void resolve(QLibrary *const library, const char *const name, T &fn, QStringList &missing)
+    {
+        fn = reinterpret_cast<T>(library->resolve(name));
+        if (nullptr == fn) {
+            missing << QString(name);
+        }
+    }
+
+}  //  Anonymous namespace
 
 
 MetadataWrapper::MetadataWrapper(const QString &lib_path) :
     QObject(nullptr),
-    m_dll_reference{new QLibrary(lib_path, this)}
+    m_dll_reference{new QLibrary(lib_path, this)},
+    m_functions{},
+    m_loaded{false},
+    m_error{},
+    m_pool(g_pool_block_size),
+    m_encode_buffer{},
+    m_label_buffer()
+{
+    if (!m_dll_reference->load()) {
+        m_error = m_dll_reference->errorString();
+        return;
+    }
+
+    const auto missing = resolve_functions();
+    if (missing.isEmpty()) {
+        m_loaded = true;
+        resolve_range_functions();
+    } else {
+        m_error = tr("Missing symbols: %1").arg(missing.join(QChar(',')));
+        m_functions = {};
+        m_dll_reference->unload();
+    }
+}
+
+
+QStringList MetadataWrapper::resolve_functions()
 {
-    m_dll_reference->load();
+    QStringList missing;
+    resolve(m_dll_reference, CREATE_SYMBOL, m_functions.create_request, missing);
+    resolve(m_dll_reference, ENCODE_SYMBOL, m_functions.encode_request, missing);
+    resolve(m_dll_reference, DECODE_SYMBOL, m_functions.decode_response, missing);
+    resolve(m_dll_reference, LABEL_SYMBOL, m_functions.decode_label, missing);
+    resolve(m_dll_reference, MINMAX_SYMBOL, m_functions.read_min_max, missing);
+    resolve(m_dll_reference, DEFAULT_SYMBOL, m_functions.read_default, missing);
+    resolve(m_dll_reference, ENCODING_SYMBOL, m_functions.get_encoding, missing);
+    resolve(m_dll_reference, RELEASE_SYMBOL, m_functions.release_request, missing);
+    return missing;
+}
+
+
+void MetadataWrapper::resolve_range_functions()
+{
+    const auto version = reinterpret_cast<api_version>(m_dll_reference->resolve(API_VERSION_SYMBOL));
+    if ((nullptr == version) || (version() < 2U)) {
+        return;
+    }
+
+    QStringList missing;
+    resolve(m_dll_reference, CREATE_RANGE_SYMBOL, m_functions.create_range_request, missing);
+    resolve(m_dll_reference, SELECT_SYMBOL, m_functions.select_record, missing);
+    if (!missing.isEmpty()) {
+        //  Incomplete v2 interface, use v1.
+        m_functions.create_range_request = nullptr;
+        m_functions.select_record = nullptr;
+    }
 }
 
 
@@ -68,7 +140,13 @@ MetadataWrapper* MetadataWrapper::get_instance()
 
 bool MetadataWrapper::loaded() const
 {
-    return m_dll_reference->isLoaded();
+    return m_loaded;
+}
+
+
+const QString &MetadataWrapper::get_error() const noexcept
+{
+    return m_error;
 }
 
 
@@ -79,96 +157,146 @@ std::shared_ptr<Metadata> MetadataWrapper::create_request(const quint16 reg_numb
     }
 
     quint8 fc;
-//    auto p_fn = reinterpret_cast<create>(dlsym(m_dll_reference, CREATE_SYMBOL));
-    auto p_fn = reinterpret_cast<create>(m_dll_reference->resolve(CREATE_SYMBOL));
-    auto inst = p_fn(reg_number, &fc);
+    auto inst = m_functions.create_request(reg_number, &fc);
     if (nullptr == inst) {
         throw AppException(tr("Illegal request: ") % QString::number(reg_number));
     }
 
-    return std::make_shared<Metadata>(reg_number, inst, fc);
+    return std::allocate_shared<Metadata>(PoolAllocator<Metadata>(&m_pool), reg_number, inst, fc);
+}
+
+
+std::shared_ptr<Metadata> MetadataWrapper::create_record(const quint16 reg_number)
+{
+    return std::allocate_shared<Metadata>(PoolAllocator<Metadata>(&m_pool), reg_number);
+}
+
+
+bool MetadataWrapper::has_range_requests() const noexcept
+{
+    return m_loaded && (nullptr != m_functions.create_range_request);
+}
+
+
+std::shared_ptr<Metadata> MetadataWrapper::create_range_request(const quint16 first_register,
+                                                                const quint16 count)
+{
+    if (!has_range_requests()) {
+        throw AppException(tr("Plugin unavailable"));
+    }
+
+    quint8 fc;
+    auto covered = std::max(count, quint16(1U));
+    auto inst = m_functions.create_range_request(first_register, &covered, &fc);
+    if (nullptr == inst) {
+        throw AppException(tr("Illegal request: ") % QString::number(first_register));
+    }
+
+    covered = std::clamp(covered, quint16(1U), std::max(count, quint16(1U)));
+    return std::allocate_shared<Metadata>(PoolAllocator<Metadata>(&m_pool),
+                                          first_register, inst, fc, covered);
 }
 
 
 QPair<const quint8*, quint8> MetadataWrapper::encode_request(std::shared_ptr<Metadata> request)
 {
-//    auto p_fn = reinterpret_cast<encode>(dlsym(m_dll_reference, ENCODE_SYMBOL));
-    auto p_fn = reinterpret_cast<encode>(m_dll_reference->resolve(ENCODE_SYMBOL));
+    auto length = m_functions.encode_request(request->m_request_instance, m_encode_buffer.data());
+    return {m_encode_buffer.data(), quint8(length)};
+}
+
 
-    auto length = p_fn(request->m_request_instance, request->m_request.data());
-    return {request->m_request.data(), quint8(length)};
+bool MetadataWrapper::decode_response(std::shared_ptr<Metadata> request,
+                                      const quint8 *const data,
+                                      const size_t length)
+{
+    if (m_functions.decode_response(request->m_request_instance, data, uint8_t(length)) != 0) {
+        return false;
+    }
+
+    decode_fields(request->m_request_instance, request.get());
+    return true;
 }
 
 
-void MetadataWrapper::decode_response(std::shared_ptr<Metadata> request, const std::vector<quint8> &data)
+std::vector<std::shared_ptr<Metadata>>
+    MetadataWrapper::decode_range_response(std::shared_ptr<Metadata> request,
+                                           const quint8 *const data,
+                                           const size_t length)
 {
-//    auto p_fn = reinterpret_cast<decode>(dlsym(m_dll_reference, DECODE_SYMBOL));
-    auto p_fn = reinterpret_cast<decode>(m_dll_reference->resolve(DECODE_SYMBOL));
+    std::vector<std::shared_ptr<Metadata>> records;
+    const auto instance = request->m_request_instance;
+    if (m_functions.decode_response(instance, data, uint8_t(length)) != 0) {
+        return records;
+    }
 
-    if (p_fn(request->m_request_instance, data.data(), uint8_t(data.size())) == 0) {
-        decode_labels(request.get());
-        decode_defaults(request.get());
-        decode_encoding(request.get());
-        decode_limits(request.get());
+    records.reserve(request->register_count);
+    for (quint32 i=0U; i<request->register_count; ++i) {
+        const auto reg = quint16(request->register_number + i);
+        if (m_functions.select_record(instance, reg) == 0) {
+            auto record = create_record(reg);
+            decode_fields(instance, record.get());
+            records.push_back(std::move(record));
+        } else {
+            records.push_back(nullptr);
+        }
     }
+
+    return records;
 }
 
 
 void MetadataWrapper::dispose_metadata(const Metadata *const m)
 {
-//    auto p_fn = reinterpret_cast<release>(dlsym(m_dll_reference, RELEASE_SYMBOL));
-    auto p_fn = reinterpret_cast<release>(m_dll_reference->resolve(RELEASE_SYMBOL));
-    p_fn(m->m_request_instance);
+    m_functions.release_request(m->m_request_instance);
 }
 
 
-void MetadataWrapper::decode_labels(Metadata *const request)
+void MetadataWrapper::decode_fields(void *const instance, Metadata *const target)
 {
-//    auto p_fn = reinterpret_cast<label>(dlsym(m_dll_reference, LABEL_SYMBOL));
-    auto p_fn = reinterpret_cast<label>(m_dll_reference->resolve(LABEL_SYMBOL));
+    decode_labels(instance, target);
+    decode_defaults(instance, target);
+    decode_encoding(instance, target);
+    decode_limits(instance, target);
+}
+
 
-    const auto lbl_len = p_fn(request->m_request_instance, nullptr);
+void MetadataWrapper::decode_labels(void *const instance, Metadata *const target)
+{
+    const auto lbl_len = m_functions.decode_label(instance, nullptr);
     if (lbl_len > 0) {
-        auto raw_string = std::vector<char>(size_t(lbl_len));
-        p_fn(request->m_request_instance, raw_string.data());
-        request->label = QString(raw_string.data());
+        if (m_label_buffer.size() < size_t(lbl_len)) {
+            m_label_buffer.resize(size_t(lbl_len));
+        }
+        m_functions.decode_label(instance, m_label_buffer.data());
+        target->label = QString(m_label_buffer.data());
     }
 }
 
 
-void MetadataWrapper::decode_defaults(Metadata *const request)
+void MetadataWrapper::decode_defaults(void *const instance, Metadata *const target)
 {
-//    auto p_fn = reinterpret_cast<get_default>(dlsym(m_dll_reference, DEFAULT_SYMBOL));
-    auto p_fn = reinterpret_cast<get_default>(m_dll_reference->resolve(DEFAULT_SYMBOL));
-
     qint32 dflt;
-    if (p_fn(request->m_request_instance, &dflt) == 0) {
-        request->dflt = dflt;
+    if (m_functions.read_default(instance, &dflt) == 0) {
+        target->dflt = dflt;
     }
 }
 
 
-void MetadataWrapper::decode_encoding(Metadata *const request)
+void MetadataWrapper::decode_encoding(void *const instance, Metadata *const target)
 {
-//    auto p_fn = reinterpret_cast<encoding>(dlsym(m_dll_reference, ENCODING_SYMBOL));
-    auto p_fn = reinterpret_cast<encoding>(m_dll_reference->resolve(ENCODING_SYMBOL));
-
-    const auto reported = p_fn(request->m_request_instance);
+    const auto reported = m_functions.get_encoding(instance);
     if (reported >= 0) {
-        request->encoding = RegisterEncoding(reported);
+        target->encoding = RegisterEncoding(reported);
     }
 }
 
 
-void MetadataWrapper::decode_limits(Metadata *const request)
+void MetadataWrapper::decode_limits(void *const instance, Metadata *const target)
 {
-//    auto p_fn = reinterpret_cast<minmax>(dlsym(m_dll_reference, MINMAX_SYMBOL));
-    auto p_fn = reinterpret_cast<minmax>(m_dll_reference->resolve(MINMAX_SYMBOL));
-
     qint32 min, max;
-    if (p_fn(request->m_request_instance, &min, &max) == 0) {
-        request->min = min;
-        request->max = max;
+    if (m_functions.read_min_max(instance, &min, &max) == 0) {
+        target->min = min;
+        target->max = max;
     }
 }
 
@@ -39,16 +39,19 @@
 #include <QtCore>  // QObject
 #include <QPair>  //  QPair
 #include <QLibrary>  //  QLibrary
+#include <QStringList>  //  QStringList
+#include <array>  //  std::array
 #include <string_view>  //  std::string_view
 #include <vector>  //  std::vector
 #include <memory>  //  std::shared_ptr
 #include <string>  //  std::string
 
 // C includes
-/* -none- */
+#include <metadata.h>  //  modbus_plugin: entry point types
 
 // project includes
 #include "metadata_structs.h"  //  Metadata
+#include "block_pool.h"  //  BlockPool
 
 
 /**
@@ -67,6 +70,12 @@ public:
      */
     [[nodiscard]] bool loaded() const;
 
+    /**
+     * \brief Get the reason the library could not be used.
+     * @return error text (missing library or symbols), empty if loaded
+     */
+    [[nodiscard]] const QString &get_error() const noexcept;
+
     /**
      * \brief Generate request container
      * @param reg_number Request metadata for this register number
@@ -74,8 +83,38 @@ public:
      */
     [[nodiscard]] std::shared_ptr<Metadata> create_request(const quint16 reg_number);
 
+    /**
+     * \brief Test if the plugin can read a range of registers per request (API v2).
+     */
+    [[nodiscard]] bool has_range_requests() const noexcept;
+
+    /**
+     * \brief Generate a request container covering a range of registers.
+     * \note
+     * The plugin may cover fewer registers than asked for, \sa Metadata::register_count
+     *
+     * @param first_register first register to request metadata for
+     * @param count number of registers wanted
+     * @throws AppException if range requests are unavailable or refused
+     * @return Metadata container
+     */
+    [[nodiscard]] std::shared_ptr<Metadata> create_range_request(const quint16 first_register,
+                                                                 const quint16 count);
+
+    /**
+     * \brief Generate an empty container not bound to a plugin request
+     *        (eg: a record of a range response, cached metadata).
+     * @param reg_number Register number
+     * @return Metadata container
+     */
+    [[nodiscard]] std::shared_ptr<Metadata> create_record(const quint16 reg_number);
+
     /**
      * \brief Generate an outgoing request PDU
+     * \note
+     * The PDU is encoded into a buffer shared by every request, it is only
+     * valid until the next call.
+     *
      * @param request Request container
      * @return raw PDU (length and data pointer)
      */
@@ -85,8 +124,24 @@ public:
      * \brief Decode a response PDU
      * @param request Request container (updated)
      * @param data response PDU
+     * @param length response length (bytes)
+     * @return ``true`` if the plugin decoded the response
+     */
+    bool decode_response(std::shared_ptr<Metadata> request, const quint8 *const data, const size_t length);
+
+    /**
+     * \brief Decode the response PDU of a range request.
+     * @param request Range request container
+     * @param data response PDU
+     * @param length response length (bytes)
+     * @return one container per register covered, in register order
+     *         (``nullptr`` for registers missing from the response), none if
+     *         the response could not be decoded
      */
-    void decode_response(std::shared_ptr<Metadata> request, const std::vector<quint8> &data);
+    [[nodiscard]] std::vector<std::shared_ptr<Metadata>>
+        decode_range_response(std::shared_ptr<Metadata> request,
+                              const quint8 *const data,
+                              const size_t length);
 
     /**
      * \brief This class is a singleton, get the instance.
@@ -116,17 +171,56 @@ private:
     MetadataWrapper(const QString &lib_path);
 
     /**
-     * \fn decode_labels, decode_defaults, decode_encoding, decode_limits
+     * \fn decode_fields, decode_labels, decode_defaults, decode_encoding, decode_limits
      * \brief Internal decoder functions
-     * @param request pointer to request instance
+     * @param instance plugin request instance with a decoded response
+     * @param target container updated
+     */
+    void decode_fields(void *const instance, Metadata *const target);
+    void decode_labels(void *const instance, Metadata *const target);
+    void decode_defaults(void *const instance, Metadata *const target);
+    void decode_encoding(void *const instance, Metadata *const target);
+    void decode_limits(void *const instance, Metadata *const target);
+
+    /**
+     * \brief Plugin entry points, resolved once when the library is loaded
+     */
+    struct PluginFunctions {
+        create create_request;
+        encode encode_request;
+        decode decode_response;
+        label decode_label;
+        minmax read_min_max;
+        get_default read_default;
+        encoding get_encoding;
+        release release_request;
+        create_range create_range_request; /**< API v2, ``nullptr`` if unavailable */
+        record select_record; /**< API v2, ``nullptr`` if unavailable */
+    };
+
+    /**
+     * \brief Resolve every entry point of the plugin.
+     * @return names of the symbols not found
+     */
+    [[nodiscard]] QStringList resolve_functions();
+
+    /**
+     * \brief Resolve the optional API v2 entry points.
+     * \note
+     * Either both are resolved or neither.
      */
-    void decode_labels(Metadata *const request);
-    void decode_defaults(Metadata *const request);
-    void decode_encoding(Metadata *const request);
-    void decode_limits(Metadata *const request);
+    void resolve_range_functions();
 
     QLibrary *const m_dll_reference;
-//    void *m_dll_reference = nullptr;
+    PluginFunctions m_functions;
+    bool m_loaded;
+    QString m_error;
+
+    //  Containers are created and released for every metadata poll, recycle
+    // their storage.  Only used from the main thread.
+    BlockPool m_pool;
+    std::array<quint8, DATA_BUFFER_REQUIRED_SIZE> m_encode_buffer;
+    std::vector<char> m_label_buffer;
 };
 
 #endif // METADATA_WRAPPER_H
@@ -0,0 +1,160 @@
+/**
+ * \file modbus_connection.h
+ * \brief Common interface to a Modbus/TCP connection
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * The scheduler and windows only talk to a connection through this interface
+ * so that the transport may be either the libmodbus based ModbusThread (one
+ * thread per device) or a connection driven by the shared EpollEngine.  All
+ * requests are asynchronous: the call returns a transaction ID and the outcome
+ * is collected with ``take_result`` once ``transactions_ready`` is signalled.
+ * Requests are to be issued from the main (window) thread only.
+ */
+
+#ifndef MODBUS_CONNECTION_H
+#define MODBUS_CONNECTION_H
+
+//  c++ includes
+#include <chrono>  //  std::chrono::milliseconds
+#include <vector>  //  std::vector
+#include <QObject>  //  QObject
+
+// C includes
+/* -none- */
+
+// project includes
+#include "mbap_codec.h"  //  ModbusResult
+
+
+/**
+ * \brief Abstract Modbus connection
+ */
+class ModbusConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * \brief constructor
+     * @param parent parent QObject owner
+     */
+    explicit ModbusConnection(QObject *parent) : QObject(parent) {}
+
+    ~ModbusConnection() override = default;
+
+    /**
+     * \brief Begin connecting to the remote device.
+     * \note
+     * ``complete`` is emitted once the connection is made, ``modbus_error``
+     * if it fails.
+     */
+    virtual void start() = 0;
+
+    /**
+     * \brief Close the connection.
+     * \note
+     * The object deletes itself once closed, the pointer must not be used
+     * after this call.
+     */
+    virtual void close() = 0;
+
+    /**
+     * \brief Issue a modbus read request
+     * @param first_reg first register number (0 = device id)
+     * @param num_regs number of registers to read
+     * @param uid Unit ID / Node to poll
+     * @return transaction ID
+     */
+    virtual quint16 modbus_request(const quint16 first_reg, const quint16 num_regs, const quint8 uid) = 0;
+
+    /**
+     * \brief Issue a modbus write request
+     * @param first_reg first register number
+     * @param regs_to_write list of values to be written
+     * @param uid Unit ID / Node to poll
+     * @return transaction ID
+     */
+    virtual quint16 modbus_request(const quint16 first_reg,
+                                   std::vector<quint16> &&regs_to_write,
+                                   const quint8 uid) = 0;
+
+    /**
+     * \brief Issue a raw modbus PDU
+     * @param pdu Modbus raw PDU to send
+     * @param length length of PDU
+     * @param fc function code
+     * @param uid Unit ID / Node to poll
+     * @return transaction ID
+     */
+    virtual quint16 modbus_request(const quint8 *pdu,
+                                   const quint8 length,
+                                   const qint8 fc,
+                                   const quint8 uid) = 0;
+
+    /**
+     * \brief Obtain the next completed transaction.
+     * \note
+     * Results are reported in the order that responses arrive which is not
+     * necessarily the order of the requests.
+     *
+     * @param result [out] updated with the completed transaction
+     * @return ``true`` if a result was available, ``false`` otherwise
+     */
+    [[nodiscard]] virtual bool take_result(ModbusResult &result) = 0;
+
+    /**
+     * \brief Get the maximum number of outstanding transactions.
+     * @return pipeline depth (1 = not pipelined)
+     */
+    [[nodiscard]] virtual int pipeline_depth() const noexcept = 0;
+
+    /**
+     * \brief Set the time to wait for a response.
+     * @param timeout response timeout
+     */
+    virtual void set_response_timeout(const std::chrono::milliseconds timeout) = 0;
+
+signals:
+
+    /**
+     * \brief Emit connection-level exception (connect failed / lost).
+     * @param error_code Modbus error code reported
+     */
+    void modbus_error(const int error_code);
+
+    /**
+     * \brief Emit that the connection has been established.
+     */
+    void complete();
+
+    /**
+     * \brief Emit that one or more results are available.
+     * \sa take_result
+     */
+    void transactions_ready();
+};
+
+
+#endif // MODBUS_CONNECTION_H
@@ -24,243 +24,291 @@
  */
 
 //  c++ includes
-/* -none- */
+#include <array>  //  std::array
+#include <map>  //  std::map
+#include <algorithm>  //  std::min_element, std::min, std::max
+#include <cerrno>  //  errno
 
 // C includes
-#include <sys/socket.h>  //  recv
+#include <sys/socket.h>  //  recv, send
+#include <sys/eventfd.h>  //  eventfd
+#include <poll.h>  //  poll
+#include <unistd.h>  //  ::close
 
 // project includes
 #include "modbusthread.h"  //  local include
+#include "exceptions.h"  //  AppException
+#include "packed_bits.h"  //  packed_bits::pack_flags
 
 
-ModbusThread::ModbusThread(QObject *parent, const QString &host, const quint16 port)
-        :QThread(parent),
+using std::chrono::steady_clock;
+
+
+namespace {
+
+    /**
+     * \brief Write an entire ADU to a (blocking) socket.
+     * @param sock socket
+     * @param data ADU to write
+     * @return ``true`` on success, ``false`` if the connection failed
+     */
+    bool send_all(const int sock, const std::vector<quint8> &data)
+    {
+        size_t sent = 0U;
+        while (sent < data.size()) {
+            const auto result = send(sock, &data[sent], data.size() - sent, MSG_NOSIGNAL);
+            if (result < 0) {
+                if (EINTR == errno) {
+                    continue;
+                }
+                return false;
+            }
+            sent += size_t(result);
+        }
+
+        return true;
+    }
+
+}  //  Anonymous namespace
+
+
+ModbusThread::ModbusThread(QObject *parent, const QString &host, const quint16 port, const int pipeline_depth)
+        :ModbusConnection(parent),
           m_host(host),
           m_port(port),
-          m_mx(),
-          m_cond(),
-          m_regs()
+          m_thread{QThread::create([this]() { run(); })},
+          m_pipeline_depth{(pipeline_depth > 1 ? pipeline_depth : 1)},
+          m_timeout{std::chrono::milliseconds(3000)},
+          m_requests(size_t(m_pipeline_depth)),
+          m_results(size_t(m_pipeline_depth))
 {
-    connect(this, &ModbusThread::finished, this, &ModbusThread::deleteLater);
+    m_wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wake_fd < 0) {
+        m_wake_error = errno;
+    }
+    m_thread->setParent(this);
+    connect(m_thread, &QThread::finished, this, &ModbusThread::deleteLater);
 }
 
 
 ModbusThread::~ModbusThread()
 {
+    m_thread->wait();
     if (nullptr != m_ctx) {
         modbus_free(m_ctx);
         m_ctx=nullptr;
     }
+
+    if (m_wake_fd >= 0) {
+        ::close(m_wake_fd);
+        m_wake_fd = -1;
+    }
+}
+
+
+void ModbusThread::start()
+{
+    m_thread->start();
 }
 
 
 void ModbusThread::run()
 {
-    bool exit_signal;
+    if (m_wake_fd < 0) {
+        m_quit = true;
+        emit modbus_error(m_wake_error);
+        return;
+    }
+
     m_ctx = modbus_new_tcp(m_host.toLocal8Bit().data(), int(m_port));
     if (nullptr == m_ctx) {
-        m_mx.lock();
         m_quit = true;
-        m_mx.unlock();
         emit modbus_error(errno);
         return;
     }
 
     if (modbus_connect(m_ctx) != 0) {
-        m_mx.lock();
         m_quit = true;
-        m_mx.unlock();
         emit modbus_error(errno);
         return;
     }
 
     emit complete();
 
-    std::vector<uint8_t> bits;
-    do {
-        m_mx.lock();
-        if (!m_quit) {
-            m_cond.wait(&m_mx);
-        }
-        exit_signal = m_quit;
-        int result;
-        auto bit_process=false;
-        m_regs.resize(size_t(m_count));
-
-        //  This does not generate network traffic.
-        if (nullptr == m_raw_request) {
-            result=modbus_set_slave(m_ctx, int(m_node));
-        } else {
-            result=0;
-        }
+    if (m_pipeline_depth > 1) {
+        run_pipelined();
+    } else {
+        run_blocking();
+    }
+    modbus_close(m_ctx);
+}
 
-        if (exit_signal) {
-            result=0;
-        } else if (0 != result) {
-            //  Don't do anything
-        } else if (nullptr != m_raw_request) {
-            result = do_custom_request_tcp();
-        } else if (0 == m_count) {
-            bits.resize(256);
-            result = modbus_report_slave_id(m_ctx, 256, &bits[0]);
-            bit_process=true;
-            if (result > 0) {
-                m_count=quint16(result);
-                m_regs.resize(m_count);
-            }
-        } else if (m_write_request) {
-            result = do_write_request();
-        } else if (m_reg_number >= 1 && m_reg_number <= 9999) {
-            bits.resize(size_t(m_count));
-            result = modbus_read_bits(m_ctx, int(m_reg_number - 1), int(m_count), bits.data());
-            bit_process=true;
-        } else if (m_reg_number >= 10001 && m_reg_number <= 19999) {
-            bits.resize(size_t(m_count));
-            result = modbus_read_input_bits(m_ctx, int(m_reg_number - 10001), int(m_count), bits.data());
-            bit_process=true;
-        } else if (m_reg_number >= 30001 && m_reg_number <= 39999) {
-            result = modbus_read_input_registers(m_ctx, int(m_reg_number - 30001), int(m_count), m_regs.data());
-        } else if (m_reg_number >= 40001 && m_reg_number <= 49999) {
-            result = modbus_read_registers(m_ctx, int(m_reg_number - 40001), int(m_count), m_regs.data());
-        } else {
-            emit modbus_error(2);  //  Illegal address
-        }
 
-        if (result < 0) {
-            emit modbus_error(errno);
+void ModbusThread::run_blocking()
+{
+    std::vector<ModbusResult> results;
+    ModbusTransaction request;
+    while (!m_quit.load()) {
+        if (m_requests.try_pop(request)) {
+            results.push_back(execute(request));
         } else {
-            if (bit_process) {
-                for (auto i=0U; i<m_count; ++i) {
-                    m_regs[i]=quint16(bits[i]);
-                }
-            }
-            if (!exit_signal) {
-                emit complete();
-            }
+            //  Retry results that didn't fit, otherwise sleep until requested.
+            wait_for_wake(results.empty() ? -1 : 1);
         }
-
-        m_mx.unlock();
-    } while (!exit_signal);
-    modbus_close(m_ctx);
+        post_results(results);
+    }
 }
 
 
-void ModbusThread::modbus_request(const quint16 first_reg, const quint16 num_regs, const quint8 uid)
+ModbusResult ModbusThread::execute(const ModbusTransaction &request)
 {
-    m_mx.lock();
-    m_reg_number = first_reg;
-    m_count = num_regs;
-    m_node = uid;
-    m_write_request=false;
-    m_raw_request=nullptr;
-    m_cond.notify_one();
-    m_mx.unlock();
+    auto response = mbap::error_result(request, 0);
+    const auto timeout_us = std::chrono::duration_cast<std::chrono::microseconds>(m_timeout.load()).count();
+    static_cast<void>(modbus_set_response_timeout(m_ctx,
+                                                  uint32_t(timeout_us / 1000000),
+                                                  uint32_t(timeout_us % 1000000)));
+
+    //  This does not generate network traffic.
+    int result;
+    if (0 == request.function_code) {
+        result = modbus_set_slave(m_ctx, int(request.node));
+    } else {
+        result = 0;
+    }
+
+    const auto reg_number = request.first_register;
+    auto count = request.count;
+    std::vector<quint16> regs;
+    std::vector<uint8_t> bits;
+    auto bit_process=false;
+    auto byte_process=false;
+    if (0 != result) {
+        //  Don't do anything
+    } else if (0 != request.function_code) {
+        result = do_custom_request_tcp(request, bits);
+        byte_process=true;
+    } else if (request.write) {
+        result = do_write_request(request);
+    } else if (0 == count) {
+        bits.resize(256);
+        result = modbus_report_slave_id(m_ctx, 256, &bits[0]);
+        byte_process=true;
+        if (result > 0) {
+            bits.resize(std::min(size_t(result), bits.size()));
+        }
+    } else if (reg_number >= 1 && reg_number <= 9999) {
+        bits.resize(size_t(count));
+        result = modbus_read_bits(m_ctx, int(reg_number - 1), int(count), bits.data());
+        bit_process=true;
+    } else if (reg_number >= 10001 && reg_number <= 19999) {
+        bits.resize(size_t(count));
+        result = modbus_read_input_bits(m_ctx, int(reg_number - 10001), int(count), bits.data());
+        bit_process=true;
+    } else if (reg_number >= 30001 && reg_number <= 39999) {
+        regs.resize(size_t(count));
+        result = modbus_read_input_registers(m_ctx, int(reg_number - 30001), int(count), regs.data());
+    } else if (reg_number >= 40001 && reg_number <= 49999) {
+        regs.resize(size_t(count));
+        result = modbus_read_registers(m_ctx, int(reg_number - 40001), int(count), regs.data());
+    } else {
+        result = -1;
+        errno = MODBUS_ENOBASE + MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS;
+    }
+
+    if (result < 0) {
+        response.error_code = errno;
+    } else if (request.write) {
+        //  Nothing to report for a write.
+    } else if (byte_process) {
+        //  Device ID and custom payloads are handed on as bytes.
+        response.bytes = std::move(bits);
+    } else if (bit_process) {
+        packed_bits::pack_flags(bits.data(), count, response.bits);
+        response.bit_count = count;
+    } else {
+        response.regs = std::move(regs);
+    }
+
+    return response;
 }
 
 
-std::vector<quint16> ModbusThread::modbus_result()
+quint16 ModbusThread::modbus_request(const quint16 first_reg, const quint16 num_regs, const quint8 uid)
 {
-    m_mx.lock();
-    std::vector<quint16> result = std::move(m_regs);
-    m_regs=std::vector<quint16>();
-    m_mx.unlock();
-
-    return result;
+    ModbusTransaction transaction;
+    transaction.first_register = first_reg;
+    transaction.count = num_regs;
+    transaction.node = uid;
+    return enqueue(std::move(transaction));
 }
 
 
 void ModbusThread::close()
 {
-    m_mx.lock();
-    m_quit=true;
-    m_cond.notify_one();
-    m_mx.unlock();
-    wait();
+    m_quit = true;
+    wake();
+    m_thread->wait();
 }
 
 
-void ModbusThread::modbus_request(const quint16 first_reg, std::vector<quint16> &&regs_to_write, const quint8 uid)
+quint16 ModbusThread::modbus_request(const quint16 first_reg, std::vector<quint16> &&regs_to_write, const quint8 uid)
 {
-    auto reg_count = regs_to_write.size();
-    m_mx.lock();
-    m_regs = std::move(regs_to_write);
-    m_reg_number = first_reg;
-    m_count = quint16(reg_count);
-    m_node = uid;
-    m_write_request=true;
-    m_raw_request=nullptr;
-    m_cond.notify_one();
-    m_mx.unlock();
+    ModbusTransaction transaction;
+    transaction.first_register = first_reg;
+    transaction.node = uid;
+    transaction.write = true;
+    transaction.values = std::move(regs_to_write);
+    return enqueue(std::move(transaction));
 }
 
 
-void ModbusThread::modbus_request(const quint8 *pdu, const quint8 length, const qint8 fc, const quint8 uid)
+quint16 ModbusThread::modbus_request(const quint8 *pdu, const quint8 length, const qint8 fc, const quint8 uid)
 {
-    m_mx.lock();
-    m_regs = {};
-    m_node = uid;
-    m_count = quint16(length);
-    m_raw_request = pdu;
-    m_write_request=false;
-    m_reg_number = quint16(fc);
-    m_cond.notify_one();
-    m_mx.unlock();
+    ModbusTransaction transaction;
+    transaction.node = uid;
+    transaction.function_code = fc;
+    transaction.raw_pdu.assign(pdu, pdu + length);
+    return enqueue(std::move(transaction));
 }
 
 
-int ModbusThread::do_write_request()
+int ModbusThread::do_write_request(const ModbusTransaction &request)
 {
     int result;
-    auto write_count=m_regs.size();
-    if (1 == write_count && m_reg_number <= 19999) {
-        result = modbus_write_bit(m_ctx, int(m_reg_number - 1), (m_regs[0] > 0 ? TRUE : FALSE));
-    } else if (m_reg_number <= 19999) {
+    const auto &values = request.values;
+    const auto reg_number = request.first_register;
+    auto write_count=values.size();
+    if (1 == write_count && reg_number <= 19999) {
+        result = modbus_write_bit(m_ctx, int(reg_number - 1), (values[0] > 0 ? TRUE : FALSE));
+    } else if (reg_number <= 19999) {
         std::vector<quint8>write_bits(write_count);
         for (decltype(write_count) i=0; i<write_count; i++) {
-            write_bits[i] = (m_regs[i] > 0 ? TRUE : FALSE);
+            write_bits[i] = (values[i] > 0 ? TRUE : FALSE);
         }
-        result = modbus_write_bits(m_ctx, int(m_reg_number - 1), int(write_count), &write_bits[0]);
+        result = modbus_write_bits(m_ctx, int(reg_number - 1), int(write_count), &write_bits[0]);
     } else if (1 == write_count) {
-        result = modbus_write_register(m_ctx, int(m_reg_number - 40001), m_regs[0]);
+        result = modbus_write_register(m_ctx, int(reg_number - 40001), values[0]);
     } else {
-        result = modbus_write_registers(m_ctx, int(m_reg_number - 40001), int(write_count), &m_regs[0]);
+        result = modbus_write_registers(m_ctx, int(reg_number - 40001), int(write_count), &values[0]);
     }
 
     return result;
 }
 
 
-quint16 ModbusThread::get_start_reg()
-{
-    m_mx.lock();
-    auto retval = m_reg_number;
-    m_mx.unlock();
-    return retval;
-}
-
-
-quint8 ModbusThread::get_unit_id()
-{
-    m_mx.lock();
-    auto retval = m_node;
-    m_mx.unlock();
-    return retval;
-}
-
-
-int ModbusThread::do_custom_request_tcp()
+int ModbusThread::do_custom_request_tcp(const ModbusTransaction &request, std::vector<quint8> &bytes)
 {
     //  Actually looking through the code in libmodbus, their handling of
     // custom functions is hopelessly broken.  Rather than alter the library I
     // thought it best to just put this kludge in.
-    std::vector<uint8_t> req(m_count + 2);
-    auto fc = uint8_t(m_reg_number);  //  Function code stored in reg_number
-    m_reg_number = 0xFFFFU;  //  Always set the "custom function" state.
+    const auto &pdu = request.raw_pdu;
+    std::vector<uint8_t> req(pdu.size() + 2);
+    auto fc = uint8_t(request.function_code);
 
-    req[0] = uint8_t(m_node);
+    req[0] = uint8_t(request.node);
     req[1] = fc;
-    for (auto i=0; i<m_count; ++i) {
-        req[size_t(i+2)] = uint8_t(m_raw_request[i]);
+    for (size_t i=0U; i<pdu.size(); ++i) {
+        req[i+2] = uint8_t(pdu[i]);
     }
     auto result = modbus_send_raw_request(m_ctx, req.data(), int(req.size()));
     if (result < 0) {
@@ -288,11 +336,182 @@ int ModbusThread::do_custom_request_tcp()
         recv(sock, &rsp_data[result], size_t(length - result), MSG_WAITALL);
     }
     index++;
-    m_count=0;
-    m_regs.resize(size_t(length - index));
-    for (; index<length; ++index) {
-        m_regs[m_count++] = quint16(rsp_data[size_t(index)]);
+    bytes.assign(rsp_data + index, rsp_data + std::max(index, length));
+    return int(bytes.size());
+}
+
+
+void ModbusThread::run_pipelined()
+{
+    const auto sock = modbus_get_socket(m_ctx);
+    std::map<quint16, OutstandingTransaction> outstanding;
+    std::vector<ModbusTransaction> to_send;
+    std::vector<ModbusResult> results;
+    std::vector<quint8> rx_buffer;
+    std::array<quint8, MODBUS_TCP_MAX_ADU_LENGTH> rx_chunk;
+    auto connected = true;
+    auto exit_signal = false;
+
+    ModbusTransaction transaction;
+    while (!exit_signal) {
+        exit_signal = m_quit.load();
+        while (((outstanding.size() + to_send.size()) < size_t(m_pipeline_depth)) &&
+               m_requests.try_pop(transaction)) {
+            to_send.push_back(std::move(transaction));
+        }
+        const auto timeout = m_timeout.load();
+
+        if (exit_signal) {
+            break;
+        }
+
+        const auto now = steady_clock::now();
+        for (auto &i: to_send) {
+            const auto adu = mbap::encode_request(i);
+            if (adu.empty()) {
+                results.push_back(mbap::error_result(
+                        i, MODBUS_ENOBASE + MODBUS_EXCEPTION_ILLEGAL_DATA_ADDRESS));
+            } else if (!connected || !send_all(sock, adu)) {
+                connected = false;
+                results.push_back(mbap::error_result(i, ECONNRESET));
+            } else {
+                const auto transaction_id = i.transaction_id;
+                outstanding[transaction_id] = OutstandingTransaction{std::move(i), now + timeout};
+            }
+        }
+        to_send.clear();
+        post_results(results);
+
+        //  Sleep until a response arrives, more requests are queued or the
+        // oldest outstanding request times out (retry results that didn't fit).
+        auto wait_ms = (results.empty() ? -1 : 1);
+        if (!outstanding.empty()) {
+            const auto oldest = std::min_element(
+                        outstanding.begin(), outstanding.end(), [](const auto &a, const auto &b) {
+                return a.second.deadline < b.second.deadline;
+            });
+            const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        oldest->second.deadline - now);
+            const auto deadline_ms = std::max(0, int(remaining.count()) + 1);
+            wait_ms = (wait_ms < 0 ? deadline_ms : std::min(wait_ms, deadline_ms));
+        }
+
+        std::array<pollfd, 2> fds{{{m_wake_fd, POLLIN, 0}, {sock, POLLIN, 0}}};
+        if (poll(fds.data(), (connected ? 2U : 1U), wait_ms) < 0) {
+            fds[0].revents = 0;
+            fds[1].revents = 0;
+        }
+
+        if (0 != (fds[0].revents & POLLIN)) {
+            eventfd_t unused;
+            static_cast<void>(eventfd_read(m_wake_fd, &unused));
+        }
+
+        if (connected && (0 != fds[1].revents)) {
+            const auto rx = recv(sock, rx_chunk.data(), rx_chunk.size(), MSG_DONTWAIT);
+            if (rx > 0) {
+                rx_buffer.insert(rx_buffer.end(), rx_chunk.begin(), rx_chunk.begin() + rx);
+                int frame;
+                while ((frame = mbap::frame_length(rx_buffer.data(), rx_buffer.size())) > 0) {
+                    const auto transaction = outstanding.find(mbap::transaction_id(rx_buffer.data()));
+                    if (outstanding.end() != transaction) {
+                        results.push_back(mbap::decode_response(transaction->second.request,
+                                                                rx_buffer.data(),
+                                                                size_t(frame)));
+                        outstanding.erase(transaction);
+                    }
+                    rx_buffer.erase(rx_buffer.begin(), rx_buffer.begin() + frame);
+                }
+
+                if (frame < 0) {
+                    //  Lost framing, outstanding requests will time out.
+                    rx_buffer.clear();
+                }
+            } else if ((0 == rx) || (EAGAIN != errno && EWOULDBLOCK != errno && EINTR != errno)) {
+                connected = false;
+            } else {
+
+            }
+        }
+
+        const auto expired = steady_clock::now();
+        for (auto i=outstanding.begin(); outstanding.end() != i;) {
+            if (!connected) {
+                results.push_back(mbap::error_result(i->second.request, ECONNRESET));
+                i = outstanding.erase(i);
+            } else if (i->second.deadline <= expired) {
+                results.push_back(mbap::error_result(i->second.request, ETIMEDOUT));
+                i = outstanding.erase(i);
+            } else {
+                ++i;
+            }
+        }
+        post_results(results);
+    }
+}
+
+
+quint16 ModbusThread::enqueue(ModbusTransaction &&transaction)
+{
+    //  The scheduler never has more than ``pipeline_depth`` transactions
+    // outstanding, a full ring means that contract was broken.
+    const auto transaction_id = m_next_transaction;
+    transaction.transaction_id = transaction_id;
+    if (!m_requests.try_push(std::move(transaction))) {
+        throw AppException("Modbus request queue full");
+    }
+    m_next_transaction++;
+    wake();
+
+    return transaction_id;
+}
+
+
+void ModbusThread::post_results(std::vector<ModbusResult> &results)
+{
+    auto posted = results.begin();
+    while ((results.end() != posted) && m_results.try_push(std::move(*posted))) {
+        ++posted;
     }
 
-    return int(m_count);
+    if (results.begin() != posted) {
+        results.erase(results.begin(), posted);
+        emit transactions_ready();
+    }
+}
+
+
+bool ModbusThread::take_result(ModbusResult &result)
+{
+    return m_results.try_pop(result);
+}
+
+
+void ModbusThread::wake()
+{
+    if (m_wake_fd >= 0) {
+        static_cast<void>(eventfd_write(m_wake_fd, 1));
+    }
+}
+
+
+void ModbusThread::wait_for_wake(const int timeout_ms)
+{
+    pollfd fd{m_wake_fd, POLLIN, 0};
+    if ((poll(&fd, 1U, timeout_ms) > 0) && (0 != (fd.revents & POLLIN))) {
+        eventfd_t unused;
+        static_cast<void>(eventfd_read(m_wake_fd, &unused));
+    }
+}
+
+
+int ModbusThread::pipeline_depth() const noexcept
+{
+    return m_pipeline_depth;
+}
+
+
+void ModbusThread::set_response_timeout(const std::chrono::milliseconds timeout)
+{
+    m_timeout = timeout;
 }
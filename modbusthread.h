@@ -26,29 +26,41 @@
  *
  * Modbus protocol functionality is abstracted (somewhat) from the display and
  * takes place in a separate thread because all libmodbus transactions are
- * treated as blocking calls.
+ * treated as blocking calls.  Optionally the thread may run "pipelined" where
+ * libmodbus is only used to establish the connection and several Modbus/TCP
+ * transactions are kept in flight on the socket, matched up by their MBAP
+ * transaction ID.
+ *
+ * Requests and results are passed between the main thread and the connection
+ * thread as self-contained descriptors (ModbusTransaction / ModbusResult)
+ * through a pair of lock-free single producer, single consumer rings, the
+ * connection thread is woken with an eventfd.  No state is shared between a
+ * request and its result so the scheduler never has to query the thread.
  */
 
 #ifndef MODBUSTHREAD_H
 #define MODBUSTHREAD_H
 
 //  c++ includes
+#include <atomic>  //  std::atomic
+#include <chrono>  //  std::chrono::milliseconds
+#include <vector>  //  std::vector
 #include <QThread>  //  QThread
-#include <QMutex>  //  QMutex
-#include <QWaitCondition>  //  QWaitCondition
 #include <QString>  //  QString
 
 // C includes
 #include <modbus/modbus.h>  //  modbus_t
 
 // project includes
-/* -none- */
+#include "modbus_connection.h"  //  ModbusConnection
+#include "mbap_codec.h"  //  ModbusTransaction, ModbusResult
+#include "spsc_ring.h"  //  SpscRing
 
 
 /**
- * \brief Modbus communication thread
+ * \brief Modbus communication thread (one per connection)
  */
-class ModbusThread : public QThread
+class ModbusThread : public ModbusConnection
 {
     Q_OBJECT
 
@@ -59,113 +71,127 @@ public:
      * @param parent parent QObject owner
      * @param host host to be resolved and connected to
      * @param port destination port
+     * @param pipeline_depth maximum number of outstanding transactions
+     *        (1 = one request at a time through libmodbus)
      */
-    ModbusThread(QObject *parent, const QString &host, const quint16 port);
+    ModbusThread(QObject *parent, const QString &host, const quint16 port, const int pipeline_depth=1);
+
+    virtual void start() override;
 
     /**
      * \brief Close and exit thread.
      * \note
      * Blocking call
      */
-    void close();
+    virtual void close() override;
+
+    virtual quint16 modbus_request(const quint16 first_reg, const quint16 num_regs, const quint8 uid) override;
+
+    virtual quint16 modbus_request(const quint16 first_reg,
+                                   std::vector<quint16> &&regs_to_write,
+                                   const quint8 uid) override;
+
+    virtual quint16 modbus_request(const quint8 *pdu,
+                                   const quint8 length,
+                                   const qint8 fc,
+                                   const quint8 uid) override;
+
+    [[nodiscard]] virtual bool take_result(ModbusResult &result) override;
+
+    [[nodiscard]] virtual int pipeline_depth() const noexcept override;
+
+    virtual void set_response_timeout(const std::chrono::milliseconds timeout) override;
+
+    ~ModbusThread() override;
+
+private:
+
+    /**
+     * \brief Pipelined request in flight on the socket
+     */
+    struct OutstandingTransaction {
+        ModbusTransaction request; /**< Original request */
+        std::chrono::steady_clock::time_point deadline; /**< Response timeout */
+    };
 
     /**
-     * \brief Issue a modbus read request
-     * @param first_reg first register number (0 = device id)
-     * @param num_regs number of registers to read
-     * @param uid Unit ID / Node to poll
+     * \brief Thread main.
      */
-    void modbus_request(const quint16 first_reg, const quint16 num_regs, const quint8 uid);
+    void run();
 
     /**
-     * \brief Issue a modbus write request
-     * @param first_reg first register number
-     * @param regs_to_write list of values to be written
-     * @param uid Unit ID / Node to poll
+     * \brief Main loop when not pipelined (one request at a time through libmodbus).
      */
-    void modbus_request(const quint16 first_reg, std::vector<quint16> &&regs_to_write, const quint8 uid);
+    void run_blocking();
 
     /**
-     * \brief Issue a raw modbus PDU
-     * @param pdu Modbus raw PDU to send
-     * @param length length of PDU
-     * @param fc function code
-     * @param uid Unit ID / Node to poll
+     * \brief Main loop when running pipelined.
      */
-    void modbus_request(const quint8 *pdu, const quint8 length, const qint8 fc, const quint8 uid);
+    void run_pipelined();
 
     /**
-     * \brief Obtain results from a previous modbus transaction.
-     * \note
-     * vector will contain a character array (quint8) if the request was
-     * device ID or a custom response.  Values promoted from quint8 to
-     * quint16.  This call results in the value being std::move'd from
-     * internal storage and can be made only once for each complete
-     * signal.
-     *
-     * @return register list
+     * \brief Queue a transaction for the connection thread.
+     * @param transaction request to send
+     * @throws AppException if more than ``pipeline_depth`` requests are queued
+     * @return transaction ID
      */
-    [[nodiscard]] std::vector<quint16> modbus_result();
+    quint16 enqueue(ModbusTransaction &&transaction);
 
     /**
-     * \brief Get the starting register for the most recent request call.
+     * \brief Hand results to the scheduler and notify.
      * \note
-     * This call and the next can't be const because they invoke lock.
-     * \sa get_unit_id
-     * @return register number (0 = id, 0xffff = custom)
+     * Results that don't fit are left in ``results`` for the next call.
+     *
+     * @param results completed transactions
      */
-    [[nodiscard]] quint16 get_start_reg();
+    void post_results(std::vector<ModbusResult> &results);
 
     /**
-     * \brief Get the node (unit id) that the most recent request was sent to.
-     * @return device / node / unit ID
+     * \brief Wake the connection thread.
      */
-    [[nodiscard]] quint8 get_unit_id();
-
-    virtual void run() override;
-
-    ~ModbusThread() override;
-
-signals:
+    void wake();
 
     /**
-     * \brief Emit poll exception.
-     * @param error_code Modbus error code reported
+     * \brief Sleep until woken.
+     * @param timeout_ms longest time to wait, -1 = forever
      */
-    void modbus_error(const int error_code);
+    void wait_for_wake(const int timeout_ms);
 
     /**
-     * \brief Emit poll complete.
+     * \brief Perform a transaction through libmodbus.
+     * @param request transaction to perform
+     * @return outcome
      */
-    void complete();
-
-private:
+    ModbusResult execute(const ModbusTransaction &request);
 
     /**
      * \brief Assemble a write multiple registers request
+     * @param request write transaction
      * @return result from modbus call
      */
-    int do_write_request();
+    int do_write_request(const ModbusTransaction &request);
 
     /**
      * \brief Consolidate the logic for custom requests (Modbus/TCP).
+     * @param request custom function transaction
+     * @param bytes [out] response data following the function code
      * @return result code
      */
-    int do_custom_request_tcp();
+    int do_custom_request_tcp(const ModbusTransaction &request, std::vector<quint8> &bytes);
 
     const QString m_host;
     const quint16 m_port;
+    QThread *const m_thread;
     modbus_t *m_ctx=nullptr;
-    QMutex m_mx;
-    QWaitCondition m_cond;
-    bool m_quit=false;
-    bool m_write_request=false;
-    const quint8 *m_raw_request=nullptr;
-
-    std::vector<quint16> m_regs;
-    quint16 m_reg_number=0;
-    quint16 m_count=0;
-    quint8 m_node=0;
+    std::atomic<bool> m_quit{false};
+
+    const int m_pipeline_depth;
+    int m_wake_fd=-1;
+    int m_wake_error=0;
+    quint16 m_next_transaction=0;
+    std::atomic<std::chrono::milliseconds> m_timeout;
+    SpscRing<ModbusTransaction> m_requests;  /**< Main thread -> connection thread */
+    SpscRing<ModbusResult> m_results;  /**< Connection thread -> main thread */
 };
 
 
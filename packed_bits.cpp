@@ -0,0 +1,135 @@
+/**
+ * \file packed_bits.cpp
+ * \brief Coil / input states packed 64 per word
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <algorithm>  //  std::min, std::max
+
+// C includes
+/* -none- */
+
+// project includes
+#include "packed_bits.h"  //  local include
+
+
+namespace {
+
+    /**
+     * \brief Read 64 bits starting at any bit position.
+     * @param words packed bits
+     * @param first first bit read, bits past the end read as 0
+     * @return bits ``first`` .. ``first + 63``
+     */
+    quint64 read_word(const std::vector<quint64> &words, const size_t first) noexcept
+    {
+        const auto word = first / packed_bits::WORD_BITS;
+        const auto shift = first % packed_bits::WORD_BITS;
+        auto result = (word < words.size() ? words[word] >> shift : 0U);
+        if ((0U != shift) && (word + 1U < words.size())) {
+            result |= words[word + 1U] << (packed_bits::WORD_BITS - shift);
+        }
+        return result;
+    }
+
+}  //  Anonymous namespace
+
+
+size_t packed_bits::get_word_count(const size_t count) noexcept
+{
+    return (count + WORD_BITS - 1U) / WORD_BITS;
+}
+
+
+quint64 packed_bits::get_mask(const size_t word, const size_t first, const size_t last) noexcept
+{
+    const auto word_first = word * WORD_BITS;
+    const auto lo = std::max(first, word_first);
+    const auto hi = std::min(last, word_first + WORD_BITS);
+    if (hi <= lo) {
+        return 0U;
+    }
+
+    const auto width = hi - lo;
+    const auto mask = (width == WORD_BITS ? ~quint64(0U) : (quint64(1U) << width) - 1U);
+    return mask << (lo - word_first);
+}
+
+
+bool packed_bits::get(const std::vector<quint64> &words, const size_t index) noexcept
+{
+    const auto word = index / WORD_BITS;
+    return (word < words.size()) && (0U != ((words[word] >> (index % WORD_BITS)) & 1U));
+}
+
+
+void packed_bits::set(std::vector<quint64> &words, const size_t index, const bool value) noexcept
+{
+    const auto word = index / WORD_BITS;
+    if (word < words.size()) {
+        const auto bit = quint64(1U) << (index % WORD_BITS);
+        words[word] = (value ? (words[word] | bit) : (words[word] & ~bit));
+    }
+}
+
+
+void packed_bits::pack_bytes(const quint8 *data, const size_t count, std::vector<quint64> &words)
+{
+    words.assign(get_word_count(count), 0U);
+    const auto byte_count = (count + 7U) / 8U;
+    for (size_t i=0U; i<byte_count; ++i) {
+        words[i / 8U] |= quint64(data[i]) << ((i % 8U) * 8U);
+    }
+
+    //  Clear the padding of the last byte.
+    if (!words.empty()) {
+        words.back() &= get_mask(words.size() - 1U, 0U, count);
+    }
+}
+
+
+void packed_bits::pack_flags(const quint8 *flags, const size_t count, std::vector<quint64> &words)
+{
+    words.assign(get_word_count(count), 0U);
+    for (size_t i=0U; i<count; ++i) {
+        words[i / WORD_BITS] |= quint64(flags[i] != 0U) << (i % WORD_BITS);
+    }
+}
+
+
+void packed_bits::copy(const std::vector<quint64> &source, const size_t source_first,
+                       std::vector<quint64> &destination, const size_t destination_first,
+                       const size_t count) noexcept
+{
+    if (0U == count) {
+        return;
+    }
+
+    const auto last = destination_first + count;
+    for (auto word = destination_first / WORD_BITS; word <= (last - 1U) / WORD_BITS; ++word) {
+        const auto mask = get_mask(word, destination_first, last);
+        const auto lo = std::max(destination_first, word * WORD_BITS);
+        const auto bits = read_word(source, source_first + (lo - destination_first)) << (lo % WORD_BITS);
+        destination[word] = (destination[word] & ~mask) | (bits & mask);
+    }
+}
@@ -0,0 +1,118 @@
+/**
+ * \file packed_bits.h
+ * \brief Coil / input states packed 64 per word
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * Coils and discrete inputs are carried from the wire to the display windows
+ * packed 64 to a word, least significant bit first (the order used by the
+ * Modbus PDU itself).  A full 2000-coil read is 32 words, so changes may be
+ * found with a word-wise XOR rather than one comparison per coil.
+ */
+
+#ifndef PACKED_BITS_H
+#define PACKED_BITS_H
+
+//  c++ includes
+#include <vector>  //  std::vector
+#include <QTypeInfo>  //  quint8, quint64
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+namespace packed_bits {
+
+    const size_t WORD_BITS = 64U; /**< Bits per packed word */
+
+    /**
+     * \brief Get the number of words needed to store a number of bits.
+     * @param count number of bits
+     * @return word count
+     */
+    [[nodiscard]] size_t get_word_count(const size_t count) noexcept;
+
+    /**
+     * \brief Get the mask of the bits of one word that fall in a range.
+     * @param word word index
+     * @param first first bit in the range
+     * @param last bit following the range
+     * @return mask of the bits in range
+     */
+    [[nodiscard]] quint64 get_mask(const size_t word, const size_t first, const size_t last) noexcept;
+
+    /**
+     * \brief Get the state of a bit.
+     * @param words packed bits
+     * @param index bit index
+     * @return ``true`` if set, ``false`` if clear or out of range
+     */
+    [[nodiscard]] bool get(const std::vector<quint64> &words, const size_t index) noexcept;
+
+    /**
+     * \brief Set the state of a bit.
+     * @param words [in,out] packed bits
+     * @param index bit index, ignored if out of range
+     * @param value new state
+     */
+    void set(std::vector<quint64> &words, const size_t index, const bool value) noexcept;
+
+    /**
+     * \brief Pack bits as sent on the wire (8 per byte, LSB first).
+     * @param data coil / input status bytes of a read response
+     * @param count number of bits
+     * @param words [out] packed bits
+     */
+    void pack_bytes(const quint8 *data, const size_t count, std::vector<quint64> &words);
+
+    /**
+     * \brief Pack bits stored one per byte (as returned by libmodbus).
+     * @param flags bit states, non-zero = set
+     * @param count number of bits
+     * @param words [out] packed bits
+     */
+    void pack_flags(const quint8 *flags, const size_t count, std::vector<quint64> &words);
+
+    /**
+     * \brief Copy a range of bits between packed buffers.
+     * \note
+     * Bits of ``destination`` outside of the range are preserved.
+     *
+     * @param source packed bits to copy from
+     * @param source_first first bit copied from ``source``
+     * @param destination [in,out] packed bits to copy to (must hold the range)
+     * @param destination_first position of the first bit in ``destination``
+     * @param count number of bits copied
+     */
+    void copy(const std::vector<quint64> &source, const size_t source_first,
+              std::vector<quint64> &destination, const size_t destination_first,
+              const size_t count) noexcept;
+
+}  //  namespace packed_bits
+
+
+#endif // PACKED_BITS_H
@@ -0,0 +1,77 @@
+/**
+ * \file poll_subscription.h
+ * \brief Periodic poll targets and achieved timing
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * While continuous polling is enabled each register window (and each trend
+ * line with a poll period) subscribes the registers it displays at its own
+ * target period.  The scheduler releases a subscription once per period and
+ * serves the released subscriptions earliest deadline first, the deadline of
+ * a poll being the release of the following one.  A period of 0 polls as
+ * fast as the connection allows, in the background of the periodic polls.
+ */
+
+#ifndef POLL_SUBSCRIPTION_H
+#define POLL_SUBSCRIPTION_H
+
+//  c++ includes
+#include <chrono>  //  std::chrono::milliseconds
+#include <QTypeInfo>  //  quint8, quint64
+
+// C includes
+/* -none- */
+
+// project includes
+#include "read_planner.h"  //  ReadRange
+
+
+/**
+ * \brief Block of registers polled periodically
+ */
+struct PollSubscription {
+    quint8 endpoint; /**< Endpoint (device connection) polled */
+
+    ReadRange range; /**< Registers polled */
+
+    std::chrono::milliseconds period; /**< Target period, 0 = as fast as possible */
+};
+
+
+/**
+ * \brief Timing achieved by a subscription
+ */
+struct PollStatistics {
+    BaseDialog *requester; /**< Subscribing window */
+
+    ReadRange range; /**< Registers polled */
+
+    double rate; /**< Achieved polls per second */
+
+    quint64 completed; /**< Successful polls */
+
+    quint64 missed; /**< Polls that failed or completed after their deadline */
+};
+
+
+#endif // POLL_SUBSCRIPTION_H
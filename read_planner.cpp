@@ -0,0 +1,138 @@
+/**
+ * \file read_planner.cpp
+ * \brief Coalesce register window polls into as few reads as possible
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <algorithm>  //  std::stable_sort, std::max
+
+// C includes
+#include <modbus/modbus.h>  //  MODBUS_MAX_READ_BITS, MODBUS_MAX_READ_REGISTERS
+
+// project includes
+#include "read_planner.h"  //  local include
+
+
+namespace {
+
+    /**
+     * \brief Get the register table (coils, inputs, input/holding registers).
+     * @param reg register number
+     * @return table index
+     */
+    quint16 get_table(const quint16 reg) noexcept
+    {
+        return quint16(reg / 10000U);
+    }
+
+
+    /**
+     * \brief Get the register following the last one in a range.
+     * @param range register range
+     * @return last register + 1
+     */
+    quint32 get_end(const ReadRange &range) noexcept
+    {
+        return quint32(range.first_register) + quint32(range.count);
+    }
+
+
+    /**
+     * \brief Determine whether a range may be added to a planned read.
+     * \note
+     * ``range`` must not start before ``read``.
+     *
+     * @param read read being built
+     * @param range candidate range
+     * @param max_gap largest number of unused registers allowed
+     * @return ``true`` if the range may be merged
+     */
+    bool can_merge(const ReadRange &read, const ReadRange &range, const quint16 max_gap) noexcept
+    {
+        if ((0 == read.count) || (read.node != range.node) ||
+                (get_table(read.first_register) != get_table(range.first_register))) {
+            return false;
+        }
+
+        const auto read_end = get_end(read);
+        if (quint32(range.first_register) > read_end + max_gap) {
+            return false;
+        }
+
+        const auto end = std::max(read_end, get_end(range));
+        return (end - read.first_register) <= read_planner::get_read_limit(read.first_register);
+    }
+
+}  //  Anonymous namespace
+
+
+quint16 read_planner::get_read_limit(const quint16 first_register) noexcept
+{
+    if (first_register <= 19999) {
+        return MODBUS_MAX_READ_BITS;
+    }
+
+    return MODBUS_MAX_READ_REGISTERS;
+}
+
+
+std::vector<PlannedRead> read_planner::plan(std::vector<ReadSubscriber> &&requests,
+                                            const quint16 max_gap)
+{
+    std::vector<PlannedRead> reads;
+    reads.reserve(requests.size());
+
+    std::vector<ReadSubscriber> mergeable;
+    mergeable.reserve(requests.size());
+    for (auto &i: requests) {
+        if (0 == i.range.count) {
+            reads.push_back({i.range, {i}});
+        } else {
+            mergeable.push_back(i);
+        }
+    }
+
+    //  Group by node and table, ascending register within each group.
+    std::stable_sort(mergeable.begin(), mergeable.end(),
+                     [](const ReadSubscriber &a, const ReadSubscriber &b) {
+        if (a.range.node != b.range.node) {
+            return a.range.node < b.range.node;
+        }
+        return a.range.first_register < b.range.first_register;
+    });
+
+    const auto gap = std::min(max_gap, MAX_GAP);
+    const auto first_mergeable = reads.size();
+    for (auto &i: mergeable) {
+        if ((reads.size() > first_mergeable) && can_merge(reads.back().range, i.range, gap)) {
+            auto &read = reads.back();
+            const auto end = std::max(get_end(read.range), get_end(i.range));
+            read.range.count = quint16(end - read.range.first_register);
+            read.subscribers.push_back(i);
+        } else {
+            reads.push_back({i.range, {i}});
+        }
+    }
+
+    return reads;
+}
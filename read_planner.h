@@ -0,0 +1,117 @@
+/**
+ * \file read_planner.h
+ * \brief Coalesce register window polls into as few reads as possible
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * Before each scan the scheduler hands the list of windows waiting to be
+ * polled to the planner.  Windows polling the same node and register table
+ * whose ranges overlap, touch or are separated by no more than ``max_gap``
+ * registers are merged into a single read, within the protocol limits of
+ * 125 registers or 2000 coils / inputs per request.  Each planned read keeps
+ * the list of windows (subscribers) that it serves so that the response can
+ * be split back out and exceptions reported to every window affected.
+ */
+
+#ifndef READ_PLANNER_H
+#define READ_PLANNER_H
+
+//  c++ includes
+#include <vector>  //  std::vector
+#include <QTypeInfo>  //  quint8, quint16, quint64
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+// /////////////////////////////////////////////////////////////////////////////
+// Forward declarations
+// /////////////////////////////////////////////////////////////////////////////
+class BaseDialog;
+
+
+/**
+ * \brief Block of registers read from a node
+ */
+struct ReadRange {
+    quint8 node; /**< Node / device ID polled */
+
+    quint16 first_register; /**< Starting register number (eg: 1, 40001) */
+
+    quint16 count; /**< Number of registers, 0 = unknown (not coalesced) */
+};
+
+
+/**
+ * \brief Window served by a read
+ */
+struct ReadSubscriber {
+    BaseDialog *requester; /**< Request source (may be null once closed) */
+
+    ReadRange range; /**< Registers polled on behalf of requester */
+
+    quint64 job; /**< Periodic job served (scheduler defined), 0 = one-shot */
+};
+
+
+/**
+ * \brief Read request issued to the connection
+ */
+struct PlannedRead {
+    ReadRange range; /**< Registers actually read */
+
+    std::vector<ReadSubscriber> subscribers; /**< Windows served by this read */
+};
+
+
+namespace read_planner {
+
+    const quint16 MAX_GAP = 124U; /**< Largest gap threshold accepted */
+
+    /**
+     * \brief Get the maximum number of registers in a single read.
+     * @param first_register register number in the table to read
+     * @return 2000 for coils / inputs, 125 for registers
+     */
+    [[nodiscard]] quint16 get_read_limit(const quint16 first_register) noexcept;
+
+    /**
+     * \brief Build the list of reads for one scan.
+     * \note
+     * Subscribers with an unknown range (count = 0) are issued on their own.
+     *
+     * @param requests windows waiting to be polled
+     * @param max_gap largest number of unused registers allowed between two
+     *                merged ranges (0 = only merge overlapping / adjacent)
+     * @return planned reads
+     */
+    [[nodiscard]] std::vector<PlannedRead> plan(std::vector<ReadSubscriber> &&requests,
+                                                const quint16 max_gap);
+
+}  //  namespace read_planner
+
+
+#endif // READ_PLANNER_H
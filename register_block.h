@@ -0,0 +1,81 @@
+/**
+ * \file register_block.h
+ * \brief Block of register values delivered from a single read.
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * A read is delivered to every window as one block rather than one signal per
+ * register.  The values are shared and never modified once published so the
+ * block may be passed around (or queued) without copying, each receiver
+ * copies out only the registers it displays.  Coils and discrete inputs are
+ * kept packed 64 to a word \sa packed_bits
+ */
+
+#ifndef REGISTER_BLOCK_H
+#define REGISTER_BLOCK_H
+
+//  c++ includes
+#include <memory>  //  std::shared_ptr
+#include <vector>  //  std::vector
+#include <QTypeInfo>  //  quint8, quint16, quint64
+
+// C includes
+/* -none- */
+
+// project includes
+#include "packed_bits.h"  //  packed_bits::get
+
+
+/**
+ * \brief Consecutive register values read from a node
+ */
+struct RegisterBlock {
+    quint8 node; /**< Node / device ID polled */
+
+    quint16 first_register; /**< Register number of the first value (eg: 1, 40001) */
+
+    quint16 count; /**< Number of registers / coils / inputs read */
+
+    std::shared_ptr<const std::vector<quint16>> values; /**< Register values (immutable), null for bit reads */
+
+    std::shared_ptr<const std::vector<quint64>> bits; /**< Packed bit states (immutable), null for register reads */
+};
+
+
+/**
+ * \brief Get one value from a block.
+ * @param block block read
+ * @param index index within the block (< count)
+ * @return register value, or 0 / 1 for coils and inputs
+ */
+[[nodiscard]] inline quint16 get_block_value(const RegisterBlock &block, const size_t index) noexcept
+{
+    if (nullptr != block.bits) {
+        return quint16(packed_bits::get(*block.bits, index));
+    }
+
+    return (*block.values)[index];
+}
+
+
+#endif // REGISTER_BLOCK_H
@@ -25,12 +25,15 @@
 
 
 //  c++ includes
-#include <chrono>  //  std::chrono::seconds
+#include <algorithm>  //  std::min, std::max
+#include <chrono>  //  std::chrono::seconds, std::chrono::milliseconds
+#include <QtAlgorithms>  //  qPopulationCount, qCountTrailingZeroBits
 #include <QStringList>  //  QStringList
 #include <QFileDialog>  //  QFileDialog
 #include <QMessageBox>  //  QMessageBox
 #include <QScrollBar>  //  QScrollBar
 #include <QSpacerItem>  //  QSpacerItem
+#include <QHeaderView>  //  QHeaderView
 #include <qtcsv/stringdata.h>  //  QtCSV::StringData
 #include <qtcsv/writer.h>  //  QtCSV::Writer::write
 
@@ -41,6 +44,17 @@
 #include "register_display.h"  //  local include
 #include "metadata_wrapper.h"  //  MetadataWrapper
 #include "scheduler.h"  //  SystemRegister
+#include "register_value_delegate.h"  //  RegisterValueDelegate
+#include "capture_file.h"  //  capture_file::write
+#include "exceptions.h"  //  AppException
+#include "packed_bits.h"  //  packed_bits::copy
+
+
+namespace {
+    const auto g_max_period = 3600000;  /**< Longest poll period (ms), 1 hour */
+    const auto g_grid_rows = quint16(64);  /**< Largest window shown as widgets by default */
+    const auto g_max_redraw_rate = 20;  /**< Redraws per second */
+}  //  Anonymous namespace
 
 
 RegisterDisplay::RegisterDisplay(QWidget *parent, const quint16 base_reg, const quint16 count, const quint8 uid)
@@ -48,6 +62,7 @@ RegisterDisplay::RegisterDisplay(QWidget *parent, const quint16 base_reg, const
           m_starting_register{base_reg},
           m_count{count},
           m_node{uid},
+          m_table_view{count > g_grid_rows},
           m_register_labels(),
           m_register_values(),
           m_register_descriptions(),
@@ -56,16 +71,27 @@ RegisterDisplay::RegisterDisplay(QWidget *parent, const quint16 base_reg, const
           m_scroll_area{new QScrollArea(this)},
           m_scroll_container{new QWidget(m_scroll_area)},
           m_scroll_layout{new QGridLayout(m_scroll_container)},
+          m_table{new QTableView(m_scroll_container)},
           m_status{new QStatusBar(this)},
           m_control_box{new QGroupBox(tr("Settings"), m_scroll_container)},
           m_control_grid{new QGridLayout(m_control_box)},
           m_reg_select{new QSpinBox(m_control_box)},
           m_node_select{new QSpinBox(m_control_box)},
           m_quantity{new QSpinBox(m_control_box)},
+          m_endpoint_select{new QSpinBox(m_control_box)},
+          m_period_select{new QSpinBox(m_control_box)},
+          m_view_select{new QCheckBox(tr("Table View"), m_control_box)},
+          m_rate_label{new QLabel(m_status)},
           m_apply_button{new QPushButton(tr("Apply\nChanges"), m_control_box)},
           m_refresh_button{nullptr},
           m_save_button{new QPushButton(tr("Save\nData"), m_control_box)},
-          m_status_timer{new QTimer(this)}
+          m_status_timer{new QTimer(this)},
+          m_redraw_timer{new QTimer(this)},
+          m_row_state(count, ROW_EMPTY),
+          m_dirty_rows(),
+          m_bit_state(),
+          m_bit_stale(),
+          m_bit_scratch()
 {
     if (base_reg <= 19999) {
         m_max_regs=0x07D0;
@@ -75,6 +101,9 @@ RegisterDisplay::RegisterDisplay(QWidget *parent, const quint16 base_reg, const
 
     m_status_timer->setSingleShot(true);
     m_status_timer->setInterval(std::chrono::seconds(30));
+    m_redraw_timer->setSingleShot(true);
+    m_redraw_timer->setInterval(1000 / g_max_redraw_rate);
+    connect(m_redraw_timer, &QTimer::timeout, this, &RegisterDisplay::on_redraw_timer_timeout);
     connect(this, &RegisterDisplay::window_closed, this, [=](QWidget*) {
         deleteLater();
     });
@@ -83,18 +112,17 @@ RegisterDisplay::RegisterDisplay(QWidget *parent, const quint16 base_reg, const
 
 void RegisterDisplay::setupUi()
 {
-    for (quint16 i=0U; i<m_count; i++) {
-        auto reg = new QLabel(m_scroll_container);
-        auto reg_value = create_value_widget(i, true);
-        auto reg_descr = new QLabel(m_scroll_container);
-        reg->setText(get_register_number_text(m_starting_register + i));
-        m_scroll_layout->addWidget(reg, i+1, 0);
-        m_scroll_layout->addWidget(reg_value, i+1, 1);
-        m_scroll_layout->addWidget(reg_descr, i+1, 2);
-        m_register_labels.push_back(reg);
-        m_register_values.push_back(reg_value);
-        m_register_descriptions.push_back(reg_descr);
-    }
+    m_model = new RegisterTableModel(this, get_value_editor());
+    connect(m_model, &RegisterTableModel::value_edited, this, &RegisterDisplay::on_table_value_edited);
+    m_table->setModel(m_model);
+    m_table->setItemDelegateForColumn(RegisterTableModel::COLUMN_VALUE, new RegisterValueDelegate(m_table));
+    m_table->setSelectionMode(QAbstractItemView::SingleSelection);
+    m_table->setWordWrap(false);
+    m_table->verticalHeader()->setVisible(false);
+    m_table->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    m_table->horizontalHeader()->setStretchLastSection(true);
+    m_scroll_layout->addWidget(m_table, 1, 0, 1, 3);
+    update_rows(true);
 
     m_top_layout->addWidget(m_scroll_area);
     m_top_layout->addWidget(m_status);
@@ -102,7 +130,6 @@ void RegisterDisplay::setupUi()
     m_top_layout->setContentsMargins(0, 0, 0, 0);
     setContentsMargins(0, 0, 0, 0);
     m_scroll_area->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    m_scroll_area->setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
     m_scroll_area->setWidget(m_scroll_container);
     m_scroll_container->setLayout(m_scroll_layout);
     m_scroll_layout->setVerticalSpacing(15);
@@ -138,6 +165,21 @@ void RegisterDisplay::setupUi()
     m_node_select->setRange(0, 255);
     m_node_select->setValue(int(m_node));
 
+    m_control_grid->addWidget(new QLabel(tr("Endpoint Select"), m_control_box), 5, 0);
+    m_control_grid->addWidget(m_endpoint_select, 6, 0);
+    m_endpoint_select->setRange(0, 255);
+    m_endpoint_select->setValue(int(m_endpoint));
+
+    m_control_grid->addWidget(new QLabel(tr("Poll Period (ms)"), m_control_box), 5, 1);
+    m_control_grid->addWidget(m_period_select, 6, 1);
+    m_period_select->setRange(0, g_max_period);
+    m_period_select->setSingleStep(50);
+    m_period_select->setSpecialValueText(tr("Fastest"));
+    m_period_select->setValue(int(m_poll_period.count()));
+
+    m_control_grid->addWidget(m_view_select, 5, 2, 2, 1);
+    m_view_select->setChecked(m_table_view);
+
     m_control_grid->addWidget(m_apply_button, 1, 2, 2, 1);
     add_icon_to_button(m_apply_button, QStyle::SP_DialogApplyButton);
     connect(m_apply_button, &QPushButton::clicked, this, &RegisterDisplay::on_apply_clicked);
@@ -155,6 +197,7 @@ void RegisterDisplay::setupUi()
 
     m_scroll_area->show();
     m_control_box->show();
+    m_status->addPermanentWidget(m_rate_label);
     m_status->show();
     set_title();
 
@@ -163,9 +206,21 @@ void RegisterDisplay::setupUi()
 }
 
 
-void RegisterDisplay::poll_register_set(ModbusThread *const engine)
+quint16 RegisterDisplay::poll_register_set(ModbusConnection *const engine)
+{
+    return engine->modbus_request(m_starting_register, m_count, quint8(m_node_select->value()));
+}
+
+
+ReadRange RegisterDisplay::get_read_range() const
+{
+    return {quint8(m_node_select->value()), m_starting_register, m_count};
+}
+
+
+std::vector<PollSubscription> RegisterDisplay::get_poll_subscriptions() const
 {
-    engine->modbus_request(m_starting_register, m_count, quint8(m_node_select->value()));
+    return {{m_endpoint, get_read_range(), m_poll_period}};
 }
 
 
@@ -176,13 +231,12 @@ void RegisterDisplay::on_new_value(const quint16 reg, const quint16 value, const
         if (SystemRegister::SYSTEM_CONNECTED == value ||
                 SystemRegister::SYSTEM_DISCONNECTED == value) {
             m_meta_in_process = false;
+            m_rate_label->clear();
         }
     } else if (unit_id == m_node && reg >= m_starting_register) {
         const auto reg_idx = size_t(reg - m_starting_register);
         if (reg_idx < m_count) {
-            m_raw_values[reg_idx] = value;
-            auto decoded_value = decode_register(value, m_register_encoding[reg_idx]);
-            updateRegisterValue(reg_idx, decoded_value);
+            set_register_value(reg_idx, value);
         }
     } else {
 
@@ -190,20 +244,125 @@ void RegisterDisplay::on_new_value(const quint16 reg, const quint16 value, const
 }
 
 
+void RegisterDisplay::on_register_block(const quint8 endpoint, const RegisterBlock block)
+{
+    if ((endpoint != m_endpoint) || (block.node != m_node)) {
+        return;
+    }
+
+    //  Copy out the overlap of the block and this window only.
+    const auto block_end = size_t(block.first_register) + block.count;
+    const auto first = std::max(size_t(block.first_register), size_t(m_starting_register));
+    const auto last = std::min(block_end, size_t(m_starting_register) + m_count);
+    if (first >= last) {
+        return;
+    } else if ((nullptr != block.bits) && !m_bit_state.empty()) {
+        set_bit_values(block, first, last);
+        return;
+    } else {
+
+    }
+
+    for (auto reg=first; reg<last; ++reg) {
+        set_register_value(reg - m_starting_register, get_block_value(block, reg - block.first_register));
+    }
+}
+
+
+void RegisterDisplay::set_bit_values(const RegisterBlock &block, const size_t first, const size_t last)
+{
+    //  Line the block up with the window, then XOR against the state stored.
+    const auto first_index = first - m_starting_register;
+    const auto last_index = last - m_starting_register;
+    m_bit_scratch.resize(m_bit_state.size());
+    packed_bits::copy(*block.bits, first - block.first_register, m_bit_scratch, first_index, last - first);
+
+    const auto last_word = (last_index - 1U) / packed_bits::WORD_BITS;
+    for (auto word = first_index / packed_bits::WORD_BITS; word <= last_word; ++word) {
+        const auto mask = packed_bits::get_mask(word, first_index, last_index);
+        auto changed = ((m_bit_scratch[word] ^ m_bit_state[word]) | m_bit_stale[word]) & mask;
+        m_suppressed_redraws += qPopulationCount(mask & ~changed);
+        m_bit_stale[word] &= ~mask;
+        while (0U != changed) {
+            const auto bit = qCountTrailingZeroBits(changed);
+            changed &= changed - 1U;
+            set_register_value(word * packed_bits::WORD_BITS + bit,
+                               quint16((m_bit_scratch[word] >> bit) & 1U));
+        }
+    }
+}
+
+
+void RegisterDisplay::set_register_value(const size_t index, const quint16 value)
+{
+    if (ROW_EMPTY != m_row_state[index] && m_raw_values[index] == value) {
+        ++m_suppressed_redraws;
+        return;
+    }
+
+    m_raw_values[index] = value;
+    if (!m_bit_state.empty()) {
+        packed_bits::set(m_bit_state, index, value > 0);
+    }
+    mark_dirty(index);
+}
+
+
+void RegisterDisplay::mark_dirty(const size_t index)
+{
+    if (ROW_DIRTY == m_row_state[index]) {
+        //  The previous value was never drawn.
+        ++m_suppressed_redraws;
+    } else {
+        m_row_state[index] = ROW_DIRTY;
+        m_dirty_rows.push_back(index);
+    }
+
+    if (!m_redraw_timer->isActive()) {
+        m_redraw_timer->start();
+    }
+}
+
+
+void RegisterDisplay::invalidate_register(const size_t index)
+{
+    if (index < m_row_state.size() && ROW_SHOWN == m_row_state[index]) {
+        m_row_state[index] = ROW_EMPTY;
+        if (!m_bit_stale.empty()) {
+            packed_bits::set(m_bit_stale, index, true);
+        }
+    }
+}
+
+
+void RegisterDisplay::on_redraw_timer_timeout()
+{
+    for (const auto index: m_dirty_rows) {
+        //  Rows may have been removed / cleared since being queued.
+        if (index < m_row_state.size() && ROW_DIRTY == m_row_state[index]) {
+            m_row_state[index] = ROW_SHOWN;
+            updateRegisterValue(index, decode_register(m_raw_values[index],
+                                                       m_register_encoding[index]));
+        }
+    }
+    m_dirty_rows.clear();
+}
+
+
 void RegisterDisplay::updateRegisterValue(const size_t index, const QString &value)
 {
-    auto *lbl = dynamic_cast<QLabel*>(m_register_values[index]);
-    lbl->setText(value);
+    if (m_table_view) {
+        m_model->set_value(int(index), value);
+    } else {
+        auto *lbl = dynamic_cast<QLabel*>(m_register_values[index]);
+        lbl->setText(value);
+    }
 }
 
 
-void RegisterDisplay::on_apply_clicked()
+void RegisterDisplay::resize_widget_rows(const size_t rows, const bool initial)
 {
-    m_have_metadata = false;
-    quint16 new_count = quint16(m_quantity->value());
-    m_register_encoding.resize(size_t(m_quantity->value()));
-    m_raw_values.resize(size_t(m_quantity->value()));
-    while (new_count < m_count) {
+    while (m_register_values.size() > rows) {
         auto label = m_register_labels.back();
         m_register_labels.pop_back();
         m_scroll_layout->removeWidget(label);
@@ -218,39 +377,117 @@ void RegisterDisplay::on_apply_clicked()
         m_scroll_layout->removeWidget(descr);
         m_register_descriptions.pop_back();
         descr->deleteLater();
-
-        m_count--;
     }
 
-    while (new_count > m_count) {
-        m_count++;
+    //  Row 0 is the control box, row 1 the table view.
+    while (m_register_values.size() < rows) {
+        const auto index = quint16(m_register_values.size());
+        const auto row = int(index) + 2;
 
-        auto label = new QLabel(m_scroll_area);
-        m_scroll_layout->addWidget(label, int(m_count), 0);
+        auto label = new QLabel(m_scroll_container);
+        m_scroll_layout->addWidget(label, row, 0);
         m_register_labels.push_back(label);
         label->show();
 
-        auto reg = create_value_widget(m_count, false);
-        m_scroll_layout->addWidget(reg, int(m_count), 1);
+        auto reg = create_value_widget(index, initial);
+        m_scroll_layout->addWidget(reg, row, 1);
         m_register_values.push_back(reg);
         reg->show();
 
-        auto descr = new QLabel(m_scroll_area);
-        m_scroll_layout->addWidget(descr, int(m_count), 2);
+        auto descr = new QLabel(m_scroll_container);
+        m_scroll_layout->addWidget(descr, row, 2);
         m_register_descriptions.push_back(descr);
         descr->show();
     }
+}
+
 
-    m_starting_register=quint16(m_reg_select->value());
-    for (quint16 i=0; i<new_count; i++) {
-        m_register_labels[i]->setText(get_register_number_text(i + m_starting_register));
-        m_register_labels[i]->setText(QString::number(int(i + m_starting_register)));
-        m_register_encoding[i]=RegisterEncoding::ENCODING_NONE;
-        m_register_descriptions[i]->setText("");
+void RegisterDisplay::update_rows(const bool initial)
+{
+    m_register_encoding.assign(m_count, RegisterEncoding::ENCODING_NONE);
+    m_raw_values.resize(m_count);
+    m_row_state.assign(m_count, ROW_EMPTY);
+    m_dirty_rows.clear();
+    if (m_starting_register <= 19999) {
+        //  Every row is empty, so all are stored on the next poll.
+        const auto words = packed_bits::get_word_count(m_count);
+        m_bit_state.assign(words, 0U);
+        m_bit_stale.assign(words, ~quint64(0U));
+    } else {
+        m_bit_state.clear();
+        m_bit_stale.clear();
+    }
+    if (m_table_view) {
+        resize_widget_rows(0, initial);
+        std::vector<QString> labels;
+        labels.reserve(m_count);
+        for (quint16 i=0U; i<m_count; ++i) {
+            labels.push_back(get_register_number_text(m_starting_register + i));
+        }
+        m_model->reset(std::move(labels));
+    } else {
+        m_model->reset({});
+        resize_widget_rows(m_count, initial);
+        for (quint16 i=0U; i<m_count; ++i) {
+            m_register_labels[i]->setText(get_register_number_text(m_starting_register + i));
+            m_register_descriptions[i]->setText("");
+        }
     }
 
+    set_view_mode();
+}
+
+
+void RegisterDisplay::set_view_mode()
+{
+    //  The table scrolls itself, let it take up the rest of the window.
+    m_table->setVisible(m_table_view);
+    m_scroll_layout->setRowStretch(1, (m_table_view ? 1 : 0));
+    m_scroll_area->setVerticalScrollBarPolicy(m_table_view ? Qt::ScrollBarAsNeeded :
+                                                             Qt::ScrollBarAlwaysOn);
+}
+
+
+void RegisterDisplay::set_description(const size_t index, const QString &description)
+{
+    if (m_table_view) {
+        m_model->set_description(int(index), description);
+    } else {
+        m_register_descriptions[index]->setText(description);
+    }
+}
+
+
+QString RegisterDisplay::get_description(const size_t index) const
+{
+    if (m_table_view) {
+        return m_model->get_description(int(index));
+    }
+
+    return m_register_descriptions[index]->text();
+}
+
+
+void RegisterDisplay::on_apply_clicked()
+{
+    m_have_metadata = false;
+    const auto new_count = quint16(m_quantity->value());
+    if (new_count > g_grid_rows && m_count <= g_grid_rows) {
+        m_view_select->setChecked(true);
+    }
+
+    m_count = new_count;
+    m_starting_register = quint16(m_reg_select->value());
+    m_table_view = m_view_select->isChecked();
+    update_rows(false);
+
+    m_node = quint8(m_node_select->value());
+    m_endpoint = quint8(m_endpoint_select->value());
+    m_poll_period = std::chrono::milliseconds(m_period_select->value());
     m_meta_in_process = false;
+    m_rate_label->clear();
     set_title();
+    emit poll_configuration_changed(this);
 }
 
 
@@ -316,6 +553,18 @@ void RegisterDisplay::on_exception_status(BaseDialog *const requester, const QSt
 }
 
 
+void RegisterDisplay::on_poll_statistics(const quint8 endpoint, const PollStatistics statistics)
+{
+    static_cast<void>(endpoint);
+    if (this == statistics.requester) {
+        m_rate_label->setText(tr("%1 Hz, %2 missed")
+                              .arg(statistics.rate, 0, 'f', 1)
+                              .arg(statistics.missed));
+        m_rate_label->setToolTip(tr("%1 redraws suppressed").arg(m_suppressed_redraws));
+    }
+}
+
+
 QWidget* RegisterDisplay::create_value_widget(const quint16 index, const bool initial)
 {
     static_cast<void>(index);
@@ -324,6 +573,19 @@ QWidget* RegisterDisplay::create_value_widget(const quint16 index, const bool in
 }
 
 
+RegisterTableModel::ValueEditor RegisterDisplay::get_value_editor() const
+{
+    return RegisterTableModel::EDITOR_NONE;
+}
+
+
+void RegisterDisplay::on_table_value_edited(const int row, const QString value)
+{
+    static_cast<void>(row);
+    static_cast<void>(value);
+}
+
+
 void RegisterDisplay::on_status_timer_timeout()
 {
     m_status->showMessage("");
@@ -342,6 +604,9 @@ void RegisterDisplay::save_configuration_parameters(QDomElement &node) const
     node.setAttribute("count", QString::number(m_count));
     node.setAttribute("node", QString::number(m_node));
     node.setAttribute("max", QString::number(m_max_regs));
+    node.setAttribute("endpoint", QString::number(m_endpoint));
+    node.setAttribute("period", QString::number(m_poll_period.count()));
+    node.setAttribute("view", (m_table_view ? "table" : "grid"));
 
     const auto position = pos();
     const auto w_size = size();
@@ -350,7 +615,8 @@ void RegisterDisplay::save_configuration_parameters(QDomElement &node) const
     node.setAttribute("x", QString::number(position.x()));
     node.setAttribute("y", QString::number(position.y()));
 
-    const QScrollBar *adj = m_scroll_area->verticalScrollBar();
+    const QScrollBar *adj = (m_table_view ? m_table->verticalScrollBar() :
+                                            m_scroll_area->verticalScrollBar());
     node.setAttribute("scroll", QString::number(adj->value()));
 }
 
@@ -358,7 +624,15 @@ void RegisterDisplay::save_configuration_parameters(QDomElement &node) const
 bool RegisterDisplay::load_configuration_parameters(const QDomElement &node)
 {
     auto max = node.attribute("max").toUInt();
-    if (max == m_max_regs) {
+    const auto endpoint = node.attribute("endpoint", "0").toInt();
+    const auto period = node.attribute("period", "0").toInt();
+    const auto view = node.attribute("view", (m_table_view ? "table" : "grid"));
+    if (max == m_max_regs && endpoint >= 0 && endpoint <= 255 &&
+            period >= 0 && period <= g_max_period &&
+            (view == "table" || view == "grid")) {
+        m_endpoint = quint8(endpoint);
+        m_poll_period = std::chrono::milliseconds(period);
+        m_table_view = (view == "table");
         const auto x = node.attribute("x", "");
         const auto y = node.attribute("y", "");
         if (x.length() > 0 && y.length() > 0) {
@@ -371,7 +645,8 @@ bool RegisterDisplay::load_configuration_parameters(const QDomElement &node)
         if (h > 0 && w > 0 && scroll >= 0) {
             connect(this, &RegisterDisplay::window_first_display, this, [=](BaseDialog *window) {
                 static_cast<void>(window);
-                QScrollBar *adj = m_scroll_area->verticalScrollBar();
+                QScrollBar *adj = (m_table_view ? m_table->verticalScrollBar() :
+                                                  m_scroll_area->verticalScrollBar());
                 adj->setValue(scroll);
                 resize(w, h);
             });
@@ -388,8 +663,13 @@ void RegisterDisplay::set_metadata(std::shared_ptr<Metadata> metadata, const qui
     if (node == m_node && metadata->register_number >= m_starting_register &&
             metadata->register_number < m_starting_register + m_count) {
         const size_t index = metadata->register_number - m_starting_register;
-        m_register_descriptions[index]->setText(metadata->label);
-        m_register_encoding[index] = metadata->encoding;
+        set_description(index, metadata->label);
+        if (m_register_encoding[index] != metadata->encoding) {
+            m_register_encoding[index] = metadata->encoding;
+            if (ROW_SHOWN == m_row_state[index]) {
+                mark_dirty(index);
+            }
+        }
         if (index == (m_count - 1)) {
             m_meta_in_process = false;
             m_have_metadata = true;
@@ -402,19 +682,31 @@ void RegisterDisplay::set_metadata(std::shared_ptr<Metadata> metadata, const qui
 
 void RegisterDisplay::on_save_clicked()
 {
+    const auto capture_filter = tr("Capture (*.%1)").arg(capture_file::SUFFIX);
     auto dialog = QFileDialog(this, tr("Save data as..."));
     dialog.setNameFilters({tr("Spreadsheet (*.csv)"),
+                           capture_filter,
                            tr("All files (*)")});
     dialog.setAcceptMode(QFileDialog::AcceptSave);
     dialog.setViewMode(QFileDialog::Detail);
     dialog.setFileMode(QFileDialog::AnyFile);
     dialog.setDefaultSuffix("csv");
+    connect(&dialog, &QFileDialog::filterSelected, this, [&](const QString &filter) {
+        dialog.setDefaultSuffix((filter == capture_filter) ? QString(capture_file::SUFFIX) : QString("csv"));
+    });
     if (dialog.exec() != 0) {
         auto file_name = dialog.selectedFiles().first();
-        if (!save_register_set(file_name)) {
+        const auto capture = file_name.endsWith(QString(".") + capture_file::SUFFIX);
+        try {
+            if (!(capture ? save_register_capture(file_name) : save_register_set(file_name))) {
+                QMessageBox::warning(this, tr("Save registers"),
+                                     tr("Cannot write file %1:\n.")
+                                     .arg(QDir::toNativeSeparators(file_name)));
+            }
+        } catch (const AppException &e) {
             QMessageBox::warning(this, tr("Save registers"),
-                                 tr("Cannot write file %1:\n.")
-                                 .arg(QDir::toNativeSeparators(file_name)));
+                                 tr("Cannot write file %1:\n%2")
+                                 .arg(QDir::toNativeSeparators(file_name), QString(e)));
         }
     }
 }
@@ -422,6 +714,10 @@ void RegisterDisplay::on_save_clicked()
 
 QString RegisterDisplay::get_display_value(const size_t index) const
 {
+    if (m_table_view) {
+        return m_model->get_value(int(index));
+    }
+
     const auto *lbl = dynamic_cast<QLabel*>(m_register_values[index]);
     return lbl->text();
 }
@@ -457,7 +753,7 @@ bool RegisterDisplay::save_register_set(const QString &path)
         QStringList row;
         row << QString::number(m_starting_register + i);
         if (m_have_metadata) {
-            row << m_register_descriptions[i]->text();
+            row << get_description(i);
         }
         row << get_display_value(i)
             << QString::number(m_node);
@@ -473,6 +769,18 @@ bool RegisterDisplay::save_register_set(const QString &path)
 }
 
 
+bool RegisterDisplay::save_register_capture(const QString &path)
+{
+    //  One row of every register in the window, as received.
+    const auto now = std::chrono::system_clock::now().time_since_epoch();
+    CaptureSeries series{m_starting_register, m_count, m_node, m_endpoint, false, 1.0, 0.0, 0U,
+                         {std::chrono::duration_cast<std::chrono::milliseconds>(now).count()},
+                         m_raw_values};
+
+    return capture_file::write(path, {series});
+}
+
+
 QString RegisterDisplay::get_register_number_text(const quint16 reg_number)
 {
     return QString::number(reg_number);
@@ -485,5 +793,12 @@ void RegisterDisplay::set_title()
                    " - " %
                    get_register_number_text(m_starting_register + m_count - 1) %
                    '@' %
-                   QString::number(m_node));
+                   QString::number(m_node) %
+                   (m_endpoint > 0 ? tr(" (endpoint %1)").arg(int(m_endpoint)) : QString()));
+}
+
+
+quint8 RegisterDisplay::get_endpoint() const noexcept
+{
+    return m_endpoint;
 }
@@ -29,6 +29,11 @@
  * registers, indicators, and coils).  This also encludes a custom encoding
  * mechanism (ie non-modbus standard) to retrieve register metadata including
  * limits, defaults, data types, and a brief human-readable description.
+ *
+ * Registers are shown either as a grid of widgets (3 per register) or, for
+ * large windows, in a table view backed by a RegisterTableModel which only
+ * paints the visible rows.  Polled values are only redrawn when they change
+ * and redraws are batched, at most 20 times a second.
  */
 
 #ifndef REGISTER_DISPLAY_H
@@ -42,9 +47,12 @@
 #include <QGroupBox>  //  QGroupBox
 #include <QSpinBox>  //  QSpinBox
 #include <QPushButton>  //  QPushButton
+#include <QCheckBox>  //  QCheckBox
+#include <QTableView>  //  QTableView
 #include <QString>  //  QString
 #include <QTimer>  //  QTimer
 #include <QDomElement>  //  QDomElement
+#include <chrono>  //  std::chrono::milliseconds
 #include <memory>  //  std::shared_ptr
 #include <vector>  //  std::vector
 #include <optional>  //  std::optional
@@ -55,6 +63,7 @@
 // project includes
 #include "base_dialog.h"  //  BaseDialog
 #include "metadata_structs.h"  //  RegisterEncoding
+#include "register_table_model.h"  //  RegisterTableModel
 
 
 /**
@@ -98,7 +107,10 @@ public:
     virtual bool load_configuration_parameters(const QDomElement &node);
 
     virtual void set_metadata(std::shared_ptr<Metadata> metadata, const quint8 node) override;
-    virtual void poll_register_set(ModbusThread *const engine) override;
+    virtual quint16 poll_register_set(ModbusConnection *const engine) override;
+    [[nodiscard]] virtual ReadRange get_read_range() const override;
+    [[nodiscard]] virtual quint8 get_endpoint() const noexcept override;
+    [[nodiscard]] virtual std::vector<PollSubscription> get_poll_subscriptions() const override;
 
 protected:
 
@@ -119,6 +131,22 @@ protected:
      */
     virtual QWidget* create_value_widget(const quint16 index, const bool initial);
 
+    /**
+     * \brief Force the next polled value of a register to be redrawn.
+     * \note
+     * Used once the user has changed the displayed value (write requests)
+     * as the value polled may not change.
+     *
+     * @param index index \f(register number = start_reg + index)\f
+     */
+    void invalidate_register(const size_t index);
+
+    /**
+     * \brief Get how register values may be edited in the table view.
+     * @return value column editor
+     */
+    [[nodiscard]] virtual RegisterTableModel::ValueEditor get_value_editor() const;
+
     /**
      * \brief Decode modbus data to a displayable string.
      * @param value raw modbus value
@@ -149,11 +177,15 @@ protected:
     quint16 m_count; /**< Number of registers polled */
     quint16 m_max_regs=0; /**< Maximum number of registers allowed */
     quint8 m_node; /**< Polls directed at this node/device ID */
+    quint8 m_endpoint=0; /**< Polls directed at this endpoint (device connection) */
+    std::chrono::milliseconds m_poll_period{0}; /**< Continuous poll period, 0 = as fast as possible */
     bool m_have_metadata = false; /**< Flag indicating that metadata has been polled */
+    bool m_table_view; /**< Registers shown in the table view rather than widgets */
 
-    std::vector<QLabel*> m_register_labels; /**< List of register number labels */
-    std::vector<QWidget*> m_register_values; /**< List of display values */
-    std::vector<QLabel*> m_register_descriptions; /**< List of descriptions (from metadata) */
+    std::vector<QLabel*> m_register_labels; /**< List of register number labels (widget view) */
+    std::vector<QWidget*> m_register_values; /**< List of display values (widget view) */
+    std::vector<QLabel*> m_register_descriptions; /**< List of descriptions (widget view) */
+    RegisterTableModel *m_model=nullptr; /**< Table view contents (created in setupUi) */
 
     /**
      * \var m_register_encoding
@@ -166,6 +198,7 @@ protected:
     QScrollArea *const m_scroll_area; /**< Main display scroll area */
     QWidget *const m_scroll_container; /**< Scroll area contents */
     QGridLayout *const m_scroll_layout; /**< Scroll area layout control */
+    QTableView *const m_table; /**< Table view of the registers */
     QStatusBar *const m_status; /**< Status notification area */
 
     QGroupBox *const m_control_box; /**< Group of configuration controls at top of scroll area */
@@ -173,6 +206,10 @@ protected:
     QSpinBox *const m_reg_select; /**< First register selection */
     QSpinBox *const m_node_select; /**< Node / device ID selection */
     QSpinBox *const m_quantity; /**< Number of registers selection */
+    QSpinBox *const m_endpoint_select; /**< Endpoint selection */
+    QSpinBox *const m_period_select; /**< Poll period selection */
+    QCheckBox *const m_view_select; /**< Table / widget view selection */
+    QLabel *const m_rate_label; /**< Achieved poll rate (status bar) */
     QPushButton *const m_apply_button; /**< Update window (also default) */
     QPushButton *m_refresh_button; /**< Refresh metadata */
     QPushButton *const m_save_button; /**< Save data to CSV table */
@@ -187,7 +224,9 @@ public slots:
     void on_refresh_clicked();
 
     virtual void on_new_value(const quint16 reg, const quint16 value, const quint8 unit_id) override;
+    virtual void on_register_block(const quint8 endpoint, const RegisterBlock block) override;
     virtual void on_exception_status(BaseDialog *requester, const QString exception) override;
+    virtual void on_poll_statistics(const quint8 endpoint, const PollStatistics statistics) override;
 
 protected slots:
 
@@ -201,6 +240,13 @@ protected slots:
      */
     void on_save_clicked();
 
+    /**
+     * \brief Signal that a value has been edited in the table view.
+     * @param row register index in window
+     * @param value text entered
+     */
+    virtual void on_table_value_edited(const int row, const QString value);
+
 private slots:
 
     /**
@@ -208,15 +254,107 @@ private slots:
      */
     void on_status_timer_timeout();
 
+    /**
+     * \brief Signal on the redraw timer expired, draw the registers changed.
+     */
+    void on_redraw_timer_timeout();
+
 private:
 
+    /**
+     * \brief Display state of a register row
+     */
+    enum RowState : quint8 {
+        ROW_EMPTY,  /**< Value not shown (cleared or edited by the user) */
+        ROW_SHOWN,  /**< Raw value is displayed */
+        ROW_DIRTY  /**< Raw value waiting for the redraw timer */
+    };
+
     /**
      * \brief Save register data to CSV file
      * @param path absolute path and file name to save to
      */
     bool save_register_set(const QString &path);
 
+    /**
+     * \brief Save the raw register values to a capture file
+     * @param path absolute path and file name to save to
+     * @throws AppException if the file cannot be written in full
+     */
+    bool save_register_capture(const QString &path);
+
+    /**
+     * \brief Store and display a polled register value.
+     * @param index index \f(register number = start_reg + index)\f
+     * @param value raw register value
+     */
+    void set_register_value(const size_t index, const quint16 value);
+
+    /**
+     * \brief Store the coils / inputs of a block that changed.
+     * \note
+     * Compared a word (64 coils) at a time, only the changes are stored.
+     *
+     * @param block packed bits read
+     * @param first first register number of the block in this window
+     * @param last register number following the last in this window
+     */
+    void set_bit_values(const RegisterBlock &block, const size_t first, const size_t last);
+
+    /**
+     * \brief Queue a register to be redrawn.
+     * @param index index \f(register number = start_reg + index)\f
+     */
+    void mark_dirty(const size_t index);
+
+    /**
+     * \brief Create / destroy the widget rows of the widget view.
+     * @param rows number of rows required
+     * @param initial Initial call from setupUi
+     */
+    void resize_widget_rows(const size_t rows, const bool initial);
+
+    /**
+     * \brief Rebuild the rows for the current register range and view mode.
+     * \note
+     * Descriptions and encodings are cleared.
+     *
+     * @param initial Initial call from setupUi
+     */
+    void update_rows(const bool initial);
+
+    /**
+     * \brief Show either the table or the widget view.
+     */
+    void set_view_mode();
+
+    /**
+     * \brief Set the description (from metadata) of a register.
+     * @param index index \f(register number = start_reg + index)\f
+     * @param description description text
+     */
+    void set_description(const size_t index, const QString &description);
+
+    /**
+     * \brief Get the description (from metadata) of a register.
+     * @param index index \f(register number = start_reg + index)\f
+     */
+    [[nodiscard]] QString get_description(const size_t index) const;
+
     QTimer *const m_status_timer;
+    QTimer *const m_redraw_timer;
+    std::vector<RowState> m_row_state;
+    std::vector<size_t> m_dirty_rows;
+
+    /**
+     * \var m_bit_state
+     * Coil / input windows: m_raw_values packed 64 per word, valid for every
+     * row not flagged in m_bit_stale.  Empty for register windows.
+     */
+    std::vector<quint64> m_bit_state;
+    std::vector<quint64> m_bit_stale; /**< Rows to store even if unchanged */
+    std::vector<quint64> m_bit_scratch; /**< Reused for each block received */
+    quint64 m_suppressed_redraws = 0U;
     bool m_meta_in_process = false;
 };
 
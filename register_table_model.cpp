@@ -0,0 +1,213 @@
+/**
+ * \file register_table_model.cpp
+ * \brief Table model backing the register window table view
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+/* -none- */
+
+// C includes
+/* -none- */
+
+// project includes
+#include "register_table_model.h"  //  local include
+
+
+RegisterTableModel::RegisterTableModel(QObject *parent, const ValueEditor editor)
+    : QAbstractTableModel(parent),
+      m_editor{editor},
+      m_labels(),
+      m_values(),
+      m_descriptions()
+{
+}
+
+
+void RegisterTableModel::reset(std::vector<QString> &&labels)
+{
+    beginResetModel();
+    m_labels = std::move(labels);
+    m_values.assign(m_labels.size(), QString());
+    m_descriptions.assign(m_labels.size(), QString());
+    endResetModel();
+}
+
+
+void RegisterTableModel::set_value(const int row, const QString &value)
+{
+    auto &cell = m_values[size_t(row)];
+    if (cell != value) {
+        cell = value;
+        const auto cell_index = index(row, COLUMN_VALUE);
+        emit dataChanged(cell_index, cell_index);
+    }
+}
+
+
+void RegisterTableModel::set_description(const int row, const QString &description)
+{
+    auto &cell = m_descriptions[size_t(row)];
+    if (cell != description) {
+        cell = description;
+        const auto cell_index = index(row, COLUMN_DESCRIPTION);
+        emit dataChanged(cell_index, cell_index);
+    }
+}
+
+
+const QString &RegisterTableModel::get_value(const int row) const
+{
+    return m_values[size_t(row)];
+}
+
+
+const QString &RegisterTableModel::get_description(const int row) const
+{
+    return m_descriptions[size_t(row)];
+}
+
+
+RegisterTableModel::ValueEditor RegisterTableModel::get_editor() const noexcept
+{
+    return m_editor;
+}
+
+
+int RegisterTableModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+
+    return int(m_labels.size());
+}
+
+
+int RegisterTableModel::columnCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+
+    return COLUMN_COUNT;
+}
+
+
+QVariant RegisterTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+
+    const auto row = size_t(index.row());
+    const auto is_checkbox = (EDITOR_CHECKBOX == m_editor) && (COLUMN_VALUE == index.column());
+    if (is_checkbox) {
+        if (Qt::CheckStateRole == role) {
+            return (m_values[row] == "1" ? Qt::Checked : Qt::Unchecked);
+        }
+        return QVariant();
+    }
+
+    if (Qt::DisplayRole != role && Qt::EditRole != role) {
+        return QVariant();
+    }
+
+    switch (index.column()) {
+    case COLUMN_REGISTER:
+        return m_labels[row];
+
+    case COLUMN_VALUE:
+        return m_values[row];
+
+    case COLUMN_DESCRIPTION:
+        return m_descriptions[row];
+
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+
+QVariant RegisterTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (Qt::DisplayRole != role || Qt::Horizontal != orientation) {
+        return QVariant();
+    }
+
+    switch (section) {
+    case COLUMN_REGISTER:
+        return tr("Register");
+
+    case COLUMN_VALUE:
+        return tr("Value");
+
+    case COLUMN_DESCRIPTION:
+        return tr("Description");
+
+    default:
+        break;
+    }
+
+    return QVariant();
+}
+
+
+Qt::ItemFlags RegisterTableModel::flags(const QModelIndex &index) const
+{
+    auto item_flags = QAbstractTableModel::flags(index);
+    if (index.isValid() && COLUMN_VALUE == index.column()) {
+        if (EDITOR_TEXT == m_editor) {
+            item_flags |= Qt::ItemIsEditable;
+        } else if (EDITOR_CHECKBOX == m_editor) {
+            item_flags |= Qt::ItemIsUserCheckable;
+        } else {
+
+        }
+    }
+
+    return item_flags;
+}
+
+
+bool RegisterTableModel::setData(const QModelIndex &index, const QVariant &value, int role)
+{
+    if (!index.isValid() || COLUMN_VALUE != index.column() || index.row() >= rowCount()) {
+        return false;
+    }
+
+    QString text;
+    if (EDITOR_TEXT == m_editor && Qt::EditRole == role) {
+        text = value.toString();
+    } else if (EDITOR_CHECKBOX == m_editor && Qt::CheckStateRole == role) {
+        text = (Qt::Checked == value.toInt() ? "1" : "0");
+    } else {
+        return false;
+    }
+
+    //  Shown until the next poll replaces it, as the widgets do.
+    set_value(index.row(), text);
+    emit value_edited(index.row(), text);
+    return true;
+}
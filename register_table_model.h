@@ -0,0 +1,148 @@
+/**
+ * \file register_table_model.h
+ * \brief Table model backing the register window table view
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * Large register windows (up to 125 registers or 2000 coils / inputs) are
+ * shown in a QTableView rather than as three widgets per register.  The model
+ * only stores the text of each cell, the view creates nothing per row and
+ * paints only the visible rows.  Value updates that don't change the text are
+ * dropped and a change only invalidates the cell that changed.
+ */
+
+#ifndef REGISTER_TABLE_MODEL_H
+#define REGISTER_TABLE_MODEL_H
+
+//  c++ includes
+#include <QAbstractTableModel>  //  QAbstractTableModel
+#include <QModelIndex>  //  QModelIndex
+#include <QVariant>  //  QVariant
+#include <QString>  //  QString
+#include <vector>  //  std::vector
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+/**
+ * \brief Register number / value / description table
+ */
+class RegisterTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * \brief Table columns
+     */
+    enum Column : int {
+        COLUMN_REGISTER,
+        COLUMN_VALUE,
+        COLUMN_DESCRIPTION,
+        COLUMN_COUNT
+    };
+
+    /**
+     * \brief How the value column may be edited
+     */
+    enum ValueEditor : int {
+        EDITOR_NONE,  /**< Read only */
+        EDITOR_TEXT,  /**< Line edit, write on return */
+        EDITOR_CHECKBOX  /**< Check box ("1" / "0"), write on toggle */
+    };
+
+    /**
+     * \brief constructor
+     * @param parent parent QObject owner
+     * @param editor value column editor
+     */
+    RegisterTableModel(QObject *parent, const ValueEditor editor);
+
+    /**
+     * \brief Replace every row, values and descriptions are cleared.
+     * @param labels register number text of each row
+     */
+    void reset(std::vector<QString> &&labels);
+
+    /**
+     * \brief Update the value of a row.
+     * @param row row index (register number = start_reg + row)
+     * @param value display text
+     */
+    void set_value(const int row, const QString &value);
+
+    /**
+     * \brief Update the description of a row.
+     * @param row row index (register number = start_reg + row)
+     * @param description description text
+     */
+    void set_description(const int row, const QString &description);
+
+    /**
+     * \brief Get the value displayed in a row.
+     * @param row row index
+     */
+    [[nodiscard]] const QString &get_value(const int row) const;
+
+    /**
+     * \brief Get the description displayed in a row.
+     * @param row row index
+     */
+    [[nodiscard]] const QString &get_description(const int row) const;
+
+    /**
+     * \brief Get the value column editor.
+     */
+    [[nodiscard]] ValueEditor get_editor() const noexcept;
+
+    int rowCount(const QModelIndex &parent=QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent=QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role=Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role=Qt::DisplayRole) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+    bool setData(const QModelIndex &index, const QVariant &value, int role=Qt::EditRole) override;
+
+signals:
+
+    /**
+     * \brief Emit that the user edited a value.
+     * @param row row index (register number = start_reg + row)
+     * @param value text entered ("1" / "0" for check boxes)
+     */
+    void value_edited(const int row, const QString value);
+
+private:
+
+    const ValueEditor m_editor;
+    std::vector<QString> m_labels;
+    std::vector<QString> m_values;
+    std::vector<QString> m_descriptions;
+};
+
+
+#endif // REGISTER_TABLE_MODEL_H
@@ -0,0 +1,86 @@
+/**
+ * \file register_value_delegate.cpp
+ * \brief Value column editor of the register window table view
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <QLineEdit>  //  QLineEdit
+#include <QVariant>  //  QVariant
+
+// C includes
+/* -none- */
+
+// project includes
+#include "register_value_delegate.h"  //  local include
+
+
+namespace {
+    const auto g_accepted_property = "register_accepted";  /**< Set once return is pressed */
+}  //  Anonymous namespace
+
+
+RegisterValueDelegate::RegisterValueDelegate(QObject *parent)
+    : QStyledItemDelegate(parent)
+{
+}
+
+
+QWidget *RegisterValueDelegate::createEditor(QWidget *parent, const QStyleOptionViewItem &option,
+                                             const QModelIndex &index) const
+{
+    static_cast<void>(option);
+    static_cast<void>(index);
+    auto editor = new QLineEdit(parent);
+    auto delegate = const_cast<RegisterValueDelegate*>(this);
+    connect(editor, &QLineEdit::textEdited, editor, [=]() {
+        editor->setStyleSheet("background-color: #FFF0F0;");
+    });
+    connect(editor, &QLineEdit::returnPressed, delegate, [=]() {
+        editor->setProperty(g_accepted_property, true);
+        emit delegate->commitData(editor);
+        emit delegate->closeEditor(editor);
+    });
+    return editor;
+}
+
+
+void RegisterValueDelegate::setEditorData(QWidget *editor, const QModelIndex &index) const
+{
+    //  Called for every poll of the row being edited, keep what the user typed.
+    auto line_edit = static_cast<QLineEdit*>(editor);
+    if (!line_edit->isModified()) {
+        line_edit->setText(index.data(Qt::EditRole).toString());
+    }
+}
+
+
+void RegisterValueDelegate::setModelData(QWidget *editor, QAbstractItemModel *model,
+                                         const QModelIndex &index) const
+{
+    //  Leaving the editor any other way discards the edit.
+    const auto line_edit = static_cast<QLineEdit*>(editor);
+    if (line_edit->property(g_accepted_property).toBool()) {
+        line_edit->setProperty(g_accepted_property, false);
+        model->setData(index, line_edit->text(), Qt::EditRole);
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * \file register_value_delegate.h
+ * \brief Value column editor of the register window table view
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * The table view behaves as the widget grid does: a holding register is only
+ * written when return is pressed in its line edit (which is tinted while being
+ * edited) and polls do not overwrite text that is being typed.  Coils use the
+ * check box painted and toggled by QStyledItemDelegate itself.
+ */
+
+#ifndef REGISTER_VALUE_DELEGATE_H
+#define REGISTER_VALUE_DELEGATE_H
+
+//  c++ includes
+#include <QStyledItemDelegate>  //  QStyledItemDelegate
+#include <QAbstractItemModel>  //  QAbstractItemModel
+#include <QModelIndex>  //  QModelIndex
+#include <QWidget>  //  QWidget
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+/**
+ * \brief Register value editor delegate
+ */
+class RegisterValueDelegate : public QStyledItemDelegate
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * \brief constructor
+     * @param parent parent QObject owner
+     */
+    explicit RegisterValueDelegate(QObject *parent);
+
+    QWidget *createEditor(QWidget *parent, const QStyleOptionViewItem &option,
+                          const QModelIndex &index) const override;
+    void setEditorData(QWidget *editor, const QModelIndex &index) const override;
+    void setModelData(QWidget *editor, QAbstractItemModel *model,
+                      const QModelIndex &index) const override;
+};
+
+
+#endif // REGISTER_VALUE_DELEGATE_H
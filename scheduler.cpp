@@ -24,42 +24,69 @@
  */
 
 //  c++ includes
+#include <algorithm>  //  std::min, std::max, std::min_element
 #include <cassert>  //  assert
+#include <memory>  //  std::make_shared
+#include <utility>  //  std::pair, std::move
 
 // C includes
-#include <modbus/modbus.h>  //  modbus_strerror
+#include <modbus/modbus.h>  //  modbus_strerror, MODBUS_MAX_READ_REGISTERS
 
 // project includes
 #include "scheduler.h"  //  Local include
 #include "metadata_wrapper.h"  //  MetadataWrapper
 
 
-Scheduler::Scheduler(QObject *parent)
+using std::chrono::steady_clock;
+using TimeDiff = std::chrono::duration<double>;
+
+
+namespace {
+    const auto g_report_interval = std::chrono::seconds(1);  /**< poll_statistics rate limit */
+    const auto g_rate_smoothing = 0.2;  /**< Weight of the newest interval in the rate */
+}  //  Anonymous namespace
+
+
+Scheduler::Scheduler(QObject *parent, const quint8 endpoint)
     :QObject(parent),
     m_write_requests(),
     m_meta_requests(),
     m_standard_requests(),
-    m_modbus_timer{new QTimer(this)}
+    m_poll_jobs(),
+    m_endpoint{endpoint},
+    m_index(),
+    m_receivers(),
+    m_release_timer{new QTimer(this)},
+    m_metadata_cache()
 {
-    connect(m_modbus_timer, &QTimer::timeout, this, &Scheduler::modbus_on_timer_expired);
-    m_modbus_timer->setSingleShot(true);
+    m_release_timer->setSingleShot(true);
+    m_release_timer->setTimerType(Qt::PreciseTimer);
+    connect(m_release_timer, &QTimer::timeout, this, &Scheduler::figure_next);
 }
 
 
-void Scheduler::start_modbus(ModbusThread *const engine, const std::chrono::milliseconds timeout)
+void Scheduler::start_modbus(ModbusConnection *const engine, const std::chrono::milliseconds timeout)
 {
     assert(nullptr == m_polling_thread);
     m_polling_thread=engine;
-    m_modbus_timer->setInterval(timeout);
     m_write_requests.clear();
     m_meta_requests.clear();
     m_standard_requests.clear();
+    m_planned_reads.clear();
+    m_in_flight.clear();
+    m_poll_jobs.clear();
     m_current_request=nullptr;
     m_active=false;
-    connect(engine, &ModbusThread::modbus_error, this, &Scheduler::modbus_on_error);
-    connect(engine, &ModbusThread::complete, this, &Scheduler::modbus_on_data);
+    m_devid_requested=false;
+    m_identifying=false;
+    m_pipeline_depth=size_t(engine->pipeline_depth());
+    engine->set_response_timeout(timeout);
+    connect(engine, &ModbusConnection::modbus_error, this, &Scheduler::modbus_on_error);
+    connect(engine, &ModbusConnection::transactions_ready, this, &Scheduler::modbus_on_transactions);
     m_poll_count = 0;
     m_error_count = 0;
+    m_block_count = 0;
+    m_dispatch_count = 0;
     emit new_register_data(0, SystemRegister::SYSTEM_CONNECTED, 255);
 }
 
@@ -67,15 +94,22 @@ void Scheduler::start_modbus(ModbusThread *const engine, const std::chrono::mill
 void Scheduler::stop_modbus()
 {
     if (nullptr != m_polling_thread) {
-        disconnect(m_polling_thread, &ModbusThread::modbus_error, this, &Scheduler::modbus_on_error);
-        disconnect(m_polling_thread, &ModbusThread::complete, this, &Scheduler::modbus_on_data);
+        disconnect(m_polling_thread, &ModbusConnection::modbus_error, this, &Scheduler::modbus_on_error);
+        disconnect(m_polling_thread, &ModbusConnection::transactions_ready, this, &Scheduler::modbus_on_transactions);
         m_current_request=nullptr;
         m_active=false;
+        m_devid_requested=false;
+        m_identifying=false;
+        m_metadata_cache.close();
         m_write_requests.clear();
         m_meta_requests.clear();
+        m_in_flight.clear();
+        m_poll_jobs.clear();
+        m_release_timer->stop();
         m_polling_thread=nullptr;
-        if (m_standard_requests.size() > 0) {
+        if (m_standard_requests.size() > 0 || m_planned_reads.size() > 0) {
             m_standard_requests.clear();
+            m_planned_reads.clear();
             emit polling_complete();  //  TODO: Really?
         }
         emit new_register_data(0, SystemRegister::SYSTEM_DISCONNECTED, 255);
@@ -83,6 +117,12 @@ void Scheduler::stop_modbus()
 }
 
 
+void Scheduler::set_read_gap(const quint16 max_gap)
+{
+    m_read_gap = std::min(max_gap, read_planner::MAX_GAP);
+}
+
+
 void Scheduler::enqueue_request(BaseDialog *const source)
 {
     if (nullptr != m_polling_thread) {
@@ -92,6 +132,78 @@ void Scheduler::enqueue_request(BaseDialog *const source)
 }
 
 
+void Scheduler::set_subscriptions(BaseDialog *const source,
+                                  std::vector<PollSubscription> &&subscriptions)
+{
+    for (auto i=m_poll_jobs.begin(); m_poll_jobs.end() != i;) {
+        if (source == i->second.requester) {
+            i = m_poll_jobs.erase(i);
+        } else {
+            ++i;
+        }
+    }
+
+    if (nullptr != m_polling_thread) {
+        const auto now = steady_clock::now();
+        for (const auto &i: subscriptions) {
+            const auto deadline = (i.period.count() > 0 ? now + i.period : steady_clock::time_point::max());
+            m_poll_jobs[m_next_job++] = {source, i, false, now, deadline, now, now, 0.0, 0U, 0U};
+        }
+        figure_next();
+    }
+}
+
+
+void Scheduler::clear_subscriptions()
+{
+    m_poll_jobs.clear();
+    m_release_timer->stop();
+}
+
+
+void Scheduler::subscribe_registers(BaseDialog *const receiver, const ReadRange &range)
+{
+    m_index.add(receiver, range);
+}
+
+
+void Scheduler::unsubscribe_registers(BaseDialog *const receiver)
+{
+    m_index.remove(receiver);
+}
+
+
+void Scheduler::request_device_id()
+{
+    if (nullptr != m_polling_thread) {
+        m_devid_requested = true;
+        m_identifying = true;
+        figure_next();
+    }
+}
+
+
+void Scheduler::set_metadata_revalidation(const bool revalidate) noexcept
+{
+    m_revalidate_metadata = revalidate;
+}
+
+
+void Scheduler::fill_metadata(BaseDialog *const requester, const ReadRange &range)
+{
+    if ((nullptr == requester) || !m_metadata_cache.is_open()) {
+        return;
+    }
+
+    for (auto i=quint32(range.first_register); i<quint32(range.first_register) + range.count; ++i) {
+        const auto cached = m_metadata_cache.find(range.node, quint16(i));
+        if (nullptr != cached) {
+            requester->set_metadata(cached, range.node);
+        }
+    }
+}
+
+
 void Scheduler::modbus_on_write_request(WriteRequest request)
 {
     if (nullptr != m_polling_thread) {
@@ -115,8 +227,43 @@ void Scheduler::remove_reference(BaseDialog *const screen)
         }
     }
 
+    for (auto &i: m_in_flight) {
+        if (screen == i.second.requester) {
+            i.second.requester = nullptr;
+        }
+        for (auto &j: i.second.subscribers) {
+            if (screen == j.requester) {
+                j.requester = nullptr;
+            }
+        }
+    }
+
+    for (auto i=m_poll_jobs.begin(); m_poll_jobs.end() != i;) {
+        if (screen == i->second.requester) {
+            i = m_poll_jobs.erase(i);
+        } else {
+            ++i;
+        }
+    }
+    m_index.remove(screen);
+
+    auto start_count = m_standard_requests.size() + m_planned_reads.size();
+    decltype(m_planned_reads) planned_list = {};
+    for (auto &i: m_planned_reads) {
+        decltype(i.subscribers) subscribers = {};
+        for (const auto &j: i.subscribers) {
+            if (j.requester != screen) {
+                subscribers.push_back(j);
+            }
+        }
+        if (subscribers.size() > 0) {
+            i.subscribers = std::move(subscribers);
+            planned_list.push_back(std::move(i));
+        }
+    }
+    m_planned_reads = std::move(planned_list);
+
     decltype(m_standard_requests) request_list = {};
-    auto start_count = m_standard_requests.size();
     for (const auto i: m_standard_requests) {
         if (i != screen) {
             request_list.push_back(i);
@@ -128,7 +275,7 @@ void Scheduler::remove_reference(BaseDialog *const screen)
         m_current_request = nullptr;
     }
 
-    if (m_standard_requests.size() == 0 && 0 != start_count) {
+    if (m_standard_requests.size() == 0 && m_planned_reads.size() == 0 && 0 != start_count) {
         emit polling_complete();
     }
 }
@@ -136,82 +283,148 @@ void Scheduler::remove_reference(BaseDialog *const screen)
 
 void Scheduler::modbus_on_error(const int error_code)
 {
-    m_modbus_timer->stop();
+    //  Requests in flight are failed individually by the connection.
     m_error_count++;
     const QString modbus_error{tr(modbus_strerror(error_code))};
-    m_active=false;
-    emit poll_exception(m_current_request, modbus_error);
+    emit poll_exception(nullptr, modbus_error);
+}
+
 
-    if (PollAction::POLLING_METADATA == m_current_action) {
-        m_meta_requests.pop_front();
+void Scheduler::modbus_on_transactions()
+{
+    ModbusResult result;
+    while ((nullptr != m_polling_thread) && m_polling_thread->take_result(result)) {
+        dispatch_result(std::move(result));
     }
 
     figure_next();
 }
 
 
-void Scheduler::modbus_on_data()
+void Scheduler::dispatch_result(ModbusResult &&result)
 {
-    m_modbus_timer->stop();
+    const auto entry = m_in_flight.find(result.transaction_id);
+    if (m_in_flight.end() == entry) {
+        return;
+    }
+
+    const auto request = std::move(entry->second);
+    m_in_flight.erase(entry);
+    m_active = !m_in_flight.empty();
+
+    if (0 != result.error_code) {
+        m_error_count++;
+        if (PollAction::POLLING_METADATA == request.action) {
+            abandon_metadata(request.requester);
+        } else if (PollAction::POLLING_DEVID == request.action) {
+            m_identifying = false;
+        } else {}
+
+        if (PollAction::POLLING_READ == request.action) {
+            complete_jobs(request.subscribers, false);
+
+            //  Every window sharing the read is affected.
+            const QString modbus_error{tr(modbus_strerror(result.error_code))};
+            for (const auto &i: request.subscribers) {
+                if (nullptr != i.requester) {
+                    emit poll_exception(i.requester, modbus_error);
+                }
+            }
+        } else if (PollAction::POLLING_DEVID != request.action) {
+            //  Device ID is optional, don't report it as an error.
+            const QString modbus_error{tr(modbus_strerror(result.error_code))};
+            emit poll_exception(request.requester, modbus_error);
+        } else {
+
+        }
+        return;
+    }
+
     m_poll_count++;
-    m_active=false;
-    if (nullptr == m_polling_thread) {
-        //  Escape if no longer connected (IE Queued callback)
-    } else if (PollAction::POLLING_METADATA == m_current_action) {
-        const auto node = m_polling_thread->get_unit_id();
-        emit new_register_data(0, SystemRegister::POLL_METADATA_COMPLETE, node);
-        poll_response_metadata();
-    } else if (PollAction::POLLING_READ == m_current_action) {
-        const auto register_set = m_polling_thread->modbus_result();
-        const auto node = m_polling_thread->get_unit_id();
-        auto register_number = m_polling_thread->get_start_reg();
-
-        for (const auto i: register_set) {
-            emit new_register_data(register_number, i, node);
-            ++register_number;
+    switch (request.action) {
+    case PollAction::POLLING_METADATA:
+        emit new_register_data(0, SystemRegister::POLL_METADATA_COMPLETE, request.node);
+        poll_response_metadata(request, result);
+        break;
+
+    case PollAction::POLLING_READ: {
+            //  The whole (possibly merged) read is handed out at once to the
+            // windows overlapping it, each picks out its own registers.
+            //  Coils and inputs stay packed all the way to the windows.
+            const auto is_bits = (result.first_register <= 19999);
+            const RegisterBlock block = {
+                result.node,
+                result.first_register,
+                (is_bits ? result.bit_count : quint16(result.regs.size())),
+                (is_bits ? nullptr : std::make_shared<const std::vector<quint16>>(std::move(result.regs))),
+                (is_bits ? std::make_shared<const std::vector<quint64>>(std::move(result.bits)) : nullptr)
+            };
+            m_block_count++;
+            m_index.find(block.node, block.first_register, block.count, m_receivers);
+            for (auto i: m_receivers) {
+                m_dispatch_count++;
+                i->on_register_block(m_endpoint, block);
+            }
+            complete_jobs(request.subscribers, true);
+        } break;
+
+    case PollAction::POLLING_DEVID:
+        m_identifying = false;
+        if (result.bytes.size() > 2U) {
+            //  strip off null terminator and RUN/STOP indicator
+            const auto device_id = QString::fromLatin1(reinterpret_cast<const char*>(result.bytes.data()),
+                                                       int(result.bytes.size()) - 2);
+            m_metadata_cache.open(device_id);
+            emit device_identified(device_id);
         }
-    } else {
-        //  Write request
+        break;
+
+    case PollAction::POLLING_WRITE:
+    case PollAction::POLLING_INACTIVE:
         emit new_register_data(0,
                                SystemRegister::WRITE_REQUEST_COMPLETE,
-                               m_polling_thread->get_unit_id());
+                               request.node);
+        break;
     }
-
-    figure_next();
 }
 
 
-void Scheduler::modbus_on_timer_expired()
+void Scheduler::abandon_metadata(const BaseDialog *const requester)
 {
-    if (m_active) {
-        modbus_on_error(11);  //  Device timeout
+    decltype(m_meta_requests) remaining = {};
+    for (auto &i: m_meta_requests) {
+        if (i.requester != requester) {
+            remaining.push_back(std::move(i));
+        }
     }
+    m_meta_requests = std::move(remaining);
 }
 
 
 void Scheduler::figure_next()
 {
-    if (m_active || (nullptr == m_polling_thread)) {
+    if (nullptr == m_polling_thread) {
         return;
     }
 
-    m_active = true;
-    PollAction next_action = PollAction::POLLING_READ;
-    m_current_request = nullptr;
     bool emit_poll_complete = false;
-    bool loop;
-    do {
-        loop = false;
+    while (m_in_flight.size() < m_pipeline_depth) {
         //  Default: read unless there's nothing to read
-        if (m_standard_requests.size() == 0) {
+        PollAction next_action = PollAction::POLLING_READ;
+        if (!have_reads()) {
             next_action = PollAction::POLLING_INACTIVE;
         }
 
-        //  Low priority: read metadata
-        if (m_meta_requests.size() > 0) {
+        //  Low priority: read metadata (once the device, and so its cache, is known)
+        if ((m_meta_requests.size() > 0) && !m_identifying) {
             next_action = PollAction::POLLING_METADATA;
         }
 
+        //  Once, just after connecting: read device ID
+        if (m_devid_requested) {
+            next_action = PollAction::POLLING_DEVID;
+        }
+
         //  High priority: write
         if (m_write_requests.size() > 0) {
             next_action = PollAction::POLLING_WRITE;
@@ -225,18 +438,15 @@ void Scheduler::figure_next()
         case PollAction::POLLING_METADATA:
             if (!poll_meta_request()) {
                 //  A window is done with polling metadata attempt a read.
-                if (m_standard_requests.size() > 0) {
-                    next_action = PollAction::POLLING_READ;
-                    emit_poll_complete = poll_read_request();
-                } else {
-                    //  Read queue is empty, scan for something else to do.
-                    loop = true;
+                if (have_reads()) {
+                    emit_poll_complete |= poll_read_request();
                 }
+                //  Otherwise the read queue is empty, scan for something else to do.
             }
             break;
 
         case PollAction::POLLING_READ:
-            emit_poll_complete = poll_read_request();
+            emit_poll_complete |= poll_read_request();
             break;
 
         case PollAction::POLLING_DEVID:
@@ -244,14 +454,16 @@ void Scheduler::figure_next()
             break;
 
         case PollAction::POLLING_INACTIVE:
-//            emit_poll_complete = true;
-            m_active = false;
             break;
         }
 
-    } while (loop);
+        if (PollAction::POLLING_INACTIVE == next_action) {
+            break;
+        }
+    }
 
-    m_current_action = next_action;
+    m_active = !m_in_flight.empty();
+    arm_release_timer();
 
     if (emit_poll_complete) {
         //  This function can't be reentrant.
@@ -265,7 +477,10 @@ void Scheduler::poll_write_request()
     auto write = m_write_requests.front();
     m_write_requests.pop_front();
     m_current_request = write.requester;
-    m_polling_thread->modbus_request(write.first_register, std::move(write.values), write.node);
+    const auto transaction_id = m_polling_thread->modbus_request(write.first_register,
+                                                                 std::move(write.values),
+                                                                 write.node);
+    m_in_flight[transaction_id] = {PollAction::POLLING_WRITE, write.requester, write.node, nullptr, {}};
 }
 
 
@@ -273,17 +488,45 @@ bool Scheduler::poll_meta_request()
 {
     auto &cur = m_meta_requests.front();
     auto wrapper = MetadataWrapper::get_instance();
+
+    //  Registers held in the cache need not go on the wire.
+    while (!m_revalidate_metadata && (nullptr != cur.requester) &&
+           (cur.current_register <= cur.last_register)) {
+        const auto cached = m_metadata_cache.find(cur.node, cur.current_register);
+        if (nullptr == cached) {
+            break;
+        }
+
+        if (!cur.cached) {
+            cur.requester->set_metadata(cached, cur.node);
+        }
+        cur.current_register++;
+    }
+
     if (wrapper->loaded() &&
             (cur.current_register <= cur.last_register) &&
             (nullptr != cur.requester)) {
-        cur.request = wrapper->create_request(cur.current_register);
-        const auto pdu = wrapper->encode_request(cur.request);
-        m_polling_thread->modbus_request(pdu.first,
-                                         pdu.second,
-                                         cur.request->function_code,
-                                         cur.node);
+        const auto request = wrapper->has_range_requests() ?
+                    wrapper->create_range_request(cur.current_register, get_metadata_run(cur)) :
+                    wrapper->create_request(cur.current_register);
+        const auto pdu = wrapper->encode_request(request);
+        const auto transaction_id = m_polling_thread->modbus_request(pdu.first,
+                                                                     pdu.second,
+                                                                     request->function_code,
+                                                                     cur.node);
 
         m_current_request = cur.requester;
+        m_in_flight[transaction_id] = {PollAction::POLLING_METADATA, cur.requester, cur.node, request, {}};
+
+        //  Responses are matched by transaction so the sequence may advance
+        // before this register has been answered.
+        const auto next = quint32(cur.current_register) +
+                std::max(quint32(request->register_count), quint32(1U));
+        if (next > cur.last_register) {
+            m_meta_requests.pop_front();
+        } else {
+            cur.current_register = quint16(next);
+        }
         return true;
     }
 
@@ -294,38 +537,250 @@ bool Scheduler::poll_meta_request()
 
 bool Scheduler::poll_read_request()
 {
-    m_current_request = m_standard_requests.front();
-    m_standard_requests.pop_front();
-    m_current_request->poll_register_set(m_polling_thread);
-    return (m_standard_requests.size() == 0);
+    //  One-shot scans go first, periodic polls fill the remaining capacity.
+    if (m_standard_requests.size() == 0 && m_planned_reads.size() == 0) {
+        poll_periodic_request();
+        return false;
+    }
+
+    if (m_planned_reads.size() == 0) {
+        plan_reads();
+    }
+
+    auto read = std::move(m_planned_reads.front());
+    m_planned_reads.pop_front();
+    m_current_request = read.subscribers.front().requester;
+
+    quint16 transaction_id;
+    if (read.range.count > 0) {
+        transaction_id = m_polling_thread->modbus_request(read.range.first_register,
+                                                          read.range.count,
+                                                          read.range.node);
+    } else {
+        transaction_id = m_current_request->poll_register_set(m_polling_thread);
+    }
+    m_in_flight[transaction_id] = {PollAction::POLLING_READ,
+                                   m_current_request,
+                                   read.range.node,
+                                   nullptr,
+                                   std::move(read.subscribers)};
+    return (m_planned_reads.size() == 0 && m_standard_requests.size() == 0);
+}
+
+
+void Scheduler::plan_reads()
+{
+    std::vector<ReadSubscriber> requests;
+    requests.reserve(m_standard_requests.size());
+    for (const auto i: m_standard_requests) {
+        requests.push_back({i, i->get_read_range(), 0U});
+    }
+    m_standard_requests.clear();
+
+    for (auto &i: read_planner::plan(std::move(requests), m_read_gap)) {
+        m_planned_reads.push_back(std::move(i));
+    }
+}
+
+
+void Scheduler::poll_periodic_request()
+{
+    const auto now = steady_clock::now();
+    std::vector<ReadSubscriber> released;
+    for (const auto &i: m_poll_jobs) {
+        if (!i.second.in_flight && i.second.release <= now) {
+            released.push_back({i.second.requester, i.second.subscription.range, i.first});
+        }
+    }
+
+    //  Released jobs are coalesced the same way a scan is, the read serving
+    // the earliest deadline goes first.  Ties (eg: jobs without a period) go
+    // to the job released first.
+    auto reads = read_planner::plan(std::move(released), m_read_gap);
+    const auto get_priority = [this](const PlannedRead &read) {
+        auto priority = std::make_pair(steady_clock::time_point::max(),
+                                       steady_clock::time_point::max());
+        for (const auto &i: read.subscribers) {
+            const auto &job = m_poll_jobs.at(i.job);
+            priority = std::min(priority, std::make_pair(job.deadline, job.release));
+        }
+        return priority;
+    };
+    const auto next = std::min_element(reads.begin(), reads.end(),
+                                       [&](const PlannedRead &a, const PlannedRead &b) {
+        return get_priority(a) < get_priority(b);
+    });
+    if (reads.end() == next) {
+        return;
+    }
+
+    for (const auto &i: next->subscribers) {
+        m_poll_jobs.at(i.job).in_flight = true;
+    }
+
+    m_current_request = next->subscribers.front().requester;
+    quint16 transaction_id;
+    if (next->range.count > 0) {
+        transaction_id = m_polling_thread->modbus_request(next->range.first_register,
+                                                          next->range.count,
+                                                          next->range.node);
+    } else {
+        transaction_id = m_current_request->poll_register_set(m_polling_thread);
+    }
+    m_in_flight[transaction_id] = {PollAction::POLLING_READ,
+                                   m_current_request,
+                                   next->range.node,
+                                   nullptr,
+                                   std::move(next->subscribers)};
+}
+
+
+bool Scheduler::have_reads() const
+{
+    if (m_standard_requests.size() > 0 || m_planned_reads.size() > 0) {
+        return true;
+    }
+
+    const auto now = steady_clock::now();
+    for (const auto &i: m_poll_jobs) {
+        if (!i.second.in_flight && i.second.release <= now) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+void Scheduler::complete_jobs(const std::vector<ReadSubscriber> &subscribers, const bool success)
+{
+    const auto now = steady_clock::now();
+    for (const auto &i: subscribers) {
+        const auto entry = m_poll_jobs.find(i.job);
+        if (m_poll_jobs.end() == entry) {
+            //  One-shot read or the subscription was replaced.
+            continue;
+        }
+
+        auto &job = entry->second;
+        job.in_flight = false;
+        const auto period = job.subscription.period;
+        if (period.count() > 0) {
+            if (!success || now > job.deadline) {
+                job.missed++;
+            }
+
+            //  The next poll is released at the deadline of this one.  Once
+            // behind, restart from now rather than bursting to catch up.
+            job.release = std::max(job.deadline, now);
+            job.deadline = job.release + period;
+        } else {
+            job.release = now;
+        }
+
+        if (success) {
+            const TimeDiff interval = now - job.last_completion;
+            if (job.completed > 1U) {
+                job.interval += g_rate_smoothing * (interval.count() - job.interval);
+            } else if (job.completed > 0U) {
+                job.interval = interval.count();
+            } else {
+
+            }
+            job.completed++;
+            job.last_completion = now;
+        }
+
+        if (now - job.last_report >= g_report_interval) {
+            job.last_report = now;
+            const auto rate = (job.interval > 0.0 ? 1.0 / job.interval : 0.0);
+            emit poll_statistics({job.requester, job.subscription.range, rate, job.completed, job.missed});
+        }
+    }
+}
+
+
+void Scheduler::arm_release_timer()
+{
+    //  While the pipeline is full the next completion re-evaluates instead.
+    auto next_release = steady_clock::time_point::max();
+    if (m_in_flight.size() < m_pipeline_depth) {
+        for (const auto &i: m_poll_jobs) {
+            if (!i.second.in_flight) {
+                next_release = std::min(next_release, i.second.release);
+            }
+        }
+    }
+
+    if (steady_clock::time_point::max() == next_release) {
+        m_release_timer->stop();
+    } else {
+        const auto delay = std::chrono::ceil<std::chrono::milliseconds>(next_release - steady_clock::now());
+        m_release_timer->start(std::max(delay, std::chrono::milliseconds(0)));
+    }
 }
 
 
 void Scheduler::poll_devid_request()
 {
     m_current_request = nullptr;
-    m_polling_thread->modbus_request(0, 0, 0);
+    m_devid_requested = false;
+    const auto transaction_id = m_polling_thread->modbus_request(0, 0, 0);
+    m_in_flight[transaction_id] = {PollAction::POLLING_DEVID, nullptr, 0, nullptr, {}};
 }
 
 
-void Scheduler::poll_response_metadata()
+void Scheduler::poll_response_metadata(const InFlightRequest &request, const ModbusResult &result)
 {
-    auto &cur = m_meta_requests.front();
-    cur.current_register++;
-
-    const auto register_set = m_polling_thread->modbus_result();
-    const auto node = m_polling_thread->get_unit_id();
-    std::vector<quint8> rsp(register_set.size());
+    const auto &rsp = result.bytes;
+    auto wrapper = MetadataWrapper::get_instance();
+    if (request.metadata->register_count > 0U) {
+        poll_response_metadata_range(request, rsp);
+        return;
+    }
 
-    for (auto i=register_set.begin(); register_set.end() != i; ++i) {
-        rsp[size_t(std::distance(register_set.begin(), i))] = quint8(*i);
+    if (wrapper->decode_response(request.metadata, rsp.data(), rsp.size())) {
+        m_metadata_cache.store(request.node, *request.metadata);
     }
+    if (nullptr != request.requester) {
+        request.requester->set_metadata(request.metadata, request.node);
+    }
+}
+
 
+void Scheduler::poll_response_metadata_range(const InFlightRequest &request,
+                                             const std::vector<quint8> &rsp)
+{
     auto wrapper = MetadataWrapper::get_instance();
-    wrapper->decode_response(cur.request, rsp);
-    if (nullptr != cur.requester) {
-        cur.requester->set_metadata(cur.request, node);
+    const auto records = wrapper->decode_range_response(request.metadata, rsp.data(), rsp.size());
+    for (quint32 i=0U; i<request.metadata->register_count; ++i) {
+        auto record = (i < records.size()) ? records[i] : nullptr;
+        if (nullptr != record) {
+            m_metadata_cache.store(request.node, *record);
+        } else {
+            //  Still deliver an (empty) container so the window completes.
+            record = wrapper->create_record(quint16(request.metadata->register_number + i));
+        }
+
+        if (nullptr != request.requester) {
+            request.requester->set_metadata(record, request.node);
+        }
+    }
+}
+
+
+quint16 Scheduler::get_metadata_run(const WindowMetadataRequest &sequence) const
+{
+    //  Stop at the next cached register unless everything is being re-read.
+    auto count = quint16(1U);
+    while ((count < MODBUS_MAX_READ_REGISTERS) &&
+           ((quint32(sequence.current_register) + count) <= sequence.last_register) &&
+           (m_revalidate_metadata ||
+            (nullptr == m_metadata_cache.find(sequence.node, quint16(sequence.current_register + count))))) {
+        ++count;
     }
+
+    return count;
 }
 
 
@@ -335,16 +790,30 @@ QPair<quint64, quint64> Scheduler::get_counts() const
 }
 
 
+QPair<quint64, quint64> Scheduler::get_dispatch_counts() const
+{
+    return {m_block_count, m_dispatch_count};
+}
+
+
 bool Scheduler::get_active(BaseDialog* &requester) const
 {
     requester = m_current_request;
-    return m_active;
+    return (m_active || !m_poll_jobs.empty());
 }
 
 
 void Scheduler::modbus_on_poll_meta(WindowMetadataRequest request_sequence)
 {
     if (nullptr != m_polling_thread) {
+        //  Fill the window from the cache right away, the scan only reads
+        // what is missing (or everything when revalidating).
+        if (m_metadata_cache.is_open()) {
+            const auto count = quint16(request_sequence.last_register - request_sequence.current_register + 1);
+            fill_metadata(request_sequence.requester,
+                          {request_sequence.node, request_sequence.current_register, count});
+            request_sequence.cached = true;
+        }
         m_meta_requests.push_back(request_sequence);
         figure_next();
     }
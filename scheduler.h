@@ -24,10 +24,15 @@
  *
  * \section DESCRIPTION
  *
- * Implement a multi-tier scheduling mechanism.  Although Modbus/TCP allows
- * for queued requests libmodbus doesn't support this feature.  Therefore this
- * works as a single request-response mechanism.  All requests are one-shot and
- * require requests to re-enqueue any periodic polls.  A complete set of thread-
+ * Implement a multi-tier scheduling mechanism.  Modbus/TCP allows for queued
+ * requests but libmodbus doesn't support this feature.  Therefore, by default,
+ * this works as a single request-response mechanism.  When the connection is
+ * pipelined up to ``pipeline_depth`` requests are kept in flight and each
+ * response is routed back by its transaction ID.  Request timeouts are enforced
+ * by the connection itself.  Requests queued with ``enqueue_request`` are
+ * one-shot.  Periodic polls are registered as subscriptions, each with its own
+ * period, and are served earliest deadline first once the one-shot reads have
+ * been sent \sa PollSubscription.  A complete set of thread-
  * safe signals are provided for key events including register data dispatch
  * which is intended for situations where there are multiple consumers of a
  * register data point.  Be aware that the interface is not thread safe, only
@@ -41,8 +46,11 @@
 //  c++ includes
 #include <chrono>  //  std::chrono::milliseconds
 #include <deque>  //  std::deque
+#include <map>  //  std::map
+#include <vector>  //  std::vector
 #include <QObject>  //  QObject
 #include <QPair>  //  QPair
+#include <QTimer>  //  QTimer
 
 // C includes
 /* -none- */
@@ -50,8 +58,13 @@
 // project includes
 #include "write_event.h"  //  WriteRequest
 #include "register_display.h"  //  RegisterDisplay
-#include "modbusthread.h"  //  ModbusThread
+#include "modbus_connection.h"  //  ModbusConnection
 #include "metadata_structs.h"  //  WindowMetadataRequest
+#include "read_planner.h"  //  PlannedRead, ReadSubscriber
+#include "poll_subscription.h"  //  PollSubscription, PollStatistics
+#include "register_block.h"  //  RegisterBlock
+#include "subscription_index.h"  //  SubscriptionIndex
+#include "metadata_cache.h"  //  MetadataCache
 
 
 /**
@@ -79,6 +92,48 @@ enum SystemRegister : quint16 {
 };
 
 
+/**
+ * \brief Context of a request that has been handed to the connection
+ */
+struct InFlightRequest {
+    PollAction action; /**< Type of request */
+
+    BaseDialog *requester; /**< Request source (may be null) */
+
+    quint8 node; /**< Node the request was sent to */
+
+    std::shared_ptr<Metadata> metadata; /**< Container for metadata requests */
+
+    std::vector<ReadSubscriber> subscribers; /**< Windows served by a read */
+};
+
+
+/**
+ * \brief Periodic poll of a subscription
+ */
+struct PollJob {
+    BaseDialog *requester; /**< Subscribing window */
+
+    PollSubscription subscription; /**< Registers and target period */
+
+    bool in_flight; /**< A read serving this job is outstanding */
+
+    std::chrono::steady_clock::time_point release; /**< Next poll may be sent from */
+
+    std::chrono::steady_clock::time_point deadline; /**< Next poll shall complete by */
+
+    std::chrono::steady_clock::time_point last_completion; /**< Last successful poll */
+
+    std::chrono::steady_clock::time_point last_report; /**< Last poll_statistics */
+
+    double interval; /**< Smoothed time between successful polls (seconds) */
+
+    quint64 completed; /**< Successful polls */
+
+    quint64 missed; /**< Failed or late polls */
+};
+
+
 /**
  * \brief Modbus poll scheduler
  */
@@ -91,21 +146,29 @@ public:
     /**
      * \brief constructor
      * @param parent parent QObject owner
+     * @param endpoint endpoint (device connection) index polled
      */
-    Scheduler(QObject *parent);
+    Scheduler(QObject *parent, const quint8 endpoint=0);
 
     /**
      * \brief Initiate modbus with connection
      * @param engine Modbus connection
      * @param timeout poll timeout
      */
-    void start_modbus(ModbusThread *const engine, const std::chrono::milliseconds timeout);
+    void start_modbus(ModbusConnection *const engine, const std::chrono::milliseconds timeout);
 
     /**
      * \brief Immediately release all modbus resources and stop polling.
      */
     void stop_modbus();
 
+    /**
+     * \brief Set how far apart two windows may be and still be read together.
+     * @param max_gap largest number of unused registers read between two
+     *                windows (0 = only merge overlapping / adjacent windows)
+     */
+    void set_read_gap(const quint16 max_gap);
+
     /**
      * \brief Enqueue a register screen to have registers polled.
      * \note
@@ -115,6 +178,35 @@ public:
      */
     void enqueue_request(BaseDialog *const source);
 
+    /**
+     * \brief Replace the periodic polls of a window.
+     * @param source window or object that has poll data requests
+     * @param subscriptions registers to poll and their period (empty to stop)
+     */
+    void set_subscriptions(BaseDialog *const source,
+                           std::vector<PollSubscription> &&subscriptions);
+
+    /**
+     * \brief Stop all periodic polls.
+     */
+    void clear_subscriptions();
+
+    /**
+     * \brief Deliver reads overlapping a block of registers to a window.
+     * \note
+     * Registrations are kept across connections.
+     *
+     * @param receiver window to deliver to \sa BaseDialog::on_register_block
+     * @param range registers displayed
+     */
+    void subscribe_registers(BaseDialog *const receiver, const ReadRange &range);
+
+    /**
+     * \brief Stop delivering reads to a window.
+     * @param receiver window to remove
+     */
+    void unsubscribe_registers(BaseDialog *const receiver);
+
     /**
      * \brief Immediately release all references in all queues to a specified
      *        data object (screen)
@@ -122,12 +214,45 @@ public:
      */
     void remove_reference(BaseDialog *const screen);
 
+    /**
+     * \brief Request the device identification string (Report Slave ID).
+     * \sa device_identified
+     */
+    void request_device_id();
+
+    /**
+     * \brief Set whether registers found in the metadata cache are read again.
+     * \note
+     * Cached metadata is always delivered at once, revalidation only adds
+     * the reads that refresh it.
+     *
+     * @param revalidate ``true`` to read every register requested
+     */
+    void set_metadata_revalidation(const bool revalidate) noexcept;
+
+    /**
+     * \brief Deliver the cached metadata of a range of registers to a window.
+     * \note
+     * Nothing is delivered until the device has been identified.
+     *
+     * @param requester window receiving the metadata
+     * @param range registers displayed
+     */
+    void fill_metadata(BaseDialog *const requester, const ReadRange &range);
+
     /**
      * \brief Get the overall success and error poll counts.
      * @return pair of success and error counts since this connection began
      */
     [[nodiscard]] QPair<quint64, quint64> get_counts() const;
 
+    /**
+     * \brief Get the register block dispatch counts.
+     * @return pair of blocks read and deliveries to windows since this
+     *         connection began
+     */
+    [[nodiscard]] QPair<quint64, quint64> get_dispatch_counts() const;
+
     /**
      * \brief Check to see if the scheduler has an active request.
      * @param requester [out] update with the current request source
@@ -140,7 +265,10 @@ signals:
     /**
      * \brief Emit new reqister data.
      * \note
-     * regnumber 0 has special meaning, see enum above
+     * regnumber 0 has special meaning, see enum above.  Only system registers
+     * are emitted here: polled reads are delivered as a single block to the
+     * windows registered with ``subscribe_registers``
+     * \sa BaseDialog::on_register_block
      *
      * @param regnumber register number (eg: 40001, 2, 10003, 30042)
      * @param value register value
@@ -164,6 +292,18 @@ signals:
      */
     void poll_exception(BaseDialog *const requester, const QString exception);
 
+    /**
+     * \brief Emit when the connected device reports its identification.
+     * @param device_id device identification string
+     */
+    void device_identified(const QString device_id);
+
+    /**
+     * \brief Emit the timing achieved by a periodic poll (about once a second).
+     * @param statistics rate and missed deadlines of the subscription
+     */
+    void poll_statistics(const PollStatistics statistics);
+
 public slots:
 
     /**
@@ -181,20 +321,15 @@ public slots:
 protected slots:
 
     /**
-     * \brief Signal from modbus thread on a poll exception.
+     * \brief Signal from the connection on a connection-level exception.
      * @param error_code modbus exception code
      */
     void modbus_on_error(const int error_code);
 
     /**
-     * \brief Signal from modbus thread on a poll complete.
+     * \brief Signal from the connection that results are ready.
      */
-    void modbus_on_data();
-
-    /**
-     * \brief Signal from timer when a poll request has timed out.
-     */
-    void modbus_on_timer_expired();
+    void modbus_on_transactions();
 
 protected:
 
@@ -216,13 +351,25 @@ protected:
      *  list of pending write requests
      */
     std::deque<BaseDialog*> m_standard_requests;
-    ModbusThread *m_polling_thread=nullptr; /**< Pointer to thread (when connected) */
 
     /**
-     * \var m_current_action
-     *  Current polling state
+     * \var m_planned_reads
+     *  reads remaining in the current scan \sa read_planner::plan
      */
-    PollAction m_current_action=PollAction::POLLING_INACTIVE;
+    std::deque<PlannedRead> m_planned_reads;
+    ModbusConnection *m_polling_thread=nullptr; /**< Pointer to connection (when connected) */
+
+    /**
+     * \var m_in_flight
+     *  Requests sent to the connection awaiting a response, by transaction ID
+     */
+    std::map<quint16, InFlightRequest> m_in_flight;
+
+    /**
+     * \var m_poll_jobs
+     *  Periodic polls by job ID \sa ReadSubscriber::job
+     */
+    std::map<quint64, PollJob> m_poll_jobs;
 
 private:
 
@@ -230,14 +377,68 @@ private:
     void poll_write_request();
     bool poll_meta_request();
     bool poll_read_request();
+    void plan_reads();
+    void poll_periodic_request();
+    [[nodiscard]] bool have_reads() const;
+
+    /**
+     * \brief Reschedule the periodic jobs served by a completed read.
+     * @param subscribers subscribers of the read
+     * @param success ``true`` if the read returned data
+     */
+    void complete_jobs(const std::vector<ReadSubscriber> &subscribers, const bool success);
+
+    /**
+     * \brief Wake up at the next periodic release if the pipeline has room.
+     */
+    void arm_release_timer();
     void poll_devid_request();
-    void poll_response_metadata();
+    void poll_response_metadata(const InFlightRequest &request, const ModbusResult &result);
+
+    /**
+     * \brief Deliver the records of a range (API v2) metadata response.
+     * @param request range request answered
+     * @param rsp response PDU
+     */
+    void poll_response_metadata_range(const InFlightRequest &request,
+                                      const std::vector<quint8> &rsp);
+
+    /**
+     * \brief Get the number of registers to cover with the next range request.
+     * @param sequence metadata sequence being polled
+     * @return registers from ``current_register`` up to the next cached one
+     */
+    [[nodiscard]] quint16 get_metadata_run(const WindowMetadataRequest &sequence) const;
+
+    /**
+     * \brief Route a completed transaction to its requester.
+     * @param result completed transaction
+     */
+    void dispatch_result(ModbusResult &&result);
+
+    /**
+     * \brief Drop any remaining metadata polls for a requester.
+     * @param requester window whose sequence failed
+     */
+    void abandon_metadata(const BaseDialog *const requester);
 
     quint64 m_poll_count=0;
     quint64 m_error_count=0;
-    QTimer *const m_modbus_timer;
+    quint64 m_block_count=0;
+    quint64 m_dispatch_count=0;
+    const quint8 m_endpoint;
+    SubscriptionIndex m_index;
+    std::vector<BaseDialog*> m_receivers; /**< Scratch list used by dispatch */
     bool m_active=false;
+    bool m_devid_requested=false;
+    bool m_identifying=false; /**< Device ID requested, metadata waits for it */
+    bool m_revalidate_metadata=false;
+    size_t m_pipeline_depth=1U;
+    quint16 m_read_gap=0U;
+    quint64 m_next_job=1U;
+    QTimer *const m_release_timer;
     BaseDialog *m_current_request=nullptr;
+    MetadataCache m_metadata_cache; /**< Metadata of the identified device */
 };
 
 #endif // SCHEDULER_H
@@ -0,0 +1,326 @@
+/**
+ * \file segment_store.cpp
+ * \brief Time ordered records in memory-mapped segment files
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <QDir>  //  QDir
+#include <algorithm>  //  std::lower_bound, std::max
+#include <cstring>  //  std::memcpy, std::memcmp
+#include <utility>  //  std::move
+
+// C includes
+/* -none- */
+
+// project includes
+#include "segment_store.h"  //  local include
+#include "exceptions.h"  //  AppException
+
+
+namespace {
+
+    /**
+     * \brief Start of each segment file
+     */
+    struct SegmentHeader {
+        char magic[4]; /**< g_magic */
+        quint16 version; /**< g_version */
+        quint16 record_size; /**< Bytes per record */
+        quint32 count; /**< Records stored */
+        quint32 capacity; /**< Records the segment holds */
+        double first; /**< Oldest timestamp */
+        double last; /**< Newest timestamp */
+    };
+
+    static_assert(sizeof(SegmentHeader) == 32, "Segment header layout");
+
+    const char g_magic[4] = {'Q', 'M', 'T', 'H'};
+    const auto g_version = quint16(1U);
+    const auto g_segment_data_bytes = size_t(1024U * 1024U);  /**< 1 MiB of records */
+    const auto g_max_mapped = 8;  /**< Segments kept mapped per store */
+
+
+    /**
+     * \brief Get the header of a mapped segment.
+     * @param map mapped segment
+     * @return segment header
+     */
+    SegmentHeader *get_header(uchar *const map) noexcept
+    {
+        return reinterpret_cast<SegmentHeader*>(map);
+    }
+
+}  //  Anonymous namespace
+
+
+SegmentStore::SegmentStore(const QString &directory, const QString &name, const size_t record_size) :
+    m_directory(directory),
+    m_name(name),
+    m_record_size{record_size},
+    m_capacity{quint32(g_segment_data_bytes / record_size)},
+    m_segments(),
+    m_size{0U},
+    m_use_count{0U},
+    m_mapped{0},
+    m_next_index{0}
+{
+    if (!QDir().mkpath(m_directory)) {
+        throw AppException(QString("Cannot create history directory %1").arg(m_directory));
+    }
+
+    load_segments();
+}
+
+
+SegmentStore::~SegmentStore()
+{
+    for (auto &i: m_segments) {
+        unmap_segment(i);
+    }
+}
+
+
+void SegmentStore::load_segments()
+{
+    const auto dir = QDir(m_directory);
+    const auto file_size = qint64(sizeof(SegmentHeader) + m_capacity * m_record_size);
+    const auto names = dir.entryList({m_name + "_??????.seg"}, QDir::Files, QDir::Name);
+    for (const auto &i: names) {
+        //  <name>_<index>.seg
+        bool ok;
+        const auto index = i.mid(m_name.size() + 1, 6).toInt(&ok);
+        if (!ok) {
+            continue;
+        }
+        m_next_index = std::max(m_next_index, index + 1);
+
+        QFile file(dir.filePath(i));
+        SegmentHeader header;
+        if (!file.open(QFile::ReadOnly) || (file.size() != file_size) ||
+                (file.read(reinterpret_cast<char*>(&header), sizeof(header)) != qint64(sizeof(header))) ||
+                (0 != std::memcmp(header.magic, g_magic, sizeof(g_magic))) ||
+                (g_version != header.version) || (m_record_size != header.record_size) ||
+                (m_capacity != header.capacity) || (header.count > header.capacity) ||
+                (header.first > header.last)) {
+            continue;
+        }
+
+        //  Skip empty segments and any that would break the time order.
+        if ((header.count > 0U) && (m_segments.empty() || (header.first >= m_segments.back().last))) {
+            m_segments.push_back({dir.filePath(i), header.count, header.first, header.last,
+                                  nullptr, nullptr, false, 0U});
+            m_size += header.count;
+        }
+    }
+}
+
+
+void SegmentStore::start_segment()
+{
+    const auto path = QDir(m_directory).filePath(
+                QString("%1_%2.seg").arg(m_name).arg(m_next_index, 6, 10, QChar('0')));
+    QFile file(path);
+    if (!file.open(QFile::ReadWrite | QFile::Truncate) ||
+            !file.resize(qint64(sizeof(SegmentHeader) + m_capacity * m_record_size))) {
+        throw AppException(QString("Cannot create history segment %1: %2")
+                           .arg(path, file.errorString()));
+    }
+    file.close();
+    ++m_next_index;
+
+    Segment segment{path, 0U, 0.0, 0.0, nullptr, nullptr, false, 0U};
+    map_segment(segment, true);
+
+    auto header = get_header(segment.map);
+    std::memcpy(header->magic, g_magic, sizeof(g_magic));
+    header->version = g_version;
+    header->record_size = quint16(m_record_size);
+    header->capacity = m_capacity;
+    m_segments.push_back(std::move(segment));
+}
+
+
+void SegmentStore::map_segment(Segment &segment, const bool writable)
+{
+    auto file = std::make_unique<QFile>(segment.path);
+    if (!file->open(writable ? QFile::ReadWrite : QFile::ReadOnly)) {
+        throw AppException(QString("Cannot open history segment %1: %2")
+                           .arg(segment.path, file->errorString()));
+    }
+
+    auto map = file->map(0, file->size());
+    if (nullptr == map) {
+        throw AppException(QString("Cannot map history segment %1: %2")
+                           .arg(segment.path, file->errorString()));
+    }
+
+    segment.file = std::move(file);
+    segment.map = map;
+    segment.writable = writable;
+    ++m_mapped;
+}
+
+
+void SegmentStore::unmap_segment(Segment &segment)
+{
+    if (nullptr != segment.map) {
+        segment.file->unmap(segment.map);
+        segment.file.reset();
+        segment.map = nullptr;
+        segment.writable = false;
+        --m_mapped;
+    }
+}
+
+
+void SegmentStore::release_segments()
+{
+    while (m_mapped > g_max_mapped) {
+        Segment *oldest = nullptr;
+        for (auto &i: m_segments) {
+            if ((nullptr != i.map) && ((nullptr == oldest) || (i.last_used < oldest->last_used))) {
+                oldest = &i;
+            }
+        }
+        unmap_segment(*oldest);
+    }
+}
+
+
+double SegmentStore::get_timestamp(const Segment &segment, const quint32 index) const noexcept
+{
+    double timestamp;
+    std::memcpy(&timestamp, segment.map + sizeof(SegmentHeader) + index * m_record_size,
+                sizeof(timestamp));
+    return timestamp;
+}
+
+
+void SegmentStore::append(const void *const record)
+{
+    release_segments();
+    if (m_segments.empty() || (m_segments.back().count >= m_capacity)) {
+        start_segment();
+    }
+
+    auto &segment = m_segments.back();
+    if (!segment.writable) {
+        unmap_segment(segment);
+        map_segment(segment, true);
+    }
+
+    //  The record is written before the count so that a crash never exposes
+    // a record that was not written.
+    auto header = get_header(segment.map);
+    std::memcpy(segment.map + sizeof(SegmentHeader) + segment.count * m_record_size,
+                record, m_record_size);
+    const auto timestamp = get_timestamp(segment, segment.count);
+    if (0U == segment.count) {
+        segment.first = timestamp;
+        header->first = timestamp;
+    }
+    segment.last = timestamp;
+    header->last = timestamp;
+    header->count = ++segment.count;
+    segment.last_used = ++m_use_count;
+    ++m_size;
+}
+
+
+uchar *SegmentStore::get_last()
+{
+    if (m_segments.empty()) {
+        return nullptr;
+    }
+
+    auto &segment = m_segments.back();
+    if (!segment.writable) {
+        unmap_segment(segment);
+        map_segment(segment, true);
+    }
+    segment.last_used = ++m_use_count;
+
+    return segment.map + sizeof(SegmentHeader) + (segment.count - 1U) * m_record_size;
+}
+
+
+std::vector<SegmentStore::Span> SegmentStore::find(const double from, const double to)
+{
+    release_segments();
+
+    std::vector<Span> spans;
+    auto segment = std::lower_bound(m_segments.begin(), m_segments.end(), from,
+                                    [](const Segment &s, const double t) {
+        return s.last < t;
+    });
+    for (; (m_segments.end() != segment) && (segment->first <= to); ++segment) {
+        if (nullptr == segment->map) {
+            map_segment(*segment, false);
+        }
+        segment->last_used = ++m_use_count;
+
+        //  Binary search for the first record >= from and the first > to.
+        quint32 first = 0U;
+        auto count = segment->count;
+        while (count > 0U) {
+            const auto step = count / 2U;
+            if (get_timestamp(*segment, first + step) < from) {
+                first += step + 1U;
+                count -= step + 1U;
+            } else {
+                count = step;
+            }
+        }
+
+        auto last = first;
+        count = segment->count - first;
+        while (count > 0U) {
+            const auto step = count / 2U;
+            if (get_timestamp(*segment, last + step) <= to) {
+                last += step + 1U;
+                count -= step + 1U;
+            } else {
+                count = step;
+            }
+        }
+
+        if (last > first) {
+            spans.push_back({segment->map + sizeof(SegmentHeader) + first * m_record_size,
+                             size_t(last - first)});
+        }
+    }
+
+    return spans;
+}
+
+
+quint64 SegmentStore::size() const noexcept
+{
+    return m_size;
+}
+
+
+double SegmentStore::get_last_timestamp() const noexcept
+{
+    return m_segments.empty() ? 0.0 : m_segments.back().last;
+}
@@ -0,0 +1,191 @@
+/**
+ * \file segment_store.h
+ * \brief Time ordered records in memory-mapped segment files
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * Fixed-size records, each starting with a ``double`` timestamp, are appended
+ * to fixed-size (1 MiB) segment files named ``<name>_<index>.seg``.  The
+ * segment being written and the segments most recently read are
+ * memory-mapped so that records are read (and the newest one updated) in
+ * place.  Only the time range of each segment is kept in memory.  Segments
+ * left by a previous run with the same name are picked up and appended to.
+ */
+
+#ifndef SEGMENT_STORE_H
+#define SEGMENT_STORE_H
+
+//  c++ includes
+#include <QFile>  //  QFile
+#include <QString>  //  QString
+#include <memory>  //  std::unique_ptr
+#include <utility>  //  std::pair
+#include <vector>  //  std::vector
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+/**
+ * \brief Append only record store
+ */
+class SegmentStore
+{
+public:
+
+    /**
+     * \brief Consecutive records mapped from one segment {first, count}
+     */
+    using Span = std::pair<const uchar*, size_t>;
+
+    /**
+     * \brief constructor
+     * @param directory directory holding the segment files (created if
+     *        needed)
+     * @param name segment file name prefix, unique to the store
+     * @param record_size bytes per record, starting with a ``double``
+     *        timestamp
+     * @throws AppException if the directory cannot be created
+     */
+    SegmentStore(const QString &directory, const QString &name, const size_t record_size);
+
+    ~SegmentStore();
+
+    SegmentStore(const SegmentStore&) = delete;
+    SegmentStore& operator=(const SegmentStore&) = delete;
+
+    /**
+     * \brief Append a record
+     * \note
+     * The record timestamp must not be older than the newest record.
+     *
+     * @param record record to copy, ``record_size`` bytes
+     * @throws AppException if a segment cannot be created or mapped
+     */
+    void append(const void *const record);
+
+    /**
+     * \brief Get the newest record to update it in place
+     * \note
+     * Its timestamp must not be changed.  The pointer remains valid until
+     * the next call to ``append`` or ``find``.
+     *
+     * @return newest record, ``nullptr`` if the store is empty
+     * @throws AppException if the segment cannot be mapped
+     */
+    [[nodiscard]] uchar *get_last();
+
+    /**
+     * \brief Find the records in a time range
+     * \note
+     * The spans point into the mapped segments and remain valid until the
+     * next call to ``append`` or ``find``.
+     *
+     * @param from oldest timestamp of interest
+     * @param to newest timestamp of interest
+     * @return records in range, oldest first
+     * @throws AppException if a segment cannot be mapped
+     */
+    [[nodiscard]] std::vector<Span> find(const double from, const double to);
+
+    /**
+     * \brief Get the number of records stored
+     * @return records in all segments
+     */
+    [[nodiscard]] quint64 size() const noexcept;
+
+    /**
+     * \brief Get the timestamp of the newest record
+     * @return newest timestamp, 0 if the store is empty
+     */
+    [[nodiscard]] double get_last_timestamp() const noexcept;
+
+private:
+
+    /**
+     * \brief Segment file
+     */
+    struct Segment {
+        QString path; /**< Segment file */
+        quint32 count; /**< Records stored */
+        double first; /**< Oldest timestamp */
+        double last; /**< Newest timestamp */
+        std::unique_ptr<QFile> file; /**< Open while mapped */
+        uchar *map; /**< Mapped file, ``nullptr`` if not mapped */
+        bool writable; /**< Mapped for appending */
+        quint64 last_used; /**< Access order for unmapping */
+    };
+
+    /**
+     * \brief Load the ranges of the segments left by a previous run.
+     */
+    void load_segments();
+
+    /**
+     * \brief Create and map a new segment to append to.
+     */
+    void start_segment();
+
+    /**
+     * \brief Map a segment
+     * @param segment segment to map
+     * @param writable map for appending
+     */
+    void map_segment(Segment &segment, const bool writable);
+
+    /**
+     * \brief Unmap a segment
+     * @param segment segment to unmap
+     */
+    void unmap_segment(Segment &segment);
+
+    /**
+     * \brief Unmap the least recently used segments over the limit.
+     */
+    void release_segments();
+
+    /**
+     * \brief Get the timestamp of a record in a mapped segment
+     * @param segment mapped segment
+     * @param index record index
+     * @return record timestamp
+     */
+    [[nodiscard]] double get_timestamp(const Segment &segment, const quint32 index) const noexcept;
+
+    const QString m_directory;
+    const QString m_name;
+    const size_t m_record_size;
+    const quint32 m_capacity; /**< Records per segment */
+    std::vector<Segment> m_segments; /**< Oldest first */
+    quint64 m_size; /**< Records in all segments */
+    quint64 m_use_count; /**< Access counter for last_used */
+    int m_mapped; /**< Segments currently mapped */
+    int m_next_index; /**< File index of the next segment */
+};
+
+
+#endif // SEGMENT_STORE_H
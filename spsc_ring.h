@@ -0,0 +1,143 @@
+/**
+ * \file spsc_ring.h
+ * \brief Lock-free single producer, single consumer ring
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * Requests and results are handed between the main (window) thread and a
+ * connection's I/O thread through a pair of these rings: each thread only
+ * ever writes one end, so no lock is needed, only the head / tail indices are
+ * atomic.  The capacity is fixed when the ring is created (rounded up to a
+ * power of 2); a full ring refuses the item rather than growing.
+ */
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+//  c++ includes
+#include <atomic>  //  std::atomic
+#include <cstddef>  //  size_t
+#include <vector>  //  std::vector
+#include <utility>  //  std::move
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+/**
+ * \brief Bounded single producer, single consumer queue
+ */
+template<typename T>
+class SpscRing
+{
+public:
+
+    /**
+     * \brief constructor
+     * @param min_capacity number of items that must fit (rounded up to a
+     *        power of 2)
+     */
+    explicit SpscRing(const size_t min_capacity)
+        : m_slots(round_up(min_capacity)),
+          m_mask{m_slots.size() - 1U}
+    {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing &operator=(const SpscRing&) = delete;
+
+    /**
+     * \brief Append an item (producer thread only).
+     * @param item item, only moved from if there was room
+     * @return ``true`` if queued, ``false`` if the ring is full
+     */
+    [[nodiscard]] bool try_push(T &&item)
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if ((tail - m_head.load(std::memory_order_acquire)) > m_mask) {
+            return false;
+        }
+
+        m_slots[tail & m_mask] = std::move(item);
+        m_tail.store(tail + 1U, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Remove the oldest item (consumer thread only).
+     * @param item [out] updated with the item removed
+     * @return ``true`` if an item was available, ``false`` if empty
+     */
+    [[nodiscard]] bool try_pop(T &item)
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+
+        //  Leave an empty slot behind so that buffers are released now.
+        auto &slot = m_slots[head & m_mask];
+        item = std::move(slot);
+        slot = T{};
+        m_head.store(head + 1U, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * \brief Get the number of items the ring holds.
+     */
+    [[nodiscard]] size_t capacity() const noexcept
+    {
+        return m_slots.size();
+    }
+
+private:
+
+    /**
+     * \brief Round a capacity up to a power of 2.
+     * @param capacity requested capacity
+     * @return power of 2, at least 1
+     */
+    static size_t round_up(const size_t capacity) noexcept
+    {
+        auto rounded = size_t(1U);
+        while (rounded < capacity) {
+            rounded <<= 1U;
+        }
+
+        return rounded;
+    }
+
+    std::vector<T> m_slots;
+    const size_t m_mask;
+
+    //  Written by different threads, keep them on separate cache lines.
+    alignas(64) std::atomic<size_t> m_head{0U};  /**< Next item to pop (consumer) */
+    alignas(64) std::atomic<size_t> m_tail{0U};  /**< Next slot to push (producer) */
+};
+
+
+#endif // SPSC_RING_H
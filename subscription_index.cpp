@@ -0,0 +1,121 @@
+/**
+ * \file subscription_index.cpp
+ * \brief Route register blocks to the windows displaying them
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <algorithm>  //  std::find, std::upper_bound, std::remove_if
+
+// C includes
+/* -none- */
+
+// project includes
+#include "subscription_index.h"  //  local include
+
+
+namespace {
+
+    /**
+     * \brief Get the index key of a register table on a node.
+     * @param node node / device ID
+     * @param reg any register number in the table
+     * @return key
+     */
+    quint32 get_key(const quint8 node, const quint16 reg) noexcept
+    {
+        return (quint32(node) << 16U) | quint32(reg / 10000U);
+    }
+
+}  //  Anonymous namespace
+
+
+void SubscriptionIndex::add(BaseDialog *const receiver, const ReadRange &range)
+{
+    if (0 == range.count) {
+        return;
+    }
+
+    auto &intervals = m_tables[get_key(range.node, range.first_register)];
+    const Interval interval = {range.first_register,
+                               quint32(range.first_register) + quint32(range.count),
+                               receiver};
+
+    //  Keep each table ordered by first register so a lookup may stop early.
+    const auto position = std::upper_bound(intervals.begin(), intervals.end(), interval,
+                                           [](const Interval &a, const Interval &b) {
+        return a.first_register < b.first_register;
+    });
+    intervals.insert(position, interval);
+    ++m_size;
+}
+
+
+void SubscriptionIndex::remove(const BaseDialog *const receiver)
+{
+    for (auto table=m_tables.begin(); m_tables.end() != table;) {
+        auto &intervals = table->second;
+        const auto start = intervals.size();
+        intervals.erase(std::remove_if(intervals.begin(), intervals.end(),
+                                       [=](const Interval &i) { return receiver == i.receiver; }),
+                        intervals.end());
+        m_size -= start - intervals.size();
+
+        if (intervals.size() == 0) {
+            table = m_tables.erase(table);
+        } else {
+            ++table;
+        }
+    }
+}
+
+
+void SubscriptionIndex::find(const quint8 node,
+                             const quint16 first_register,
+                             const size_t count,
+                             std::vector<BaseDialog*> &receivers) const
+{
+    receivers.clear();
+    const auto table = m_tables.find(get_key(node, first_register));
+    if (m_tables.end() == table) {
+        return;
+    }
+
+    const auto end = quint32(first_register) + quint32(count);
+    for (const auto &i: table->second) {
+        if (i.first_register >= end) {
+            break;
+        }
+
+        //  A receiver with several overlapping intervals is reported once.
+        if ((i.end > first_register) &&
+                (receivers.end() == std::find(receivers.begin(), receivers.end(), i.receiver))) {
+            receivers.push_back(i.receiver);
+        }
+    }
+}
+
+
+size_t SubscriptionIndex::size() const noexcept
+{
+    return m_size;
+}
@@ -0,0 +1,111 @@
+/**
+ * \file subscription_index.h
+ * \brief Route register blocks to the windows displaying them
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * Each scheduler keeps an index of the registers displayed by the windows
+ * bound to its endpoint, grouped by node and register table and ordered by
+ * address.  A response is only handed to the windows whose registers overlap
+ * it rather than broadcast to every window.
+ */
+
+#ifndef SUBSCRIPTION_INDEX_H
+#define SUBSCRIPTION_INDEX_H
+
+//  c++ includes
+#include <map>  //  std::map
+#include <vector>  //  std::vector
+#include <QTypeInfo>  //  quint8, quint16, quint32
+
+// C includes
+/* -none- */
+
+// project includes
+#include "read_planner.h"  //  ReadRange
+
+
+/**
+ * \brief Registers displayed by a window
+ */
+struct DisplayedRange {
+    quint8 endpoint; /**< Endpoint (device connection) the registers are read from */
+
+    ReadRange range; /**< Registers displayed */
+};
+
+
+/**
+ * \brief Index of the windows interested in each register
+ */
+class SubscriptionIndex
+{
+public:
+
+    /**
+     * \brief Register interest in a block of registers.
+     * @param receiver window to deliver to
+     * @param range registers displayed (ignored if the count is 0)
+     */
+    void add(BaseDialog *const receiver, const ReadRange &range);
+
+    /**
+     * \brief Drop every interval registered by a window.
+     * @param receiver window to remove
+     */
+    void remove(const BaseDialog *const receiver);
+
+    /**
+     * \brief Find the windows interested in a block of registers.
+     * @param node node / device ID read
+     * @param first_register first register read
+     * @param count number of registers read
+     * @param receivers [out] windows overlapping the block, each listed once
+     */
+    void find(const quint8 node,
+              const quint16 first_register,
+              const size_t count,
+              std::vector<BaseDialog*> &receivers) const;
+
+    /**
+     * \brief Get the number of intervals registered.
+     */
+    [[nodiscard]] size_t size() const noexcept;
+
+private:
+
+    /**
+     * \brief Registers [first_register, end) displayed by a receiver
+     */
+    struct Interval {
+        quint16 first_register;
+        quint32 end;
+        BaseDialog *receiver;
+    };
+
+    std::map<quint32, std::vector<Interval>> m_tables; /**< By node and table */
+    size_t m_size = 0U;
+};
+
+
+#endif // SUBSCRIPTION_INDEX_H
@@ -0,0 +1,117 @@
+/**
+ * \file trend_decimator.cpp
+ * \brief Min/max envelope decimation of trend lines
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <array>  //  std::array
+#include <algorithm>  //  std::sort
+#include <cmath>  //  std::floor
+
+// C includes
+/* -none- */
+
+// project includes
+#include "trend_decimator.h"  //  local include
+
+
+TrendDecimator::TrendDecimator() noexcept
+    : m_width{0.0},
+      m_bucket{0},
+      m_open{false},
+      m_first(),
+      m_min(),
+      m_max(),
+      m_last()
+{
+}
+
+
+void TrendDecimator::reset(const double bucket_width) noexcept
+{
+    m_width = bucket_width;
+    m_open = false;
+}
+
+
+void TrendDecimator::add(QCPGraphDataContainer &points, const double key, const double value)
+{
+    const auto sample = QCPGraphData(key, value);
+    if (m_width <= 0.0) {
+        points.add(sample);
+        return;
+    }
+
+    const auto bucket = qint64(std::floor(key / m_width));
+    if (m_open && bucket == m_bucket) {
+        //  Take the open bucket back out, it is appended again below.
+        if (m_first.key < m_last.key) {
+            points.remove(m_first.key, m_last.key);
+        } else {
+            points.remove(m_first.key);
+        }
+
+        if (value < m_min.value) {
+            m_min = sample;
+        } else if (value > m_max.value) {
+            m_max = sample;
+        } else {
+
+        }
+        m_last = sample;
+    } else {
+        m_bucket = bucket;
+        m_open = true;
+        m_first = sample;
+        m_min = sample;
+        m_max = sample;
+        m_last = sample;
+    }
+
+    append_bucket(points);
+}
+
+
+double TrendDecimator::get_bucket_width() const noexcept
+{
+    return m_width;
+}
+
+
+void TrendDecimator::append_bucket(QCPGraphDataContainer &points) const
+{
+    std::array<QCPGraphData, 4U> bucket{{m_first, m_min, m_max, m_last}};
+    std::sort(bucket.begin() + 1, bucket.end() - 1, [](const QCPGraphData &a, const QCPGraphData &b) {
+        return a.key < b.key;
+    });
+
+    //  Samples are in time order, skip any that are the same sample.
+    auto previous = bucket[0].key;
+    points.add(bucket[0]);
+    for (auto i=bucket.begin() + 1; bucket.end() != i; ++i) {
+        if (i->key > previous) {
+            points.add(*i);
+            previous = i->key;
+        }
+    }
+}
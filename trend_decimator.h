@@ -0,0 +1,101 @@
+/**
+ * \file trend_decimator.h
+ * \brief Min/max envelope decimation of trend lines
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * \section DESCRIPTION
+ *
+ * The plot is only a few hundred pixels wide so a trend line with a long
+ * history is reduced before being handed to QCustomPlot: the time axis is cut
+ * into buckets about a pixel wide and each bucket is drawn with at most 4
+ * points, the first, minimum, maximum and last value, which keeps the shape
+ * of the envelope.  Samples are added one at a time, the points of the bucket
+ * being filled (the last one in the graph) are replaced as samples arrive so
+ * the line is always drawn up to the latest value.  The full resolution data
+ * is kept by the TrendLine for export.
+ */
+
+#ifndef TREND_DECIMATOR_H
+#define TREND_DECIMATOR_H
+
+//  c++ includes
+#include <QtGlobal>  //  qint64
+#include <qcustomplot.h>  //  QCPGraphDataContainer
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+/**
+ * \brief Incremental min/max envelope of one trend line
+ */
+class TrendDecimator
+{
+public:
+
+    /**
+     * \brief constructor
+     */
+    TrendDecimator() noexcept;
+
+    /**
+     * \brief Start again with a new bucket width (graph data must be cleared).
+     * @param bucket_width width of a bucket in seconds, <= 0 to keep every sample
+     */
+    void reset(const double bucket_width) noexcept;
+
+    /**
+     * \brief Add a sample to the graph data.
+     * @param points graph data container
+     * @param key sample time, must not be less than the previous sample
+     * @param value sample value
+     */
+    void add(QCPGraphDataContainer &points, const double key, const double value);
+
+    /**
+     * \brief Get the bucket width in use.
+     * @return bucket width in seconds, <= 0 if not decimating
+     */
+    [[nodiscard]] double get_bucket_width() const noexcept;
+
+private:
+
+    /**
+     * \brief Append the points of the open bucket to the graph data.
+     * @param points graph data container
+     */
+    void append_bucket(QCPGraphDataContainer &points) const;
+
+    double m_width; /**< Bucket width (s), <= 0 = no decimation */
+    qint64 m_bucket; /**< Index of the open bucket */
+    bool m_open; /**< A bucket has been started */
+    QCPGraphData m_first; /**< First sample of the open bucket */
+    QCPGraphData m_min; /**< Minimum of the open bucket */
+    QCPGraphData m_max; /**< Maximum of the open bucket */
+    QCPGraphData m_last; /**< Last sample of the open bucket */
+};
+
+
+#endif // TREND_DECIMATOR_H
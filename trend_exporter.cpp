@@ -0,0 +1,260 @@
+/**
+ * \file trend_exporter.cpp
+ * \brief Write the trend data to CSV on a worker thread
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <QByteArray>  //  QByteArray
+#include <QFile>  //  QFile
+#include <cmath>  //  std::llround
+#include <utility>  //  std::move
+
+// C includes
+/* -none- */
+
+// project includes
+#include "trend_exporter.h"  //  local include
+#include "capture_file.h"  //  capture_file::write
+#include "exceptions.h"  //  AppException
+
+
+namespace {
+    const auto g_buffer_size = 64 * 1024;  /**< Bytes buffered before each write */
+    const auto g_time_decimals = 3;  /**< Timestamps are written to the ms */
+
+
+    /**
+     * \brief Scale a raw value for display.
+     * @param line line the value belongs to
+     * @param value raw register value
+     * @return scaled value
+     */
+    QByteArray format_value(const TrendExportLine &line, const quint16 value)
+    {
+        auto v = line.is_signed ? double(static_cast<qint16>(value)) : double(value);
+        v *= line.mult;
+        v += line.offset;
+        return QByteArray::number(v);
+    }
+
+}  //  Anonymous namespace
+
+
+TrendExporter::TrendExporter(QObject *parent,
+                             const QString &path,
+                             const Layout layout,
+                             const double epoch,
+                             std::vector<TrendExportLine> &&lines) :
+    QObject(parent),
+    m_thread{QThread::create([this]() { run(); })},
+    m_path(path),
+    m_layout{layout},
+    m_epoch{epoch},
+    m_lines(std::move(lines)),
+    m_total{0U},
+    m_percent{-1}
+{
+    m_thread->setParent(this);
+    for (const auto &i: m_lines) {
+        m_total += i.values.size();
+    }
+
+    if (LAYOUT_WIDE == m_layout) {
+        m_total *= 2U;
+    }
+}
+
+
+TrendExporter::~TrendExporter()
+{
+    cancel();
+    m_thread->wait();
+}
+
+
+void TrendExporter::start()
+{
+    m_thread->start();
+}
+
+
+void TrendExporter::cancel() noexcept
+{
+    m_cancel = true;
+}
+
+
+void TrendExporter::run()
+{
+    if (LAYOUT_CAPTURE == m_layout) {
+        try {
+            if (write_capture()) {
+                emit finished(true, QString());
+            } else {
+                emit finished(false, m_cancel ? QString() : tr("Write failed"));
+            }
+        } catch (const AppException &e) {
+            emit finished(false, QString(e));
+        }
+        return;
+    }
+
+    QFile file(m_path);
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) {
+        emit finished(false, file.errorString());
+        return;
+    }
+
+    QByteArray buffer;
+    buffer.reserve(g_buffer_size + 1024);
+    const auto status = (LAYOUT_LONG == m_layout) ? write_long(file, buffer) :
+                                                    write_wide(file, buffer);
+    file.close();
+    if (status) {
+        emit finished(true, QString());
+    } else if (m_cancel) {
+        file.remove();
+        emit finished(false, QString());
+    } else {
+        emit finished(false, file.errorString());
+    }
+}
+
+
+bool TrendExporter::flush(QFile &file, QByteArray &buffer, const quint64 done, const bool force)
+{
+    if (m_cancel) {
+        return false;
+    }
+
+    if ((buffer.size() < g_buffer_size) && !force) {
+        return true;
+    }
+
+    if (file.write(buffer) != qint64(buffer.size())) {
+        return false;
+    }
+    buffer.clear();
+
+    const auto percent = (m_total > 0U) ? int((done * 100U) / m_total) : 100;
+    if (percent != m_percent) {
+        m_percent = percent;
+        emit progress(percent);
+    }
+
+    return true;
+}
+
+
+bool TrendExporter::write_wide(QFile &file, QByteArray &buffer)
+{
+    buffer.append(tr("Register number,Device ID/Node,Endpoint,Line Color,Series\n").toUtf8());
+
+    quint64 done = 0U;
+    for (const auto &line: m_lines) {
+        QByteArray prefix;
+        prefix.append(QByteArray::number(line.reg)).append(',');
+        prefix.append(QByteArray::number(line.node)).append(',');
+        prefix.append(QByteArray::number(line.endpoint)).append(',');
+        prefix.append(line.color.toUtf8()).append(',');
+
+        buffer.append(prefix).append(tr("time").toUtf8());
+        for (const auto i: line.timestamps) {
+            buffer.append(',').append(QByteArray::number(i, 'f', g_time_decimals));
+            if (!flush(file, buffer, ++done)) {
+                return false;
+            }
+        }
+        buffer.append('\n');
+
+        buffer.append(prefix).append(tr("value").toUtf8());
+        for (const auto i: line.values) {
+            buffer.append(',').append(format_value(line, i));
+            if (!flush(file, buffer, ++done)) {
+                return false;
+            }
+        }
+        buffer.append('\n');
+    }
+
+    return flush(file, buffer, done, true);
+}
+
+
+bool TrendExporter::write_long(QFile &file, QByteArray &buffer)
+{
+    buffer.append(tr("Time,Register number,Device ID/Node,Endpoint,Value\n").toUtf8());
+
+    //  Each line is in time order: merge them by always taking the line with
+    // the oldest sample not yet written.
+    std::vector<size_t> next(m_lines.size(), 0U);
+    quint64 done = 0U;
+    while (done < m_total) {
+        size_t oldest = m_lines.size();
+        for (size_t i=0; i<m_lines.size(); ++i) {
+            if ((next[i] < m_lines[i].timestamps.size()) &&
+                    ((oldest == m_lines.size()) ||
+                     (m_lines[i].timestamps[next[i]] < m_lines[oldest].timestamps[next[oldest]]))) {
+                oldest = i;
+            }
+        }
+
+        const auto &line = m_lines[oldest];
+        const auto index = next[oldest]++;
+        buffer.append(QByteArray::number(line.timestamps[index], 'f', g_time_decimals)).append(',');
+        buffer.append(QByteArray::number(line.reg)).append(',');
+        buffer.append(QByteArray::number(line.node)).append(',');
+        buffer.append(QByteArray::number(line.endpoint)).append(',');
+        buffer.append(format_value(line, line.values[index])).append('\n');
+        if (!flush(file, buffer, ++done)) {
+            return false;
+        }
+    }
+
+    return flush(file, buffer, done, true);
+}
+
+
+bool TrendExporter::write_capture()
+{
+    std::vector<CaptureSeries> series;
+    series.reserve(m_lines.size());
+    for (const auto &line: m_lines) {
+        if (m_cancel) {
+            return false;
+        }
+
+        CaptureSeries s{line.reg, 1U, line.node, line.endpoint, line.is_signed,
+                        line.mult, line.offset, 0U, {}, line.values};
+        s.timestamps.reserve(line.timestamps.size());
+        for (const auto i: line.timestamps) {
+            s.timestamps.push_back(std::llround((i + m_epoch) * 1000.0));
+        }
+        series.push_back(std::move(s));
+    }
+
+    const auto status = capture_file::write(m_path, series);
+    emit progress(100);
+
+    return status;
+}
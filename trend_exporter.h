@@ -0,0 +1,203 @@
+/**
+ * \file trend_exporter.h
+ * \brief Write the trend data to CSV on a worker thread
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * The trend history may hold millions of samples.  Rather than building the
+ * whole file in memory and writing it from the GUI thread, the trend hands a
+ * copy of the samples to the exporter which formats and writes the rows on
+ * its own thread through a small, fixed-size buffer, reporting its progress
+ * as it goes.
+ *
+ * Three layouts are available:
+ * - wide: for each line a row of sample times followed by a row of values.
+ * - long: one row per sample (time, register, node, endpoint, value) in time
+ *   order, which suits very large exports and most analysis tools.
+ * - capture: the compact binary format (\sa capture_file), raw values.
+ */
+
+#ifndef TREND_EXPORTER_H
+#define TREND_EXPORTER_H
+
+//  c++ includes
+#include <QObject>  //  QObject
+#include <QString>  //  QString
+#include <QThread>  //  QThread
+#include <atomic>  //  std::atomic
+#include <vector>  //  std::vector
+
+// C includes
+/* -none- */
+
+// project includes
+/* -none- */
+
+
+// /////////////////////////////////////////////////////////////////////////////
+// Forward declarations
+// /////////////////////////////////////////////////////////////////////////////
+class QFile;
+class QByteArray;
+
+
+/**
+ * \brief Samples of one trend line to export
+ */
+struct TrendExportLine {
+    quint16 reg; /**< Register number */
+
+    quint8 node; /**< Node / device ID */
+
+    quint8 endpoint; /**< Endpoint */
+
+    QString color; /**< Line color name */
+
+    bool is_signed; /**< Interpret the raw values as signed */
+
+    double mult; /**< Multiply value by m */
+
+    double offset; /**< Add b to value after multiplication */
+
+    std::vector<double> timestamps; /**< Sample times (s, trend time), oldest first */
+
+    std::vector<quint16> values; /**< Raw sample values */
+};
+
+
+/**
+ * \brief CSV export running on its own thread
+ */
+class TrendExporter : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    /**
+     * \brief File layout
+     */
+    enum Layout {
+        LAYOUT_WIDE,  /**< Row of times and row of values per line */
+        LAYOUT_LONG,  /**< One row per sample */
+        LAYOUT_CAPTURE  /**< Binary capture file */
+    };
+
+    /**
+     * \brief constructor
+     * @param parent parent QObject owner
+     * @param path file to write
+     * @param layout file layout
+     * @param epoch Unix time of trend time 0 (s)
+     * @param lines samples to write
+     */
+    TrendExporter(QObject *parent,
+                  const QString &path,
+                  const Layout layout,
+                  const double epoch,
+                  std::vector<TrendExportLine> &&lines);
+
+    /**
+     * \brief Start writing the file.
+     */
+    void start();
+
+    /**
+     * \brief Stop writing as soon as possible (``finished`` is still emitted).
+     */
+    void cancel() noexcept;
+
+    /**
+     * \brief destructor
+     * \note
+     * Cancels and waits for the export thread.
+     */
+    ~TrendExporter() override;
+
+signals:
+
+    /**
+     * \brief Part of the file written
+     * @param percent 0-100
+     */
+    void progress(const int percent);
+
+    /**
+     * \brief Export complete
+     * @param success ``true`` if the whole file was written
+     * @param error reason for failure, empty if cancelled
+     */
+    void finished(const bool success, const QString error);
+
+private:
+
+    /**
+     * \brief Thread main.
+     */
+    void run();
+
+    /**
+     * \brief Write the wide layout.
+     * @param file open output file
+     * @param buffer output buffer
+     * @return ``false`` on error or cancel
+     */
+    bool write_wide(QFile &file, QByteArray &buffer);
+
+    /**
+     * \brief Write the long layout.
+     * @param file open output file
+     * @param buffer output buffer
+     * @return ``false`` on error or cancel
+     */
+    bool write_long(QFile &file, QByteArray &buffer);
+
+    /**
+     * \brief Write the capture layout.
+     * @return ``false`` on error or cancel
+     */
+    bool write_capture();
+
+    /**
+     * \brief Write the buffer once full and report progress.
+     * @param file open output file
+     * @param buffer output buffer, emptied when written
+     * @param done samples written so far
+     * @param force write however full the buffer is
+     * @return ``false`` on error or cancel
+     */
+    bool flush(QFile &file, QByteArray &buffer, const quint64 done, const bool force=false);
+
+    QThread *const m_thread;
+    std::atomic<bool> m_cancel{false};
+    const QString m_path;
+    const Layout m_layout;
+    const double m_epoch;
+    const std::vector<TrendExportLine> m_lines;
+    quint64 m_total; /**< Samples to write (both rows for the wide layout) */
+    int m_percent; /**< Last progress reported */
+};
+
+
+#endif // TREND_EXPORTER_H
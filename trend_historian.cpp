@@ -0,0 +1,181 @@
+/**
+ * \file trend_historian.cpp
+ * \brief Disk-backed trend history in memory-mapped segment files
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <algorithm>  //  std::min, std::max
+#include <cmath>  //  std::floor
+#include <limits>  //  std::numeric_limits
+
+// C includes
+/* -none- */
+
+// project includes
+#include "trend_historian.h"  //  local include
+
+
+namespace {
+
+    static_assert(sizeof(HistorySample) == 16, "History sample layout");
+    static_assert(sizeof(HistoryRollup) == 32, "History rollup layout");
+
+    const double g_rollup_widths[] = {1.0, 10.0, 60.0, 600.0};  /**< Bucket widths (s) */
+
+
+    /**
+     * \brief Add a sample to a rollup bucket.
+     * @param bucket bucket to update
+     * @param value raw register value
+     */
+    void add_to_rollup(HistoryRollup &bucket, const quint16 value) noexcept
+    {
+        const auto v = static_cast<qint16>(value);
+        if (0U == bucket.count) {
+            bucket.signed_min = v;
+            bucket.signed_max = v;
+            bucket.unsigned_min = value;
+            bucket.unsigned_max = value;
+        } else {
+            bucket.signed_min = std::min(bucket.signed_min, v);
+            bucket.signed_max = std::max(bucket.signed_max, v);
+            bucket.unsigned_min = std::min(bucket.unsigned_min, value);
+            bucket.unsigned_max = std::max(bucket.unsigned_max, value);
+        }
+
+        bucket.sum += double(v);
+        ++bucket.count;
+        if (v < 0) {
+            ++bucket.negative;
+        }
+    }
+
+}  //  Anonymous namespace
+
+
+TrendHistorian::TrendHistorian(const QString &directory, const QString &name) :
+    m_samples(directory, name, sizeof(HistorySample)),
+    m_levels(),
+    m_all_levels()
+{
+    std::vector<RollupLevel*> missing;
+    for (const auto width: g_rollup_widths) {
+        const auto level_name = QString("%1_%2s").arg(name).arg(int(width));
+        m_levels.push_back({width, std::make_unique<SegmentStore>(directory, level_name,
+                                                                  sizeof(HistoryRollup))});
+    }
+
+    m_all_levels.reserve(m_levels.size());
+    for (auto &i: m_levels) {
+        m_all_levels.push_back(&i);
+        if ((0U == i.buckets->size()) && (m_samples.size() > 0U)) {
+            missing.push_back(&i);
+        }
+    }
+
+    //  A history recorded without (or with lost) rollups: rebuild them once.
+    if (!missing.empty()) {
+        const auto spans = find(std::numeric_limits<double>::lowest(),
+                                std::numeric_limits<double>::max());
+        for (const auto &i: spans) {
+            for (auto sample=i.samples; sample<(i.samples + i.count); ++sample) {
+                add_to_levels(missing, sample->timestamp, sample->value);
+            }
+        }
+    }
+}
+
+
+void TrendHistorian::add_to_levels(const std::vector<RollupLevel*> &levels,
+                                   const double timestamp,
+                                   const quint16 value)
+{
+    for (auto level: levels) {
+        const auto start = std::floor(timestamp / level->width) * level->width;
+        auto last = reinterpret_cast<HistoryRollup*>(level->buckets->get_last());
+        if ((nullptr != last) && (last->timestamp == start)) {
+            add_to_rollup(*last, value);
+        } else {
+            HistoryRollup bucket{start, 0.0, 0U, 0U, 0, 0, 0U, 0U};
+            add_to_rollup(bucket, value);
+            level->buckets->append(&bucket);
+        }
+    }
+}
+
+
+void TrendHistorian::append(const double timestamp, const quint16 value)
+{
+    const auto t = std::max(timestamp, m_samples.get_last_timestamp());
+    const HistorySample sample{t, value, {0U, 0U, 0U}};
+    m_samples.append(&sample);
+    add_to_levels(m_all_levels, t, value);
+}
+
+
+std::vector<HistorySpan> TrendHistorian::find(const double from, const double to)
+{
+    std::vector<HistorySpan> spans;
+    for (const auto &i: m_samples.find(from, to)) {
+        spans.push_back({reinterpret_cast<const HistorySample*>(i.first), i.second});
+    }
+
+    return spans;
+}
+
+
+double TrendHistorian::get_rollup_width(const double resolution) const noexcept
+{
+    auto width = 0.0;
+    for (const auto &i: m_levels) {
+        if (i.width <= resolution) {
+            width = i.width;
+        }
+    }
+
+    return width;
+}
+
+
+std::vector<RollupSpan> TrendHistorian::find_rollups(const double width,
+                                                     const double from,
+                                                     const double to)
+{
+    std::vector<RollupSpan> spans;
+    for (auto &level: m_levels) {
+        if (level.width == width) {
+            //  Include the bucket that started before, but overlaps, from.
+            for (const auto &i: level.buckets->find(from - width, to)) {
+                spans.push_back({reinterpret_cast<const HistoryRollup*>(i.first), i.second});
+            }
+        }
+    }
+
+    return spans;
+}
+
+
+quint64 TrendHistorian::size() const noexcept
+{
+    return m_samples.size();
+}
@@ -0,0 +1,210 @@
+/**
+ * \file trend_historian.h
+ * \brief Disk-backed trend history in memory-mapped segment files
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * Each trend line may record every sample it receives to disk.  Samples
+ * (timestamp, raw register value) are appended to segment files
+ * (\sa SegmentStore) in the history directory, which the trend reads in place
+ * when it is scrolled or zoomed.  Alongside the samples the historian keeps
+ * rollup levels of 1 s, 10 s, 1 min and 10 min buckets (min / max / sum /
+ * count), updated as each sample is appended, so that a zoomed out trend is
+ * drawn from a few thousand buckets rather than from every sample.
+ */
+
+#ifndef TREND_HISTORIAN_H
+#define TREND_HISTORIAN_H
+
+//  c++ includes
+#include <QString>  //  QString
+#include <memory>  //  std::unique_ptr
+#include <vector>  //  std::vector
+
+// C includes
+/* -none- */
+
+// project includes
+#include "segment_store.h"  //  SegmentStore
+
+
+/**
+ * \brief Sample as stored in a segment file
+ */
+struct HistorySample {
+    double timestamp; /**< Seconds since the Unix epoch */
+
+    quint16 value; /**< Raw register value */
+
+    quint16 reserved[3]; /**< Pads the sample to 16 bytes */
+};
+
+
+/**
+ * \brief Summary of the samples in one rollup bucket
+ * \note
+ * The register may be interpreted as signed or unsigned by the trend, so the
+ * extremes of both interpretations are kept.  The unsigned sum is
+ * ``sum + 65536 * negative``.
+ */
+struct HistoryRollup {
+    double timestamp; /**< Start of the bucket (s since the Unix epoch) */
+
+    double sum; /**< Sum of the values interpreted as signed */
+
+    quint32 count; /**< Number of samples */
+
+    quint32 negative; /**< Samples negative when interpreted as signed */
+
+    qint16 signed_min; /**< Smallest value interpreted as signed */
+
+    qint16 signed_max; /**< Largest value interpreted as signed */
+
+    quint16 unsigned_min; /**< Smallest value interpreted as unsigned */
+
+    quint16 unsigned_max; /**< Largest value interpreted as unsigned */
+};
+
+
+/**
+ * \brief Consecutive samples mapped from one segment
+ */
+struct HistorySpan {
+    const HistorySample *samples; /**< First sample, oldest first */
+
+    size_t count; /**< Number of samples */
+};
+
+
+/**
+ * \brief Consecutive rollup buckets mapped from one segment
+ */
+struct RollupSpan {
+    const HistoryRollup *rollups; /**< First bucket, oldest first */
+
+    size_t count; /**< Number of buckets */
+};
+
+
+/**
+ * \brief Sample store for one trend line
+ */
+class TrendHistorian
+{
+public:
+
+    /**
+     * \brief constructor
+     * \note
+     * Rollup levels missing from an existing history are rebuilt from the
+     * samples.
+     *
+     * @param directory directory holding the segment files (created if
+     *        needed)
+     * @param name segment file name prefix, unique to the line
+     * @throws AppException if the history cannot be opened
+     */
+    TrendHistorian(const QString &directory, const QString &name);
+
+    /**
+     * \brief Append a sample
+     * \note
+     * Timestamps going backwards (clock adjustment) are recorded as the last
+     * timestamp so that the history remains ordered.
+     *
+     * @param timestamp seconds since the Unix epoch
+     * @param value raw register value
+     * @throws AppException if a segment cannot be created or mapped
+     */
+    void append(const double timestamp, const quint16 value);
+
+    /**
+     * \brief Find the samples in a time range
+     * \note
+     * The spans point into the mapped segments and remain valid until the
+     * next call to ``find`` or ``append``.
+     *
+     * @param from oldest time of interest (s since the Unix epoch)
+     * @param to newest time of interest (s since the Unix epoch)
+     * @return samples in range, oldest first
+     * @throws AppException if a segment cannot be mapped
+     */
+    [[nodiscard]] std::vector<HistorySpan> find(const double from, const double to);
+
+    /**
+     * \brief Get the coarsest rollup level that still resolves a time span
+     * @param resolution time spanned by 1 pixel (s)
+     * @return bucket width of the level (s), 0 if the samples must be used
+     */
+    [[nodiscard]] double get_rollup_width(const double resolution) const noexcept;
+
+    /**
+     * \brief Find the rollup buckets overlapping a time range
+     * \note
+     * The spans point into the mapped segments and remain valid until the
+     * next call to ``find_rollups`` or ``append``.
+     *
+     * @param width bucket width returned by ``get_rollup_width``
+     * @param from oldest time of interest (s since the Unix epoch)
+     * @param to newest time of interest (s since the Unix epoch)
+     * @return buckets in range, oldest first
+     * @throws AppException if a segment cannot be mapped
+     */
+    [[nodiscard]] std::vector<RollupSpan> find_rollups(const double width,
+                                                       const double from,
+                                                       const double to);
+
+    /**
+     * \brief Get the number of samples recorded
+     * @return samples in all segments
+     */
+    [[nodiscard]] quint64 size() const noexcept;
+
+private:
+
+    /**
+     * \brief Rollup level
+     */
+    struct RollupLevel {
+        double width; /**< Bucket width (s) */
+        std::unique_ptr<SegmentStore> buckets; /**< Buckets, oldest first */
+    };
+
+    /**
+     * \brief Add a sample to the current bucket of each rollup level
+     * @param levels levels to update
+     * @param timestamp sample time (s since the Unix epoch)
+     * @param value raw register value
+     */
+    void add_to_levels(const std::vector<RollupLevel*> &levels,
+                       const double timestamp,
+                       const quint16 value);
+
+    SegmentStore m_samples;
+    std::vector<RollupLevel> m_levels; /**< Finest first */
+    std::vector<RollupLevel*> m_all_levels; /**< Every level, updated by each sample */
+};
+
+
+#endif // TREND_HISTORIAN_H
@@ -27,31 +27,39 @@
 //  c++ includes
 #include <limits>  //  std::numeric_limits
 #include <QStringBuilder>  //  operator%
-#include <algorithm>  //  std::fill
+#include <algorithm>  //  std::min
 
 // C includes
 /* -none- */
 
 // project includes
 #include "trend_line.h"  //  local include
-#include "exceptions.h"  //  AppException
 #include "configure_trend_line.h"  //  ConfigureTrendLine
+#include "exceptions.h"  //  AppException
 
 
 TrendLine::TrendLine(TrendWindow *parent,
                      const quint16 reg,
-                     const quint8 node) :
+                     const quint8 node,
+                     const quint8 endpoint) :
         QPushButton(parent->m_scroll_container),
         m_reg_number{reg},
         m_device_id{node},
-        m_num_points{parent->m_timestamps.size()},
+        m_endpoint{endpoint},
+        m_num_points{parent->m_num_points},
         m_signed_value{true},
         m_mult{1.0},
         m_offset{0.0},
+        m_poll_period{0},
         m_pen_color(Qt::blue),
         m_history(m_num_points),
-        m_last_value(),
+        m_times(m_num_points),
         m_next_index{0},
+        m_count{0},
+        m_appended{0},
+        m_graph{nullptr},
+        m_decimator(),
+        m_historian(),
         m_parent{parent}
 {
     connect(this, &TrendLine::clicked, this, &TrendLine::on_clicked);
@@ -59,50 +67,197 @@ TrendLine::TrendLine(TrendWindow *parent,
 }
 
 
-void TrendLine::set_data(const quint16 value) noexcept
+double TrendLine::get_value(const quint16 value) const noexcept
 {
-    if (m_signed_value) {
-        const auto v = static_cast<qint16>(value);
-        m_last_value = qint32(v);
-    } else {
-        m_last_value = qint32(value);
-    }
+    auto v = m_signed_value ? double(static_cast<qint16>(value)) : double(value);
+    v *= m_mult;
+    v += m_offset;
+    return v;
 }
 
 
-void TrendLine::update()
+void TrendLine::add_sample(const quint16 value, const double timestamp)
 {
-    if (!bool(m_last_value)) {
-        throw AppException(tr("Update called on invalid data"));
+    if (nullptr != m_historian) {
+        try {
+            m_historian->append(timestamp + m_parent->m_epoch, value);
+        } catch (const AppException &e) {
+            m_historian.reset();
+            setToolTip(tr("History recording stopped: %1").arg(QString(e)));
+        }
     }
 
-    auto v = double(m_last_value.value()) * m_mult;
-    v += m_offset;
+    const auto v = get_value(value);
     m_parent->update_min_max(v);
-    m_history[m_next_index] = v;
+    m_history[m_next_index] = value;
+    m_times[m_next_index] = timestamp;
 
     if (++m_next_index >= m_num_points) {
         m_next_index = 0;
     }
 
-    m_last_value.reset();
+    if (m_count < m_num_points) {
+        ++m_count;
+    }
+
+    //  While the trend is scrolled / zoomed the graph shows the history.
+    if ((nullptr != m_graph) && m_parent->m_live) {
+        const auto oldest = get_timestamp(0);
+        //  Dropped points only become spare room at the front of the
+        // container.  Once a whole history has been dropped, move the points
+        // back down.  The capacity is kept so that no scan allocates once
+        // the container has grown to twice the history.
+        auto points = m_graph->data();
+        m_decimator.add(*points, timestamp, v);
+        points->removeBefore(oldest);
+        if (++m_appended >= m_num_points) {
+            points->squeeze(true, false);
+            m_appended = 0;
+        }
+    }
+}
+
+
+void TrendLine::set_graph(QCPGraph *const graph) noexcept
+{
+    m_graph = graph;
+    if (nullptr != m_graph) {
+        m_graph->data()->setAutoSqueeze(false);
+        m_graph->setPen(QPen(m_pen_color));
+    }
+}
+
+
+QCPGraph *TrendLine::get_graph() const noexcept
+{
+    return m_graph;
+}
+
+
+void TrendLine::rebuild_graph(const double bucket_width)
+{
+    if (nullptr == m_graph) {
+        return;
+    }
+
+    auto points = m_graph->data();
+    points->clear();
+    m_decimator.reset(bucket_width);
+    for (auto i=0; i<m_count; ++i) {
+        m_decimator.add(*points, get_timestamp(i), (*this)[i]);
+    }
+    m_appended = 0;
+}
+
+
+void TrendLine::load_graph(const double from, const double to, const double bucket_width)
+{
+    if (nullptr == m_graph) {
+        return;
+    }
+
+    auto points = m_graph->data();
+    points->clear();
+    m_decimator.reset(bucket_width);
+    if (nullptr != m_historian) {
+        try {
+            const auto epoch = m_parent->m_epoch;
+            const auto width = m_historian->get_rollup_width(bucket_width);
+            if (width > 0.0) {
+                //  Each bucket contributes its extremes, the order within the
+                // bucket is not known.
+                const auto spans = m_historian->find_rollups(width, from + epoch, to + epoch);
+                for (const auto &i: spans) {
+                    for (auto bucket=i.rollups; bucket<(i.rollups + i.count); ++bucket) {
+                        const auto min = m_signed_value ? quint16(bucket->signed_min) : bucket->unsigned_min;
+                        const auto max = m_signed_value ? quint16(bucket->signed_max) : bucket->unsigned_max;
+                        m_decimator.add(*points, bucket->timestamp - epoch, get_value(min));
+                        m_decimator.add(*points, bucket->timestamp - epoch + (width / 2.0), get_value(max));
+                    }
+                }
+            } else {
+                const auto spans = m_historian->find(from + epoch, to + epoch);
+                for (const auto &i: spans) {
+                    for (auto sample=i.samples; sample<(i.samples + i.count); ++sample) {
+                        m_decimator.add(*points, sample->timestamp - epoch, get_value(sample->value));
+                    }
+                }
+            }
+        } catch (const AppException &e) {
+            setToolTip(tr("History not available: %1").arg(QString(e)));
+        }
+    } else {
+        for (auto i=0; i<m_count; ++i) {
+            const auto timestamp = get_timestamp(i);
+            if ((timestamp >= from) && (timestamp <= to)) {
+                m_decimator.add(*points, timestamp, (*this)[i]);
+            }
+        }
+    }
+    m_appended = 0;
+}
+
+
+void TrendLine::open_history(const QString &directory)
+{
+    //  Named after the register so that a later session appends to it.
+    const auto name = QString("e%1_n%2_r%3").arg(m_endpoint).arg(m_device_id).arg(m_reg_number);
+    m_historian = std::make_unique<TrendHistorian>(directory, name);
 }
 
 
-TrendLine::operator bool() const noexcept
+void TrendLine::close_history() noexcept
 {
-    return m_last_value.has_value();
+    m_historian.reset();
 }
 
 
-const double& TrendLine::operator[] (int index) const
+int TrendLine::size() const noexcept
 {
-    auto array_index = m_next_index + index;
-    if (array_index >= m_num_points) {
+    return m_count;
+}
+
+
+int TrendLine::get_ring_index(int index) const noexcept
+{
+    //  The oldest sample is at m_next_index once the ring has filled.
+    auto array_index = m_next_index - m_count + index;
+    if (array_index < 0) {
+        array_index += m_num_points;
+    } else if (array_index >= m_num_points) {
         array_index -= m_num_points;
+    } else {
+
+    }
+
+    return array_index;
+}
+
+
+double TrendLine::get_timestamp(int index) const
+{
+    return m_times.at(get_ring_index(index));
+}
+
+
+double TrendLine::operator[] (int index) const
+{
+    return get_value(m_history.at(get_ring_index(index)));
+}
+
+
+TrendExportLine TrendLine::get_export_data() const
+{
+    TrendExportLine data{m_reg_number, m_device_id, m_endpoint, m_pen_color.name(),
+                         m_signed_value, m_mult, m_offset, {}, {}};
+    data.timestamps.reserve(size_t(m_count));
+    data.values.reserve(size_t(m_count));
+    for (auto i=0; i<m_count; ++i) {
+        data.timestamps.push_back(get_timestamp(i));
+        data.values.push_back(m_history.at(get_ring_index(i)));
     }
 
-    return m_history.at(array_index);
+    return data;
 }
 
 
@@ -114,16 +269,37 @@ void TrendLine::configure(const double m, const double b, const bool set_signed)
 }
 
 
+void TrendLine::set_poll_period(const std::chrono::milliseconds period) noexcept
+{
+    m_poll_period = period;
+}
+
+
+std::chrono::milliseconds TrendLine::get_poll_period() const noexcept
+{
+    return m_poll_period;
+}
+
+
+void TrendLine::set_statistics(const double rate, const quint64 missed)
+{
+    setToolTip(tr("%1 Hz, %2 missed").arg(rate, 0, 'f', 1).arg(missed));
+}
+
+
 void TrendLine::set_color(const QColor &pen_color) noexcept
 {
     m_pen_color = pen_color;
+    if (nullptr != m_graph) {
+        m_graph->setPen(QPen(m_pen_color));
+    }
     setupUi();
 }
 
 
 TrendLine::operator quint32() const noexcept
 {
-    return m_parent->get_key(m_reg_number, m_device_id);
+    return m_parent->get_key(m_reg_number, m_device_id, m_endpoint);
 }
 
 
@@ -146,8 +322,12 @@ void TrendLine::setupUi()
     setAutoDefault(false);
     const auto reg_number = QString::number(m_reg_number);
     const auto reg_padding = QString(5 - reg_number.size(), QChar('0'));
-    setText("------\n" % reg_padding %
-            reg_number % QChar('@') % QString::number(m_device_id));
+    auto label = QString("------\n" % reg_padding %
+                         reg_number % QChar('@') % QString::number(m_device_id));
+    if (m_endpoint > 0) {
+        label = label % QChar(':') % QString::number(m_endpoint);
+    }
+    setText(label);
     setStyleSheet("QPushButton {color: " % m_pen_color.name() % ";}");
 }
 
@@ -156,9 +336,11 @@ void TrendLine::save_configuration(QDomElement &node) const
 {
     node.setAttribute("register", QString::number(m_reg_number));
     node.setAttribute("node", QString::number(m_device_id));
+    node.setAttribute("endpoint", QString::number(m_endpoint));
     node.setAttribute("signed", QString::number(int(m_signed_value)));
     node.setAttribute("m", QString::number(m_mult));
     node.setAttribute("b", QString::number(m_offset));
+    node.setAttribute("period", QString::number(m_poll_period.count()));
     node.setAttribute("color", m_pen_color.name());
 
 }
@@ -166,8 +348,17 @@ void TrendLine::save_configuration(QDomElement &node) const
 
 void TrendLine::resize(int new_size)
 {
-    m_next_index = 0;
+    const auto count = std::min(m_count, new_size);
+    QVector<quint16> history(new_size);
+    QVector<double> times(new_size);
+    for (auto i=0; i<count; ++i) {
+        history[i] = m_history.at(get_ring_index(m_count - count + i));
+        times[i] = get_timestamp(m_count - count + i);
+    }
+
+    m_history.swap(history);
+    m_times.swap(times);
     m_num_points = new_size;
-    m_history.resize(new_size);
-    std::fill(m_history.begin(), m_history.end(), m_offset);
+    m_count = count;
+    m_next_index = (count < new_size) ? count : 0;
 }
@@ -28,6 +28,17 @@
  * section of the graph.  It overlads the actual button and provides a bunch of
  * syntactic sugar to interface to the underlying trend data.  This class shall
  * not be used outside of the TrendWindow class.
+ *
+ * Each line keeps its own ring of timestamped samples, recorded as each
+ * response arrives, so that lines polled at different rates (or failing to
+ * poll) never hold each other up.  Each line owns a QCPGraph whose data
+ * container is kept between samples: a sample is appended and the points
+ * older than the history are dropped in place, the container is only rebuilt
+ * from the history when the configuration changes.  The graph
+ * holds the min/max envelope of the history (\sa TrendDecimator), the full
+ * resolution history is kept for export.  When history recording is enabled
+ * every sample is also appended to disk (\sa TrendHistorian) and the graph
+ * is loaded from there while the trend is scrolled or zoomed.
  */
 
 #ifndef TREND_LINE_H
@@ -39,13 +50,17 @@
 #include <QPushButton>  //  QPushButton
 #include <QPen>  //  QPen
 #include <QDomElement>  //  QDomElement
-#include <optional>  //  std::optional
+#include <qcustomplot.h>  //  QCPGraph
+#include <chrono>  //  std::chrono::milliseconds
+#include <memory>  //  std::unique_ptr
 
 // C includes
 /* -none- */
 
 // project includes
 #include "trend_window.h"
+#include "trend_decimator.h"  //  TrendDecimator
+#include "trend_historian.h"  //  TrendHistorian
 
 
 /**
@@ -64,14 +79,20 @@ public:
      * @param parent parent TrendWindo
      * @param reg modbus register to monitor
      * @param node node / device ID to monitor
+     * @param endpoint endpoint (device connection) to monitor
      */
-    TrendLine(TrendWindow *parent, const quint16 reg, const quint8 node=0);
+    TrendLine(TrendWindow *parent, const quint16 reg, const quint8 node=0, const quint8 endpoint=0);
 
     /**
-     * @brief Set the current data
-     * @param value current data value
+     * @brief Record a sample in the history
+     * \note
+     * This also updates the parent min/max values and appends the value to the
+     * graph without reallocating its data.
+     *
+     * @param value raw register value
+     * @param timestamp time the value was received (s)
      */
-    void set_data(const quint16 value) noexcept;
+    void add_sample(const quint16 value, const double timestamp);
 
     /**
      * @brief configure trend internals
@@ -82,6 +103,26 @@ public:
      */
     void configure(const double m, const double b, const bool set_signed=true);
 
+    /**
+     * @brief Set how often the trend polls its register
+     * @param period poll period, 0 = not polled by the trend (data is taken
+     *        from the register windows polling the register)
+     */
+    void set_poll_period(const std::chrono::milliseconds period) noexcept;
+
+    /**
+     * @brief Get how often the trend polls its register
+     * @return poll period, 0 = not polled by the trend
+     */
+    [[nodiscard]] std::chrono::milliseconds get_poll_period() const noexcept;
+
+    /**
+     * @brief Show the timing achieved by the poll of this line
+     * @param rate polls per second
+     * @param missed polls that failed or completed after their deadline
+     */
+    void set_statistics(const double rate, const quint64 missed);
+
     /**
      * @brief Set the trend line color
      * @param pen_color line color
@@ -89,18 +130,61 @@ public:
     void set_color(const QColor &pen_color) noexcept;
 
     /**
-     * @brief Update history with current value
+     * @brief Set the graph that draws this line
+     * @param graph graph owned by the parent plot (the data is rebuilt by
+     *        ``rebuild_graph``)
+     */
+    void set_graph(QCPGraph *const graph) noexcept;
+
+    /**
+     * @brief Get the graph that draws this line
+     * @return graph, ``nullptr`` until added to the plot
+     */
+    [[nodiscard]] QCPGraph *get_graph() const noexcept;
+
+    /**
+     * @brief Replace the graph data with the whole history
+     * @param bucket_width decimation bucket width in seconds (about 1
+     *        pixel), <= 0 to plot every point
+     */
+    void rebuild_graph(const double bucket_width);
+
+    /**
+     * @brief Replace the graph data with a time range of the recorded history
      * \note
-     * This also updates the parent min/max values
+     * Without a recorded history the samples held in memory are used.
      *
-     * @throw AppException if no value has been stored.
+     * @param from oldest time shown (s, trend time)
+     * @param to newest time shown (s, trend time)
+     * @param bucket_width decimation bucket width in seconds, <= 0 to plot
+     *        every point
      */
-    void update();
+    void load_graph(const double from, const double to, const double bucket_width);
 
     /**
-     * @brief get current state : IE is there a value currently stored?
+     * @brief Start recording every sample to disk
+     * @param directory history directory
+     * @throws AppException if the history cannot be opened
      */
-    [[nodiscard]] operator bool() const noexcept;
+    void open_history(const QString &directory);
+
+    /**
+     * @brief Stop recording samples to disk
+     */
+    void close_history() noexcept;
+
+    /**
+     * @brief Get the number of samples in the history
+     * @return 0 until the first sample is received, at most the history size
+     */
+    [[nodiscard]] int size() const noexcept;
+
+    /**
+     * @brief Get the time of a sample
+     * @param index index: 0 => oldest, size()-1 => newest
+     * @return time the sample was received (s)
+     */
+    [[nodiscard]] double get_timestamp(int index) const;
 
     /**
       * \brief Get the QPen for graph drawing
@@ -114,10 +198,16 @@ public:
 
     /**
      * @brief Get the value at an index
-     * @param index index: 0 => oldest, g_num_points-1 => newest
+     * @param index index: 0 => oldest, size()-1 => newest
      * @return historical value
      */
-    [[nodiscard]] const double& operator[] (int index) const;
+    [[nodiscard]] double operator[] (int index) const;
+
+    /**
+     * @brief Copy the history for export
+     * @return samples held in memory, oldest first
+     */
+    [[nodiscard]] TrendExportLine get_export_data() const;
 
     /**
      * @brief Save trend line configuration
@@ -127,12 +217,16 @@ public:
 
     /**
      * @brief Resize the number of history items
+     * \note
+     * The newest samples are kept.
+     *
      * @param new_size new number of history items
      */
     void resize(int new_size);
 
     const quint16 m_reg_number; /**< Register number associated with line */
     const quint8 m_device_id; /**< Device ID to monitor */
+    const quint8 m_endpoint; /**< Endpoint to monitor */
 
 private slots:
 
@@ -148,15 +242,35 @@ private:
      */
     void setupUi();
 
+    /**
+     * @brief Get the position of a sample in the ring
+     * @param index index: 0 => oldest, size()-1 => newest
+     * @return index into m_history / m_times
+     */
+    [[nodiscard]] int get_ring_index(int index) const noexcept;
+
+    /**
+     * @brief Convert a raw register value to the trend value
+     * @param value raw register value
+     * @return value scaled by m, b
+     */
+    [[nodiscard]] double get_value(const quint16 value) const noexcept;
+
     int m_num_points;
     bool m_signed_value; /**< Treat incoming data as signed? */
     double m_mult; /**< Multiply value by m */
     double m_offset; /**< Add b to value after multiplication */
+    std::chrono::milliseconds m_poll_period; /**< Poll period, 0 = not polled */
 
     QColor m_pen_color; /**< Desired pen color */
-    QVector<double> m_history;
-    std::optional<qint32> m_last_value;
-    qint32 m_next_index;
+    QVector<quint16> m_history; /**< Raw sample values (ring), scaled when read */
+    QVector<double> m_times; /**< Sample timestamps (ring) */
+    qint32 m_next_index; /**< Ring position of the next sample */
+    qint32 m_count; /**< Samples stored, up to m_num_points */
+    qint32 m_appended; /**< Points appended to the graph since it was compacted */
+    QCPGraph *m_graph; /**< Owned by the plot */
+    TrendDecimator m_decimator; /**< Reduces the history to what can be seen */
+    std::unique_ptr<TrendHistorian> m_historian; /**< Set when recording to disk */
     TrendWindow *const m_parent;
 };
 
@@ -26,11 +26,12 @@
 
 //  c++ includes
 #include <QTimer>  //  QTimer
+#include <algorithm>  //  std::min, std::max
+#include <utility>  //  std::move
 #include <QMessageBox>  //  QMessageBox
 #include <QAction>  //  QAction
 #include <QFileDialog>  //  QFileDialog
-#include <qtcsv/stringdata.h>  //  QtCSV::StringData
-#include <qtcsv/writer.h>  //  QtCSV::Writer::write
+#include <QProgressDialog>  //  QProgressDialog
 
 // C includes
 /* -none- */
@@ -40,6 +41,8 @@
 #include "trend_line.h"  //  TrendLine
 #include "configure_trend_line.h"  //  ConfigureTrendLine
 #include "configure_trend.h"  //  ConfigureTrend
+#include "exceptions.h"  //  AppException
+#include "capture_file.h"  //  capture_file::SUFFIX
 
 
 using TimeDiff = std::chrono::duration<double>;
@@ -48,6 +51,8 @@ using std::chrono::steady_clock;
 
 namespace {
     const auto g_num_points = 100;
+    const auto g_max_frame_rate = 30;  /**< Replots per second */
+    const auto g_default_plot_width = 700;  /**< Pixels, until the plot is laid out */
 }
 
 
@@ -55,8 +60,9 @@ TrendWindow::TrendWindow(QWidget *const parent) :
     BaseDialog(parent, false),
     m_plot{new QCustomPlot(this)},
     m_data(),
-    m_timestamps(),
+    m_num_points{g_num_points},
     m_start_time{steady_clock::now()},
+    m_epoch{TimeDiff(std::chrono::system_clock::now().time_since_epoch()).count()},
     m_layout{new QHBoxLayout(this)},
     m_legend{new QGroupBox(tr("Legend:"), this)},
     m_legend_layout{new QVBoxLayout(m_legend)},
@@ -66,14 +72,15 @@ TrendWindow::TrendWindow(QWidget *const parent) :
     m_add_button{new QPushButton(tr("Add new\nregister"), m_scroll_container)},
     m_configure_button{new QPushButton(tr("Graph\nMenu"), m_legend)},
     m_main_menu{new QMenu(m_configure_button->text(), m_configure_button)},
+    m_replot_timer{new QTimer(this)},
+    m_loaded_range(),
+    m_history_dir(),
     m_miny{0.0},
     m_maxy{1.0}
 {
-    auto timepoint = 0.0;
-    for (auto i=g_num_points; i>0; --i) {
-        --timepoint;
-        m_timestamps.prepend(timepoint);
-    }
+    m_replot_timer->setSingleShot(true);
+    m_replot_timer->setInterval(1000 / g_max_frame_rate);
+    connect(m_replot_timer, &QTimer::timeout, this, &TrendWindow::on_replot_timer_timeout);
 
     setLayout(m_layout);
     connect(m_add_button, &QPushButton::clicked, this, &TrendWindow::on_add_button_clicked);
@@ -98,6 +105,12 @@ void TrendWindow::setupUi()
     connect(save, &QAction::triggered, this, &TrendWindow::on_save_triggered);
     auto capture = m_main_menu->addAction(tr("Save Screenshot"));
     connect(capture, &QAction::triggered, this, &TrendWindow::on_capture_triggered);
+    auto history = m_main_menu->addAction(tr("Record History..."));
+    connect(history, &QAction::triggered, this, &TrendWindow::on_history_triggered);
+    auto stop_history = m_main_menu->addAction(tr("Stop Recording History"));
+    connect(stop_history, &QAction::triggered, this, &TrendWindow::on_stop_history_triggered);
+    auto follow = m_main_menu->addAction(tr("Follow Live Data"));
+    connect(follow, &QAction::triggered, this, &TrendWindow::on_follow_triggered);
 
     /* Scrollable "Legend" containing a list of graphs */
     m_legend_layout->addWidget(m_button_area);
@@ -113,13 +126,31 @@ void TrendWindow::setupUi()
     m_add_button->setFixedWidth(125);
     m_add_button->setDefault(true);
 
-    /* Build the actual plot.  It must have at least 1 graph. */
+    /* Build the actual plot.  It must have at least 1 graph (graph 0 is
+     * never used by a trend line). */
     m_layout->addWidget(m_plot);
     m_plot->addGraph();
     m_plot->xAxis->setLabel(tr("time"));
     m_plot->yAxis->setLabel(tr("value"));
     m_plot->setOpenGl(true);
 
+    /* Drag / zoom the time axis to browse the history. */
+    m_plot->setInteractions(QCP::iRangeDrag | QCP::iRangeZoom);
+    m_plot->axisRect()->setRangeDrag(Qt::Horizontal);
+    m_plot->axisRect()->setRangeZoom(Qt::Horizontal);
+    connect(m_plot, &QCustomPlot::mousePress, this, [=]() {
+        m_live = false;
+    });
+    connect(m_plot, &QCustomPlot::mouseWheel, this, [=]() {
+        m_live = false;
+    });
+    connect(m_plot, &QCustomPlot::mouseDoubleClick, this, &TrendWindow::on_follow_triggered);
+    connect(m_plot->xAxis, QOverload<const QCPRange&>::of(&QCPAxis::rangeChanged), this, [=]() {
+        if (!m_live) {
+            replot_graph();
+        }
+    });
+
     resize(850, 340);
 
     setWindowTitle(tr("Trend"));
@@ -130,87 +161,206 @@ void TrendWindow::on_new_value(const quint16 reg,
                                const quint16 value,
                                const quint8 unit_id)
 {
-    auto graph_inst = m_data.find(get_key(reg, unit_id));
+    on_endpoint_value(0, reg, value, unit_id);
+}
+
+
+void TrendWindow::on_endpoint_value(const quint8 endpoint,
+                                    const quint16 reg,
+                                    const quint16 value,
+                                    const quint8 unit_id)
+{
+    auto graph_inst = m_data.find(get_key(reg, unit_id, endpoint));
     if (m_data.end() != graph_inst) {
-        graph_inst->second->set_data(value);
-        scan();
+        graph_inst->second->add_sample(value, get_timestamp());
+        replot_graph();
     }
 }
 
 
-void TrendWindow::redraw_graph()
+void TrendWindow::on_register_block(const quint8 endpoint, const RegisterBlock block)
+{
+    //  Look up each line rather than each register, then replot once per block.
+    const auto timestamp = get_timestamp();
+    auto updated = false;
+    for (auto &i: m_data) {
+        auto &line = *(i.second);
+        if ((line.m_endpoint == endpoint) && (line.m_device_id == block.node) &&
+                (line.m_reg_number >= block.first_register)) {
+            const auto index = size_t(line.m_reg_number - block.first_register);
+            if (index < block.count) {
+                line.add_sample(get_block_value(block, index), timestamp);
+                updated = true;
+            }
+        }
+    }
+
+    if (updated) {
+        replot_graph();
+    }
+}
+
+
+void TrendWindow::on_poll_statistics(const quint8 endpoint, const PollStatistics statistics)
 {
-    auto time = m_timestamps.begin();
-    const auto start_time = *time;
-    const auto graph_size = m_timestamps.size();
-    auto end_time = std::numeric_limits<double>::max();
-
-    QVector<double> x(graph_size);
-    for (auto i=0; i < graph_size; ++i) {
-        end_time = *time;
-        x[i] = end_time;
-        ++time;
+    if (this == statistics.requester) {
+        auto graph_inst = m_data.find(get_key(statistics.range.first_register,
+                                              statistics.range.node,
+                                              endpoint));
+        if (m_data.end() != graph_inst) {
+            graph_inst->second->set_statistics(statistics.rate, statistics.missed);
+        }
     }
+}
 
-    QVector<double> y(graph_size, 0.0);
-    auto graph = 0;
 
-    for (const auto &line: m_data) {
-        for (auto i=0; i<graph_size; ++i) {
-            y[i] = (*line.second)[i];
+std::vector<PollSubscription> TrendWindow::get_poll_subscriptions() const
+{
+    std::vector<PollSubscription> subscriptions;
+    for (const auto &i: m_data) {
+        const auto period = i.second->get_poll_period();
+        if (period.count() > 0) {
+            const auto &line = *(i.second);
+            subscriptions.push_back({line.m_endpoint, {line.m_device_id, line.m_reg_number, 1U}, period});
         }
-        m_plot->graph(graph)->setData(x, y, true);
-        m_plot->graph(graph)->setPen(QPen(*line.second));
-        ++graph;
     }
 
-    if (0 == graph) {
-        m_plot->graph(0)->setData(x, y, true);
+    return subscriptions;
+}
+
+
+std::vector<DisplayedRange> TrendWindow::get_displayed_ranges() const
+{
+    std::vector<DisplayedRange> ranges;
+    ranges.reserve(m_data.size());
+    for (const auto &i: m_data) {
+        const auto &line = *(i.second);
+        ranges.push_back({line.m_endpoint, {line.m_device_id, line.m_reg_number, 1U}});
+    }
+
+    return ranges;
+}
+
+
+void TrendWindow::redraw_graph()
+{
+    const auto range = get_time_range();
+    m_bucket_width = get_bucket_width(range.second - range.first);
+    for (const auto &line: m_data) {
+        line.second->rebuild_graph(m_bucket_width);
+    }
+
+    replot_graph();
+}
+
+
+void TrendWindow::replot_graph()
+{
+    if (!m_replot_timer->isActive()) {
+        m_replot_timer->start();
+    }
+}
+
+
+void TrendWindow::on_replot_timer_timeout()
+{
+    if (m_live) {
+        //  Rebuild should the plot have been resized or the time span changed.
+        const auto range = get_time_range();
+        const auto bucket_width = get_bucket_width(range.second - range.first);
+        if (bucket_width < (m_bucket_width / 2.0) || bucket_width > (m_bucket_width * 2.0)) {
+            m_bucket_width = bucket_width;
+            for (const auto &line: m_data) {
+                line.second->rebuild_graph(m_bucket_width);
+            }
+        }
+
+        m_plot->xAxis->setRange(range.first, range.second);
+    } else {
+        //  Only reload from the history when the time axis has moved.
+        const auto range = m_plot->xAxis->range();
+        if ((range.lower != m_loaded_range.first) || (range.upper != m_loaded_range.second)) {
+            m_loaded_range = {range.lower, range.upper};
+            m_bucket_width = get_bucket_width(range.upper - range.lower);
+            for (const auto &line: m_data) {
+                line.second->load_graph(range.lower, range.upper, m_bucket_width);
+            }
+        }
     }
 
-    m_plot->xAxis->setRange(start_time, end_time);
     m_plot->yAxis->setRange(m_miny, m_maxy);
     m_plot->replot();
 }
 
 
-void TrendWindow::scan()
+double TrendWindow::get_bucket_width(const double span) const
 {
+    auto width = m_plot->axisRect()->width();
+    if (width <= 0) {
+        width = g_default_plot_width;
+    }
+
+    return span / double(width);
+}
+
+
+std::pair<double, double> TrendWindow::get_time_range() const
+{
+    auto range = std::make_pair(0.0, 0.0);
+    auto found = false;
     for (const auto &i: m_data) {
-        if (!bool(*(i.second))) {
-            return;
+        const auto &line = *(i.second);
+        if (line.size() > 0) {
+            const auto oldest = line.get_timestamp(0);
+            const auto newest = line.get_timestamp(line.size() - 1);
+            if (!found) {
+                range = {oldest, newest};
+                found = true;
+            } else {
+                range.first = std::min(range.first, oldest);
+                range.second = std::max(range.second, newest);
+            }
         }
     }
 
-    const TimeDiff diff = steady_clock::now() - m_start_time;
-    m_timestamps.removeFirst();
-    m_timestamps.append(diff.count());
-
-    for (auto &i: m_data) {
-        i.second->update();
+    if (range.second <= range.first) {
+        //  No (or a single) sample: show the last second.
+        range.second = found ? range.first : get_timestamp();
+        range.first = range.second - 1.0;
     }
 
-    redraw_graph();
+    return range;
 }
 
 
-quint32 TrendWindow::get_key(const quint16 reg, const quint8 node) const noexcept
+double TrendWindow::get_timestamp() const
 {
-    return (quint32(node) << 16U) | quint32(reg);
+    const TimeDiff diff = steady_clock::now() - m_start_time;
+    return diff.count();
+}
+
+
+quint32 TrendWindow::get_key(const quint16 reg,
+                             const quint8 node,
+                             const quint8 endpoint) const noexcept
+{
+    return (quint32(endpoint) << 24U) | (quint32(node) << 16U) | quint32(reg);
 }
 
 
 void TrendWindow::add_trend(TrendLine *const trend)
 {
     m_data[quint32(*trend)] = trend;
-    if (size_t(m_plot->graphCount()) < m_data.size()) {
-        m_plot->addGraph();
+    trend->set_graph(m_plot->addGraph());
+    if (!m_history_dir.isEmpty()) {
+        open_history(trend);
     }
 
     auto w = m_scroll_layout->count();
     m_scroll_layout->insertWidget(w - 1, trend);
 
     redraw_graph();
+    emit poll_configuration_changed(this);
 }
 
 
@@ -228,9 +378,10 @@ void TrendWindow::on_add_button_clicked()
             error_box.setWindowTitle(tr("Invalid Configuration"));
             error_box.setInformativeText(tr("Duplicate trend requested.\n"
                                             "Edit trend instead"));
-            error_box.setDetailedText(tr("Register: %1\nRemote Node: %2")
+            error_box.setDetailedText(tr("Register: %1\nRemote Node: %2\nEndpoint: %3")
                                       .arg(trend->second->m_reg_number)
-                                      .arg(trend->second->m_device_id));
+                                      .arg(trend->second->m_device_id)
+                                      .arg(trend->second->m_endpoint));
             error_box.exec();
         } else {
             add_trend(dlg.create_trend());
@@ -245,12 +396,11 @@ void TrendWindow::remove_trend(const quint32 trend_key)
     auto trend = trend_index->second;
     m_data.erase(trend_index);
     m_scroll_layout->removeWidget(trend);
-    const auto graph_count = m_plot->graphCount();
-    if (graph_count > 1) {
-        m_plot->removeGraph(graph_count - 1);
-    }
+    m_plot->removeGraph(trend->get_graph());
+    trend->set_graph(nullptr);
 
-    redraw_graph();
+    replot_graph();
+    emit poll_configuration_changed(this);
 
     //  Don't let it happen until the next entry into the scheduler as the
     // instance is probably in our call path.
@@ -260,7 +410,7 @@ void TrendWindow::remove_trend(const quint32 trend_key)
 
 void TrendWindow::on_configure_triggered()
 {
-    auto dlg = ConfigureTrend(this, m_miny, m_maxy, m_timestamps.size());
+    auto dlg = ConfigureTrend(this, m_miny, m_maxy, m_num_points);
     if (dlg.exec() != 0) {
         m_fixed_limits = bool(dlg);
 
@@ -278,20 +428,37 @@ void TrendWindow::on_configure_triggered()
 
 void TrendWindow::on_save_triggered()
 {
+    if (nullptr != m_exporter) {
+        QMessageBox::information(this, tr("Save history"), tr("The data is still being saved."));
+        return;
+    }
+
+    const auto long_filter = tr("Spreadsheet, one sample per row (*.csv)");
+    const auto capture_filter = tr("Capture (*.%1)").arg(capture_file::SUFFIX);
     auto dialog = QFileDialog(this, tr("Save data as..."));
     dialog.setNameFilters({tr("Spreadsheet (*.csv)"),
+                           long_filter,
+                           capture_filter,
                            tr("All files (*)")});
     dialog.setAcceptMode(QFileDialog::AcceptSave);
     dialog.setViewMode(QFileDialog::Detail);
     dialog.setFileMode(QFileDialog::AnyFile);
     dialog.setDefaultSuffix("csv");
+    connect(&dialog, &QFileDialog::filterSelected, this, [&](const QString &filter) {
+        dialog.setDefaultSuffix((filter == capture_filter) ? QString(capture_file::SUFFIX) : QString("csv"));
+    });
     if (dialog.exec() != 0) {
         auto file_name = dialog.selectedFiles().first();
-        if (!save_register_set(file_name)) {
-            QMessageBox::warning(this, tr("Save history"),
-                                 tr("Cannot write file %1:\n.")
-                                 .arg(QDir::toNativeSeparators(file_name)));
+        const auto filter = dialog.selectedNameFilter();
+        auto layout = TrendExporter::LAYOUT_WIDE;
+        if (filter == long_filter) {
+            layout = TrendExporter::LAYOUT_LONG;
+        } else if ((filter == capture_filter) || file_name.endsWith(QString(".") + capture_file::SUFFIX)) {
+            layout = TrendExporter::LAYOUT_CAPTURE;
+        } else {
+
         }
+        save_register_set(file_name, layout);
     }
 }
 
@@ -331,6 +498,53 @@ void TrendWindow::on_capture_triggered()
 }
 
 
+void TrendWindow::on_history_triggered()
+{
+    const auto directory = QFileDialog::getExistingDirectory(this, tr("Record history in..."),
+                                                             m_history_dir);
+    if (!directory.isEmpty()) {
+        m_history_dir = directory;
+        for (auto &i: m_data) {
+            if (!open_history(i.second)) {
+                break;
+            }
+        }
+    }
+}
+
+
+void TrendWindow::on_stop_history_triggered()
+{
+    m_history_dir.clear();
+    for (auto &i: m_data) {
+        i.second->close_history();
+    }
+}
+
+
+void TrendWindow::on_follow_triggered()
+{
+    m_live = true;
+    m_loaded_range = {};
+    redraw_graph();
+}
+
+
+bool TrendWindow::open_history(TrendLine *const line)
+{
+    try {
+        line->open_history(m_history_dir);
+    } catch (const AppException &e) {
+        QMessageBox::warning(this, tr("Record History"),
+                             tr("Cannot record history in %1:\n%2")
+                             .arg(QDir::toNativeSeparators(m_history_dir), QString(e)));
+        return false;
+    }
+
+    return true;
+}
+
+
 void TrendWindow::update_min_max(const double value) noexcept
 {
     if (!m_fixed_limits) {
@@ -345,31 +559,32 @@ void TrendWindow::update_min_max(const double value) noexcept
 }
 
 
-bool TrendWindow::save_register_set(const QString &path)
+void TrendWindow::save_register_set(const QString &path, const TrendExporter::Layout layout)
 {
-    QStringList header;
-    header << tr("Register number") << tr("Device ID/Node") << tr("Line Color");
-
-    for (const auto i: m_timestamps) {
-        header << QString::number(i);
-    }
-    QtCSV::StringData csv_data;
-    csv_data.addRow(header);
-
+    std::vector<TrendExportLine> lines;
+    lines.reserve(m_data.size());
     for (const auto &i: m_data) {
-        QStringList row;
-        row << QString::number(i.second->m_reg_number)
-            << QString::number(i.second->m_device_id)
-            << QPen(*(i.second)).color().name();
-
-
-        for (auto index=0; index<m_timestamps.size(); ++index) {
-            row << QString::number((*(i.second))[index]);
-        }
-        csv_data.addRow(row);
+        lines.push_back(i.second->get_export_data());
     }
 
-    return QtCSV::Writer::write(path, csv_data);
+    m_exporter = new TrendExporter(this, path, layout, m_epoch, std::move(lines));
+    auto progress = new QProgressDialog(tr("Saving %1").arg(QDir::toNativeSeparators(path)),
+                                        tr("Cancel"), 0, 100, this);
+    progress->setAutoClose(false);
+    progress->setAutoReset(false);
+    connect(m_exporter, &TrendExporter::progress, progress, &QProgressDialog::setValue);
+    connect(progress, &QProgressDialog::canceled, m_exporter, &TrendExporter::cancel);
+    connect(m_exporter, &TrendExporter::finished, this, [=](const bool success, const QString error) {
+        progress->deleteLater();
+        m_exporter->deleteLater();
+        m_exporter = nullptr;
+        if (!success && !error.isEmpty()) {
+            QMessageBox::warning(this, tr("Save history"),
+                                 tr("Cannot write file %1:\n%2.")
+                                 .arg(QDir::toNativeSeparators(path), error));
+        }
+    });
+    m_exporter->start();
 }
 
 
@@ -385,7 +600,8 @@ QDomElement TrendWindow::save_configuration(QDomDocument &root) const
     trend.setAttribute("min", QString::number(m_miny));
     trend.setAttribute("max", QString::number(m_maxy));
     trend.setAttribute("fixed", QString::number(int(m_fixed_limits)));
-    trend.setAttribute("points", QString::number(m_timestamps.size()));
+    trend.setAttribute("points", QString::number(m_num_points));
+    trend.setAttribute("history", m_history_dir);
 
     for (const auto &i: m_data) {
         auto line = root.createElement("trend_line");
@@ -419,6 +635,7 @@ bool TrendWindow::load_configuration(const QDomElement &node)
     }
 
     resize_history(points, false);
+    m_history_dir = node.attribute("history", "");
     m_fixed_limits = bool(fixed);
     m_miny = min;
     m_maxy = max;
@@ -433,21 +650,25 @@ bool TrendWindow::load_configuration(const QDomElement &node)
 
             const auto reg = element.attribute("register", "-1").toInt();
             const auto node = element.attribute("node", "-1").toInt();
+            const auto endpoint = element.attribute("endpoint", "0").toInt();
             const auto is_signed = element.attribute("signed", "-1").toInt();
             bool okm, okb;
             const auto m = element.attribute("m", "[bad]").toDouble(&okm);
             const auto b = element.attribute("b", "[bad]").toDouble(&okb);
             const auto color = QColor(element.attribute("color", "[bad]"));
+            const auto period = element.attribute("period", "0").toInt();
 
-            if ((reg < 1) || (node < 0) || (is_signed < 0) || !okm || !okb) {
+            if ((reg < 1) || (node < 0) || (endpoint < 0) || (endpoint > 255) ||
+                    (is_signed < 0) || !okm || !okb || (period < 0)) {
                 return false;
             }
 
-            auto line = new TrendLine(this, quint16(reg), quint8(node));
+            auto line = new TrendLine(this, quint16(reg), quint8(node), quint8(endpoint));
             new_lines.append(line);
 
             line->configure(m, b, bool(is_signed));
             line->set_color(color);
+            line->set_poll_period(std::chrono::milliseconds(period));
         }
     }
 
@@ -465,16 +686,7 @@ bool TrendWindow::load_configuration(const QDomElement &node)
 
 void TrendWindow::resize_history(const int points, bool redraw)
 {
-    while (m_timestamps.size() > points) {
-        m_timestamps.removeFirst();
-    }
-
-    auto earliest = m_timestamps.first();
-    while (m_timestamps.size() < points) {
-        --earliest;
-        m_timestamps.prepend(earliest);
-    }
-
+    m_num_points = points;
     for (auto &i: m_data) {
         i.second->resize(points);
     }
@@ -25,14 +25,16 @@
  * \section DESCRIPTION
  *
  * The project may include 1 trend window with many trend lines updated from
- * polling data.
+ * polling data.  Each line records its samples when they arrive, the lines are
+ * drawn on a common time axis spanning the oldest to the newest sample.
+ * Dragging or zooming the time axis stops following the newest samples and
+ * shows the history recorded to disk, double-click to follow again.
  */
 
 #ifndef TREND_WINDOW_H
 #define TREND_WINDOW_H
 
 //  c++ includes
-#include <QList>  //  QList
 #include <QHBoxLayout>  //  QHBoxLayout
 #include <QScrollArea>  //  QScrollArea
 #include <QPushButton>  //  QPushButton
@@ -40,15 +42,18 @@
 #include <QMenu>  //  QMenu
 #include <QDomElement>  //  QDomElement
 #include <QDomDocument>  //  QDomDocument
+#include <QTimer>  //  QTimer
 #include <qcustomplot.h>  //  QCustomPlot
 #include <chrono>  //  std::chrono
 #include <unordered_map>  //  std::unordered_map
+#include <utility>  //  std::pair
 
 // C includes
 /* -none- */
 
 // project includes
 #include "base_dialog.h"
+#include "trend_exporter.h"  //  TrendExporter
 
 
 // /////////////////////////////////////////////////////////////////////////////
@@ -79,8 +84,11 @@ public:
       * \brief get hash key from reg, node
       * @param reg register number
       * @param node node/device ID
+      * @param endpoint endpoint (device connection)
       */
-    [[nodiscard]] quint32 get_key(const quint16 reg, const quint8 node) const noexcept;
+    [[nodiscard]] quint32 get_key(const quint16 reg,
+                                  const quint8 node,
+                                  const quint8 endpoint=0) const noexcept;
 
     /**
      * @brief remove_trend
@@ -114,22 +122,55 @@ public:
      */
     bool load_configuration(const QDomElement &node);
 
+    [[nodiscard]] virtual std::vector<PollSubscription> get_poll_subscriptions() const override;
+    [[nodiscard]] virtual std::vector<DisplayedRange> get_displayed_ranges() const override;
+
 public slots:
 
     virtual void on_new_value(const quint16 reg, const quint16 value, const quint8 unit_id) override;
+    virtual void on_endpoint_value(const quint8 endpoint,
+                                   const quint16 reg,
+                                   const quint16 value,
+                                   const quint8 unit_id) override;
+    virtual void on_register_block(const quint8 endpoint, const RegisterBlock block) override;
+    virtual void on_poll_statistics(const quint8 endpoint, const PollStatistics statistics) override;
 
 protected:
 
     /**
      * @brief Re-draw the graph from class data
+     * \note
+     * Rebuilds the data of every graph, only needed when the lines or the
+     * history length change.
      */
     void redraw_graph();
 
     /**
-     * @brief Scan current data set to see if it's complete.  If it is, update
-     *        and re-draw the graph.
+     * @brief Update the axes and replot (graph data is already current)
+     * \note
+     * The plot is redrawn at most 30 times a second, the graph data is
+     * rebuilt should the decimation no longer match the plot width.
+     */
+    void replot_graph();
+
+    /**
+     * @brief Get the decimation bucket width for the plot size.
+     * @param span time shown on the plot (s)
+     * @return time spanned by 1 pixel (s)
      */
-    void scan();
+    [[nodiscard]] double get_bucket_width(const double span) const;
+
+    /**
+     * @brief Get the time axis common to all lines
+     * @return {oldest, newest} sample time of any line (s)
+     */
+    [[nodiscard]] std::pair<double, double> get_time_range() const;
+
+    /**
+     * @brief Get the time a sample received now is recorded at
+     * @return seconds since the window was created
+     */
+    [[nodiscard]] double get_timestamp() const;
 
     /**
      * @brief Add trend to the graph
@@ -141,8 +182,9 @@ protected:
 
     QCustomPlot *const m_plot;
     std::unordered_map<quint32, TrendLine*> m_data;
-    QList<double> m_timestamps;
+    int m_num_points; /**< History size of every line */
     const std::chrono::time_point<std::chrono::steady_clock> m_start_time;
+    const double m_epoch; /**< Unix time of m_start_time (s) */
 
 private slots:
 
@@ -166,13 +208,38 @@ private slots:
      */
     void on_capture_triggered();
 
+    /**
+     * @brief Action taken when the "Record History" menu item is selected
+     */
+    void on_history_triggered();
+
+    /**
+     * @brief Action taken when the "Stop Recording History" menu item is
+     *        selected
+     */
+    void on_stop_history_triggered();
+
+    /**
+     * @brief Follow the newest samples again (after scrolling / zooming)
+     */
+    void on_follow_triggered();
+
+    /**
+     * @brief Redraw the plot (throttled by m_replot_timer)
+     */
+    void on_replot_timer_timeout();
+
 private:
 
     /**
-     * \brief Save register data to CSV file
+     * \brief Start saving the register data to a CSV file
+     * \note
+     * The file is written in the background, errors are reported when done.
+     *
      * @param path absolute path and file name to save to
+     * @param layout file layout
      */
-    bool save_register_set(const QString &path);
+    void save_register_set(const QString &path, const TrendExporter::Layout layout);
 
     /**
      * @brief Resize the history
@@ -181,6 +248,13 @@ private:
      */
     void resize_history(const int points, bool redraw=true);
 
+    /**
+     * @brief Start recording the history of a line to m_history_dir
+     * @param line line to record
+     * @return ``false`` (error displayed) if the history cannot be opened
+     */
+    bool open_history(TrendLine *const line);
+
     QHBoxLayout *const m_layout;
     QGroupBox *const m_legend;
     QVBoxLayout *const m_legend_layout;
@@ -190,7 +264,13 @@ private:
     QPushButton *const m_add_button;
     QPushButton *const m_configure_button;
     QMenu *const m_main_menu;
+    QTimer *const m_replot_timer;
     bool m_fixed_limits = false;
+    bool m_live = true; /**< Follow the newest samples */
+    double m_bucket_width = 0.0; /**< Decimation of the graph data */
+    std::pair<double, double> m_loaded_range; /**< Time range loaded when not live */
+    QString m_history_dir; /**< Empty when not recording history */
+    TrendExporter *m_exporter = nullptr; /**< Save in progress */
 
     double m_miny;
     double m_maxy;
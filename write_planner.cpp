@@ -0,0 +1,132 @@
+/**
+ * \file write_planner.cpp
+ * \brief Pack register values into as few write requests as possible
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+//  c++ includes
+#include <algorithm>  //  std::stable_sort, std::remove_if
+
+// C includes
+#include <modbus/modbus.h>  //  MODBUS_MAX_WRITE_BITS, MODBUS_MAX_WRITE_REGISTERS
+
+// project includes
+#include "write_planner.h"  //  local include
+
+
+namespace {
+
+    /**
+     * \brief Get the register table (coils, holding registers).
+     * @param reg register number
+     * @return table index
+     */
+    quint16 get_table(const quint16 reg) noexcept
+    {
+        return quint16(reg / 10000U);
+    }
+
+
+    /**
+     * \brief Determine whether a value may be appended to a planned write.
+     * \note
+     * ``value`` must not come before the last register of ``write``.
+     *
+     * @param write write being built
+     * @param value candidate value
+     * @return ``true`` if the value may be appended
+     */
+    bool can_append(const WriteRequest &write, const WriteValue &value) noexcept
+    {
+        if ((write.node != value.node) ||
+                (get_table(write.first_register) != get_table(value.reg))) {
+            return false;
+        }
+
+        const auto count = write.values.size();
+        return (size_t(value.reg) == size_t(write.first_register) + count) &&
+                (count < write_planner::get_write_limit(write.first_register));
+    }
+
+}  //  Anonymous namespace
+
+
+quint16 write_planner::get_write_limit(const quint16 first_register) noexcept
+{
+    if (first_register <= 9999) {
+        return MODBUS_MAX_WRITE_BITS;
+    }
+
+    return MODBUS_MAX_WRITE_REGISTERS;
+}
+
+
+bool write_planner::is_writable(const quint16 reg) noexcept
+{
+    return (reg < 10000 && reg > 0) || (reg > 40000 && reg < 50000);
+}
+
+
+WritePlan write_planner::plan(std::vector<WriteValue> &&values)
+{
+    values.erase(std::remove_if(values.begin(), values.end(), [](const WriteValue &v) {
+        return !is_writable(v.reg);
+    }), values.end());
+
+    //  Group by node and table, ascending register within each group; values
+    // for the same address stay in file order.
+    std::stable_sort(values.begin(), values.end(), [](const WriteValue &a, const WriteValue &b) {
+        if (a.node != b.node) {
+            return a.node < b.node;
+        }
+        return a.reg < b.reg;
+    });
+
+    auto plan = WritePlan{{}, values.size(), 0U};
+    for (auto i=values.begin(); values.end() != i; ++i) {
+        const auto next = i + 1;
+        if ((values.end() != next) && (next->node == i->node) && (next->reg == i->reg)) {
+            //  Last value wins.
+            ++plan.duplicates;
+        } else if (!plan.writes.empty() && can_append(plan.writes.back(), *i)) {
+            plan.writes.back().values.push_back(i->value);
+        } else {
+            plan.writes.push_back({nullptr, i->node, i->reg, {i->value}});
+        }
+    }
+
+    return plan;
+}
+
+
+void write_planner::count_requests(const WritePlan &plan, size_t &coils, size_t &registers) noexcept
+{
+    coils = 0U;
+    registers = 0U;
+    for (const auto &i: plan.writes) {
+        if (0U == get_table(i.first_register)) {
+            ++coils;
+        } else {
+            ++registers;
+        }
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * \file write_planner.h
+ * \brief Pack register values into as few write requests as possible
+ * \copyright
+ * 2021 Andrew Buettner (ABi)
+ *
+ * \section LICENSE
+ *
+ * QModbusTool - A QT Based Modbus Client
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ *
+ * \section DESCRIPTION
+ *
+ * Register restores (CSV files, captures) supply values in whatever order the
+ * file holds them.  The planner collects every value, groups them by node and
+ * register table (coils or holding registers), sorts each group by address
+ * and packs consecutive addresses into a single write, within the protocol
+ * limits of 1968 coils or 123 registers per request.  When an address is
+ * given more than once only the last value (in file order) is written.
+ * Addresses that are not consecutive are never merged: a write covers exactly
+ * the registers supplied.
+ */
+
+#ifndef WRITE_PLANNER_H
+#define WRITE_PLANNER_H
+
+//  c++ includes
+#include <vector>  //  std::vector
+#include <QTypeInfo>  //  quint8, quint16
+
+// C includes
+/* -none- */
+
+// project includes
+#include "write_event.h"  //  WriteRequest
+
+
+/**
+ * \brief Register value to be written
+ */
+struct WriteValue {
+    quint8 node; /**< Node / device ID */
+
+    quint16 reg; /**< Register number (eg: 42, 40023) */
+
+    quint16 value; /**< Value to write */
+};
+
+
+/**
+ * \brief Write requests planned for a set of values
+ */
+struct WritePlan {
+    std::vector<WriteRequest> writes; /**< Requests to send, by node and address */
+
+    size_t values; /**< Writable values supplied */
+
+    size_t duplicates; /**< Values replaced by a later value for the same address */
+};
+
+
+namespace write_planner {
+
+    /**
+     * \brief Get the maximum number of registers in a single write.
+     * @param first_register register number in the table to write
+     * @return 1968 for coils, 123 for holding registers
+     */
+    [[nodiscard]] quint16 get_write_limit(const quint16 first_register) noexcept;
+
+    /**
+     * \brief Determine whether a register may be written.
+     * @param reg register number
+     * @return ``true`` for coils and holding registers
+     */
+    [[nodiscard]] bool is_writable(const quint16 reg) noexcept;
+
+    /**
+     * \brief Build the list of writes for a set of values.
+     * \note
+     * Values outside the coil and holding register tables are ignored.
+     *
+     * @param values values to write, in file order
+     * @return planned writes
+     */
+    [[nodiscard]] WritePlan plan(std::vector<WriteValue> &&values);
+
+    /**
+     * \brief Count the planned writes of each table.
+     * @param plan planned writes
+     * @param coils [out] coil writes
+     * @param registers [out] holding register writes
+     */
+    void count_requests(const WritePlan &plan, size_t &coils, size_t &registers) noexcept;
+
+}  //  namespace write_planner
+
+
+#endif // WRITE_PLANNER_H